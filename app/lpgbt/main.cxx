@@ -224,6 +224,34 @@ void regs(const std::string& cmd, ToolBox* target) {
     std::string fname = tool::readline("File: ");
     pflib::lpgbt::applylpGBTCSV(fname, *(target->lpgbt));
   }
+  if (cmd == "SHADOW") {
+    bool enable = tool::readline_bool("Use register shadow? ",
+                                      target->lpgbt->has_shadow());
+    if (enable) {
+      target->lpgbt->enable_shadow();
+    } else {
+      target->lpgbt->disable_shadow();
+    }
+  }
+  if (cmd == "SNAPSHOT") {
+    std::string fname = tool::readline("File (.yaml or binary): ");
+    pflib::lpgbt::saveRegisterSnapshot(fname, target->lpgbt->snapshot());
+  }
+  if (cmd == "DIFF") {
+    std::string fname = tool::readline("Snapshot file: ");
+    auto changes =
+        target->lpgbt->diff(pflib::lpgbt::loadRegisterSnapshot(fname));
+    for (const auto& [reg, value] : changes) {
+      printf("   %03x : %02x (now %02x)\n", reg, value,
+             target->lpgbt->read(reg));
+    }
+    printf("  %d registers differ\n", int(changes.size()));
+  }
+  if (cmd == "RESTORE") {
+    std::string fname = tool::readline("Snapshot file: ");
+    int n = target->lpgbt->restore(pflib::lpgbt::loadRegisterSnapshot(fname));
+    printf("  %d registers written\n", n);
+  }
 }
 
 void gpio(const std::string& cmd, ToolBox* target) {
@@ -787,7 +815,11 @@ auto direct =
         ->line("READ", "Read one or several registers", regs)
         ->line("WRITE", "Write a register", regs)
         ->line("BLIND", "Write a register blind (without reading)", regs)
-        ->line("LOAD", "Load from a CSV file", regs);
+        ->line("LOAD", "Load from a CSV file", regs)
+        ->line("SHADOW", "Enable/disable the register shadow", regs)
+        ->line("SNAPSHOT", "Save configuration registers to a file", regs)
+        ->line("DIFF", "Compare configuration registers to a snapshot", regs)
+        ->line("RESTORE", "Write registers differing from a snapshot", regs);
 
 auto mgpio = tool::menu("GPIO", "GPIO controls")
                  ->line("SET", "Set a GPIO pin", gpio)
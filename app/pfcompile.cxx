@@ -7,10 +7,15 @@
  */
 
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <tuple>
 
 #include "pflib/Compile.h"
+#include "pflib/CompileBatch.h"
+#include "pflib/CompileCache.h"
 #include "pflib/Exception.h"
 #include "pflib/logging/Logging.h"
 #include "pflib/version/Version.h"
@@ -34,9 +39,117 @@ static void usage() {
                "                  By default, the output file is the last "
                "setting file with the extension\n"
                "                  changed to 'csv'\n"
+               "  --batch, -b   : Compile the jobs listed in a YAML manifest "
+               "instead of the\n"
+               "                  setting files on the command line.\n"
+               "  -j,--jobs     : Number of threads to use in batch mode\n"
+               "                  By default, we use one per hardware thread.\n"
+               "\n"
+               " BATCH MODE:\n"
+               "  The manifest is a list of jobs, each with the 'chip' to "
+               "compile for (default\n"
+               "  given by --chip), a list of 'inputs' setting files, the "
+               "'output' CSV file,\n"
+               "  and optionally 'defaults: false' (default given by "
+               "--no-defaults).\n"
+               "  Relative paths are relative to the directory of the "
+               "manifest.\n"
+               "\n"
+               "    - chip: sipm_rocv3b\n"
+               "      inputs: [common.yaml, roc0.yaml]\n"
+               "      output: roc0.csv\n"
+               "\n"
+               "  Jobs with the same chip and first input share the settings "
+               "extracted\n"
+               "  from that input so a common file is only parsed once.\n"
+               "\n"
+               " ENVIRONMENT:\n"
+               "  PFLIB_COMPILE_CACHE : directory to cache compiled settings "
+               "files in\n"
             << std::endl;
 }
 
+/// write the register values in an image as CSV
+static void write_csv(std::ostream& f, const pflib::RegisterImage& settings) {
+  f << "# This register settings file was generated by pfcompile\n"
+    << "#    " << pflib::version::debug() << "\n"
+    << "#    The columns are: page, register, value (in hex)\n";
+  for (const auto& run : settings.runs()) {
+    for (int i{0}; i < run.n; i++) {
+      f << run.page << ',' << run.reg + i << ',' << "0x" << std::setfill('0')
+        << std::setw(2) << std::hex << static_cast<int>(run.values[i])
+        << std::dec << '\n';
+    }
+  }
+  f.flush();
+}
+
+using Settings = std::map<std::string, std::map<std::string, uint64_t>>;
+
+/**
+ * Run all of the jobs in the manifest on a thread pool
+ *
+ * With a compile cache, each job goes through Compiler::compile_image
+ * with its setting files so unchanged configurations are loaded from
+ * the cache. Without one, the settings extracted from the first input
+ * of a job (on top of the defaults if they are prepended) are shared by
+ * all jobs with the same chip type and first input so a common file is
+ * only parsed once.
+ *
+ * @return number of jobs that failed
+ */
+static int run_batch(const std::vector<pflib::batch::Job>& jobs,
+                     int n_threads) {
+  using pflib::batch::Job;
+  bool cached{pflib::CompileCache::global() != nullptr};
+
+  // settings after the first input, computed by the first job that needs them
+  using BaseKey = std::tuple<std::string, bool, std::string>;
+  std::map<BaseKey, std::shared_future<Settings>> bases;
+  std::mutex bases_mutex;
+  auto base = [&](const Job& job, pflib::Compiler& c) -> const Settings& {
+    BaseKey key{job.chip, job.flag, job.inputs.front()};
+    std::promise<Settings> promise;
+    std::shared_future<Settings> settings;
+    bool mine{false};
+    {
+      std::lock_guard<std::mutex> l{bases_mutex};
+      auto [it, inserted] = bases.try_emplace(key);
+      if (inserted) {
+        it->second = promise.get_future().share();
+        mine = true;
+      }
+      settings = it->second;
+    }
+    if (mine) {
+      try {
+        Settings s;
+        if (job.flag) s = c.defaults();
+        c.extract(std::vector<std::string>{job.inputs.front()}, s);
+        promise.set_value(std::move(s));
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+      }
+    }
+    // the map holds onto the shared state so the reference stays valid
+    return settings.get();
+  };
+
+  return pflib::batch::run_batch(
+      jobs, n_threads, "compiled",
+      [&](const Job& job, pflib::Compiler& c, std::ostream& f) {
+        if (cached) {
+          write_csv(f, c.compile_image(job.inputs, job.flag));
+          return;
+        }
+        Settings settings{base(job, c)};
+        c.extract(std::vector<std::string>(job.inputs.begin() + 1,
+                                           job.inputs.end()),
+                  settings);
+        write_csv(f, c.compile_image(settings));
+      });
+}
+
 int main(int argc, char* argv[]) {
   pflib::logging::fixture _logging_fixture;
   if (argc == 1) {
@@ -50,6 +163,8 @@ int main(int argc, char* argv[]) {
   std::vector<std::string> setting_files;
   std::string type_version{"sipm_rocv3b"};
   std::string output_filename;
+  std::string manifest;
+  int n_threads{0};
   for (int i_arg{1}; i_arg < argc; i_arg++) {
     std::string arg{argv[i_arg]};
     if (arg[0] == '-') {
@@ -78,6 +193,26 @@ int main(int argc, char* argv[]) {
         }
         i_arg++;
         output_filename = argv[i_arg];
+      } else if (arg == "--batch" or arg == "-b" or arg == "--jobs" or
+                 arg == "-j") {
+        if (i_arg + 1 == argc or argv[i_arg + 1][0] == '-') {
+          pflib_log(fatal) << "The " << arg
+                           << " parameter requires are argument after it.";
+          return 1;
+        }
+        i_arg++;
+        if (arg == "--batch" or arg == "-b") {
+          manifest = argv[i_arg];
+        } else {
+          try {
+            n_threads = std::stoi(argv[i_arg]);
+          } catch (const std::logic_error&) {
+            pflib_log(fatal) << "The " << arg << " parameter requires a "
+                             << "number, not '" << argv[i_arg] << "'.";
+            usage();
+            return 1;
+          }
+        }
       } else {
         pflib_log(fatal) << arg << " not a recognized argument.";
         return 1;
@@ -88,6 +223,22 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (not manifest.empty()) {
+    if (not setting_files.empty() or not output_filename.empty()) {
+      pflib_log(fatal) << "Setting files and an output file cannot be given "
+                          "on the command line in batch mode.";
+      return 1;
+    }
+    try {
+      auto jobs = pflib::batch::read_manifest(manifest, type_version,
+                                              "defaults", prepend_defaults);
+      return run_batch(jobs, n_threads) == 0 ? 0 : 4;
+    } catch (const pflib::Exception& e) {
+      pflib_log(fatal) << "[" << e.name() << "] " << e.message();
+      return -1;
+    }
+  }
+
   if (setting_files.empty()) {
     pflib_log(fatal)
         << "We need at least one settings YAML file as argument to compile.";
@@ -112,31 +263,17 @@ int main(int argc, char* argv[]) {
     return 3;
   }
 
-  std::map<int, std::map<int, uint8_t>> settings;
+  pflib::RegisterImage settings;
   try {
     // compilation checks parameter/page names
     settings = pflib::Compiler::get(type_version)
-                   .compile(setting_files, prepend_defaults);
+                   .compile_image(setting_files, prepend_defaults);
   } catch (const pflib::Exception& e) {
     pflib_log(fatal) << "[" << e.name() << "] " << e.message();
     return -1;
   }
 
-  f << "# This register settings file was generated by pfcompile\n"
-    << "#    " << pflib::version::debug() << "\n"
-    << "#    The columns are: page, register, value (in hex)\n";
-  for (const auto& page : settings) {
-    int i_page = page.first;
-    for (const auto& reg : page.second) {
-      int i_reg = reg.first;
-      uint8_t val = reg.second;
-      f << i_page << ',' << i_reg << ',' << "0x" << std::setfill('0')
-        << std::setw(2) << std::hex << static_cast<int>(val) << std::dec
-        << '\n';
-    }
-  }
-
-  f.flush();
+  write_csv(f, settings);
 
   return 0;
 }
@@ -12,6 +12,7 @@
 #include <iostream>
 
 #include "pflib/Compile.h"
+#include "pflib/CompileBatch.h"
 #include "pflib/Exception.h"
 #include "pflib/logging/Logging.h"
 #include "pflib/utility/load_integer_csv.h"
@@ -36,9 +37,65 @@ static void usage() {
                "                  By default, the output file is the file with "
                "register values with extension\n"
                "                  changed to 'yaml'\n"
+               "  --batch, -b   : Decompile the jobs listed in a YAML manifest "
+               "instead of the\n"
+               "                  register values file on the command line.\n"
+               "  -j,--jobs     : Number of threads to use in batch mode\n"
+               "                  By default, we use one per hardware thread.\n"
+               "\n"
+               " BATCH MODE:\n"
+               "  The manifest is a list of jobs, each with the 'chip' to "
+               "decompile for (default\n"
+               "  given by --roc), the 'input' register values file, the "
+               "'output' YAML file,\n"
+               "  and optionally 'careful: false' (default given by "
+               "--no-careful).\n"
+               "  Relative paths are relative to the directory of the "
+               "manifest.\n"
+               "\n"
+               "    - chip: sipm_rocv3b\n"
+               "      input: roc0.csv\n"
+               "      output: roc0.yaml\n"
             << std::endl;
 }
 
+/// read register values from a CSV file with page, register, value columns
+static pflib::RegisterImage load_registers(const std::string& input_filename) {
+  auto the_log_{pflib::logging::get("pfdecompile")};
+  pflib::RegisterImage settings;
+  pflib::utility::load_integer_csv(
+      input_filename, [&](const std::vector<int> cells) {
+        if (cells.size() != 3) {
+          pflib_log(warn) << "Skipping row with exactly three columns.";
+          return;
+        }
+        settings.set(cells.at(0), cells.at(1), cells.at(2));
+      });
+  return settings;
+}
+
+/// write parameter values as YAML
+static void write_yaml(
+    std::ostream& of,
+    const std::map<std::string, std::map<std::string, uint64_t>>& parameters,
+    const std::string& version) {
+  YAML::Emitter out;
+  out << YAML::Comment("This YAML settings file was generated by pfdecompile");
+  out << YAML::Comment(version);
+  out << YAML::BeginMap;
+  for (const auto& page : parameters) {
+    out << YAML::Key << page.first;
+    out << YAML::Value << YAML::BeginMap;
+    for (const auto& param : page.second) {
+      out << YAML::Key << param.first << YAML::Value << param.second;
+    }
+    out << YAML::EndMap;
+  }
+  out << YAML::EndMap;
+
+  of << out.c_str() << std::endl;
+}
+
 int main(int argc, char* argv[]) {
   pflib::logging::fixture f;
   if (argc == 1) {
@@ -52,6 +109,8 @@ int main(int argc, char* argv[]) {
   std::string input_filename;
   std::string output_filename;
   std::string roc_type_version;
+  std::string manifest;
+  int n_threads{0};
   for (int i_arg{1}; i_arg < argc; i_arg++) {
     std::string arg{argv[i_arg]};
     if (arg[0] == '-') {
@@ -75,6 +134,26 @@ int main(int argc, char* argv[]) {
         }
         i_arg++;
         output_filename = argv[i_arg];
+      } else if (arg == "--batch" or arg == "-b" or arg == "--jobs" or
+                 arg == "-j") {
+        if (i_arg + 1 == argc or argv[i_arg + 1][0] == '-') {
+          pflib_log(fatal) << "The " << arg
+                           << " parameter requires are argument after it.";
+          return 1;
+        }
+        i_arg++;
+        if (arg == "--batch" or arg == "-b") {
+          manifest = argv[i_arg];
+        } else {
+          try {
+            n_threads = std::stoi(argv[i_arg]);
+          } catch (const std::logic_error&) {
+            pflib_log(fatal) << "The " << arg << " parameter requires a "
+                             << "number, not '" << argv[i_arg] << "'.";
+            usage();
+            return 1;
+          }
+        }
       } else if (arg == "--no-careful") {
         careful = false;
       } else if (arg == "--careful") {
@@ -98,6 +177,29 @@ int main(int argc, char* argv[]) {
   std::string version{pflib::version::debug()};
   pflib_log(debug) << version;
 
+  if (not manifest.empty()) {
+    if (not input_filename.empty() or not output_filename.empty()) {
+      pflib_log(fatal) << "A register values file and an output file cannot "
+                          "be given on the command line in batch mode.";
+      return 1;
+    }
+    try {
+      auto jobs = pflib::batch::read_manifest(manifest, roc_type_version,
+                                              "careful", careful, true);
+      int n_failed = pflib::batch::run_batch(
+          jobs, n_threads, "decompiled",
+          [&](const pflib::batch::Job& job, pflib::Compiler& c,
+              std::ostream& of) {
+            auto settings = load_registers(job.inputs.front());
+            write_yaml(of, c.decompile(settings, job.flag), version);
+          });
+      return n_failed == 0 ? 0 : 4;
+    } catch (const pflib::Exception& e) {
+      pflib_log(fatal) << "[" << e.name() << "] " << e.message();
+      return -1;
+    }
+  }
+
   if (input_filename.empty()) {
     pflib_log(fatal) << "We need one file to decompile.";
     return 1;
@@ -111,16 +213,9 @@ int main(int argc, char* argv[]) {
     output_filename += ".yaml";
   }
 
-  std::map<int, std::map<int, uint8_t>> settings;
+  pflib::RegisterImage settings;
   try {
-    pflib::utility::load_integer_csv(
-        input_filename, [&](const std::vector<int> cells) {
-          if (cells.size() != 3) {
-            pflib_log(warn) << "Skipping row with exactly three columns.";
-            return;
-          }
-          settings[cells.at(0)][cells.at(1)] = cells.at(2);
-        });
+    settings = load_registers(input_filename);
   } catch (const pflib::Exception& e) {
     pflib_log(fatal) << "[" << e.name() << "] " << e.message();
     return -1;
@@ -143,21 +238,7 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
-  YAML::Emitter out;
-  out << YAML::Comment("This YAML settings file was generated by pfdecompile");
-  out << YAML::Comment(version);
-  out << YAML::BeginMap;
-  for (const auto& page : parameters) {
-    out << YAML::Key << page.first;
-    out << YAML::Value << YAML::BeginMap;
-    for (const auto& param : page.second) {
-      out << YAML::Key << param.first << YAML::Value << param.second;
-    }
-    out << YAML::EndMap;
-  }
-  out << YAML::EndMap;
-
-  of << out.c_str() << std::endl;
+  write_yaml(of, parameters, version);
 
   return 0;
 }
@@ -0,0 +1,207 @@
+/**
+ * Compare chip configurations parameter by parameter
+ *
+ * The configurations can be YAML settings files (which are compiled)
+ * or register dumps in the CSV format written by pfcompile. The
+ * registers are compared first and only the parameters using the
+ * registers that differ are decompiled.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+#include "pflib/Compile.h"
+#include "pflib/Exception.h"
+#include "pflib/logging/Logging.h"
+#include "pflib/utility/ends_with.h"
+#include "pflib/utility/load_integer_csv.h"
+#include "pflib/version/Version.h"
+
+static void usage() {
+  std::cout << "\n"
+               " USAGE:\n"
+               "  pfdiff [options] reference config [config1 ...]\n"
+               "\n"
+               "  Compare each config to the reference. Files ending in "
+               "'.yaml' or '.yml' are\n"
+               "  settings that are compiled, all other files are register "
+               "values with the\n"
+               "  columns page, register, value (like pfcompile writes).\n"
+               "\n"
+               " OPTIONS:\n"
+               "  -h,--help       : Print this help and exit\n"
+               "  -v,--version    : Print pflib version\n"
+               "  -c,--chip       : Define the CHIP type_version of the "
+               "configurations\n"
+               "                    By default, we use the sipm_rocv3b "
+               "register mapping.\n"
+               "  --no-defaults   : Don't apply the defaults before compiling "
+               "YAML settings\n"
+               "  --little-endian : Combine multi-register parameters as "
+               "little endian (ECONs)\n"
+               "  -f,--format     : Output format: text (default), csv, or "
+               "json\n"
+               "  -o,--output     : Write output to this file instead of "
+               "std::cout\n"
+               "\n"
+               " EXIT CODE:\n"
+               "  0 if all configurations match the reference, 1 if any "
+               "differ, and\n"
+               "  larger than 1 if there was an error.\n"
+            << std::endl;
+}
+
+/// load a configuration, compiling it if it is YAML
+static pflib::RegisterImage load(pflib::Compiler& c, const std::string& file,
+                                 bool prepend_defaults) {
+  if (pflib::utility::ends_with(file, ".yaml") or
+      pflib::utility::ends_with(file, ".yml")) {
+    return c.compile_image(std::vector<std::string>{file}, prepend_defaults);
+  }
+  pflib::RegisterImage image;
+  pflib::utility::load_integer_csv(file, [&](const std::vector<int>& cells) {
+    if (cells.size() != 3) {
+      PFEXCEPTION_RAISE("BadRow", "Row in " + file +
+                                      " does not have exactly three columns.");
+    }
+    image.set(cells[0], cells[1], cells[2]);
+  });
+  return image;
+}
+
+int main(int argc, char* argv[]) {
+  pflib::logging::fixture _logging_fixture;
+  if (argc == 1) {
+    usage();
+    return 2;
+  }
+
+  auto the_log_{pflib::logging::get("pfdiff")};
+
+  bool prepend_defaults{true}, little_endian{false};
+  std::string type_version{"sipm_rocv3b"}, format{"text"}, output_filename;
+  std::vector<std::string> files;
+  for (int i_arg{1}; i_arg < argc; i_arg++) {
+    std::string arg{argv[i_arg]};
+    if (arg[0] == '-') {
+      if (arg == "--help" or arg == "-h") {
+        usage();
+        return 0;
+      } else if (arg == "--version" or arg == "-v") {
+        std::cout << "pflib " << pflib::version::debug() << std::endl;
+        return 0;
+      } else if (arg == "--no-defaults") {
+        prepend_defaults = false;
+      } else if (arg == "--little-endian") {
+        little_endian = true;
+      } else if (arg == "--chip" or arg == "-c" or arg == "--format" or
+                 arg == "-f" or arg == "--output" or arg == "-o") {
+        if (i_arg + 1 == argc or argv[i_arg + 1][0] == '-') {
+          pflib_log(fatal) << "The " << arg
+                           << " parameter requires are argument after it.";
+          return 2;
+        }
+        i_arg++;
+        if (arg == "--chip" or arg == "-c") {
+          type_version = argv[i_arg];
+        } else if (arg == "--format" or arg == "-f") {
+          format = argv[i_arg];
+        } else {
+          output_filename = argv[i_arg];
+        }
+      } else {
+        pflib_log(fatal) << arg << " not a recognized argument.";
+        return 2;
+      }
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.size() < 2) {
+    pflib_log(fatal) << "We need a reference and at least one configuration "
+                        "to compare to it.";
+    return 2;
+  }
+
+  if (format != "text" and format != "csv" and format != "json") {
+    pflib_log(fatal) << "Unrecognized output format " << format;
+    return 2;
+  }
+
+  std::ofstream of;
+  if (not output_filename.empty()) {
+    of.open(output_filename);
+    if (not of.is_open()) {
+      pflib_log(fatal) << "Unable to open output file " << output_filename;
+      return 3;
+    }
+  }
+  std::ostream& out{output_filename.empty() ? std::cout : of};
+
+  auto start = std::chrono::steady_clock::now();
+  bool any_differ{false};
+  nlohmann::json json_out = nlohmann::json::array();
+  if (format == "csv") out << "config,page,param,reference,value\n";
+  try {
+    auto c = pflib::Compiler::get(type_version);
+    auto reference = load(c, files[0], prepend_defaults);
+    for (std::size_t i{1}; i < files.size(); i++) {
+      const std::string& file{files[i]};
+      auto diffs = c.diff(reference, load(c, file, prepend_defaults),
+                          little_endian);
+      any_differ = any_differ or not diffs.empty();
+      if (format == "json") {
+        nlohmann::json params = nlohmann::json::array();
+        for (const auto& d : diffs) {
+          params.push_back({{"page", d.page},
+                            {"param", d.param},
+                            {"reference", d.in_a ? nlohmann::json(d.a)
+                                                 : nlohmann::json()},
+                            {"value", d.in_b ? nlohmann::json(d.b)
+                                             : nlohmann::json()}});
+        }
+        json_out.push_back({{"config", file}, {"diffs", params}});
+      } else if (format == "csv") {
+        for (const auto& d : diffs) {
+          out << file << ',' << d.page << ',' << d.param << ',';
+          if (d.in_a) out << d.a;
+          out << ',';
+          if (d.in_b) out << d.b;
+          out << '\n';
+        }
+      } else {
+        out << file << ": " << diffs.size() << " parameters differ from "
+            << files[0] << '\n';
+        for (const auto& d : diffs) {
+          out << "  " << d.page << '.' << d.param << ": ";
+          if (d.in_a) {
+            out << d.a;
+          } else {
+            out << "(missing)";
+          }
+          out << " -> ";
+          if (d.in_b) {
+            out << d.b;
+          } else {
+            out << "(missing)";
+          }
+          out << '\n';
+        }
+      }
+    }
+  } catch (const pflib::Exception& e) {
+    pflib_log(fatal) << "[" << e.name() << "] " << e.message();
+    return 4;
+  }
+  if (format == "json") out << json_out.dump(2) << '\n';
+  out << std::flush;
+
+  auto end = std::chrono::steady_clock::now();
+  pflib_log(debug) << "compared " << files.size() - 1 << " configurations in "
+                   << std::chrono::duration<double>(end - start).count()
+                   << " s";
+  return any_differ ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * generator of synthetic raw data files for testing the decoders
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "pflib/Exception.h"
+#include "pflib/logging/Logging.h"
+#include "pflib/sim/EventGenerator.h"
+#include "pflib/version/Version.h"
+
+static void usage() {
+  std::cout
+      << "\n"
+         " USAGE:\n"
+         "  pfgenerate [options] output_file\n"
+         "\n"
+         "  Write synthetic events into a raw file for load testing the "
+         "decoders.\n"
+         "\n"
+         " OPTIONS:\n"
+         "  -h,--help      : print this help and exit\n"
+         "  -f,--format    : format of the data, simpleroc (pfdecoder), econd "
+         "(econd-decoder)\n"
+         "                   or rogue (rogue-decoder) (default econd)\n"
+         "  -n,--nevents   : number of events to write (default 1000)\n"
+         "  --occupancy    : probability for each channel to be hit "
+         "(default 0.1)\n"
+         "  --samples      : number of samples in each event (default 1)\n"
+         "  --soi          : index of the sample of interest (default 0)\n"
+         "  --n-links      : number of eRx on each ECON-D (default 2)\n"
+         "  --n-econs      : number of ECON-Ds (default 1)\n"
+         "  --no-zs        : don't zero suppress the pedestals in the ECON-D\n"
+         "  --seed         : seed for the random numbers (default 0)\n"
+         "  --contrib      : contributor ID for the rogue format (default 20)\n"
+         "  --bad-crc      : fraction of packets with a bad CRC (default 0)\n"
+         "  --truncate     : fraction of packets that are truncated "
+         "(default 0)\n"
+         "  --bad-header   : fraction of packets with a bad header "
+         "(default 0)\n"
+         "  -l,--log       : logging level to printout (-1: trace up to 4: "
+         "fatal)\n"
+      << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  pflib::logging::fixture f;
+  if (argc == 1) {
+    // can't do anything without any arguments
+    usage();
+    return 1;
+  }
+
+  auto the_log_{pflib::logging::get("pfgenerate")};
+
+  pflib::sim::EventGenerator::Config cfg;
+  uint64_t nevents{1000};
+  std::string out_file;
+  for (int i_arg{1}; i_arg < argc; i_arg++) {
+    std::string arg{argv[i_arg]};
+    if (arg[0] != '-') {
+      if (not out_file.empty()) {
+        pflib_log(fatal) << "Can only write one file at a time.";
+        return 1;
+      }
+      out_file = arg;
+      continue;
+    }
+    if (arg == "-h" or arg == "--help") {
+      usage();
+      return 0;
+    } else if (arg == "--no-zs") {
+      cfg.zero_suppression = false;
+      continue;
+    }
+    // all other options need an argument
+    if (i_arg + 1 == argc or
+        (argv[i_arg + 1][0] == '-' and std::string(argv[i_arg + 1]) != "-1")) {
+      pflib_log(fatal) << "The " << arg
+                       << " parameter requires an argument after it.";
+      return 1;
+    }
+    i_arg++;
+    std::string val{argv[i_arg]};
+    try {
+      if (arg == "-f" or arg == "--format") {
+        if (val == "simpleroc") {
+          cfg.format = pflib::sim::EventGenerator::Format::SIMPLEROC;
+        } else if (val == "econd") {
+          cfg.format = pflib::sim::EventGenerator::Format::ECOND;
+        } else if (val == "rogue") {
+          cfg.format = pflib::sim::EventGenerator::Format::ROGUE;
+        } else {
+          pflib_log(fatal) << "Unrecognized format " << val
+                           << " should be 'simpleroc', 'econd' or 'rogue'";
+          return 1;
+        }
+      } else if (arg == "-n" or arg == "--nevents") {
+        nevents = std::stoull(val);
+      } else if (arg == "--occupancy") {
+        cfg.occupancy = std::stod(val);
+      } else if (arg == "--samples") {
+        cfg.n_samples = std::stoi(val);
+      } else if (arg == "--soi") {
+        cfg.i_soi = std::stoi(val);
+      } else if (arg == "--n-links") {
+        cfg.n_links = std::stoi(val);
+      } else if (arg == "--n-econs") {
+        cfg.n_econs = std::stoi(val);
+      } else if (arg == "--seed") {
+        cfg.seed = std::stoull(val);
+      } else if (arg == "--contrib") {
+        cfg.contrib_id = std::stoi(val);
+      } else if (arg == "--bad-crc") {
+        cfg.bad_crc_rate = std::stod(val);
+      } else if (arg == "--truncate") {
+        cfg.truncation_rate = std::stod(val);
+      } else if (arg == "--bad-header") {
+        cfg.bad_header_rate = std::stod(val);
+      } else if (arg == "-l" or arg == "--log") {
+        pflib::logging::set(pflib::logging::convert(std::stoi(val)));
+      } else {
+        pflib_log(fatal) << "Unrecognized option " << arg;
+        return 1;
+      }
+    } catch (const std::invalid_argument& e) {
+      pflib_log(fatal) << "The argument to " << arg << " '" << val
+                       << "' is not a number.";
+      return 1;
+    }
+  }
+
+  pflib_log(debug) << pflib::version::debug();
+
+  if (out_file.empty()) {
+    pflib_log(fatal) << "Need to provide a file to write.";
+    usage();
+    return 1;
+  }
+
+  std::ofstream o{out_file, std::ios::binary};
+  if (not o) {
+    pflib_log(fatal) << "Unable to open file '" << out_file << "'.";
+    return 1;
+  }
+
+  try {
+    pflib::sim::EventGenerator gen{cfg};
+    std::vector<uint32_t> event;
+    uint64_t n_words{0};
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i_event{0}; i_event < nevents; i_event++) {
+      gen.next(event);
+      o.write(reinterpret_cast<const char*>(event.data()),
+              sizeof(uint32_t) * event.size());
+      n_words += event.size();
+    }
+    o.close();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    pflib_log(info) << "Wrote " << gen.n_events() << " events ("
+                    << 4 * n_words / 1e6 << " MB) to " << out_file << " in "
+                    << seconds << "s";
+    const auto& injected{gen.injected()};
+    pflib_log(info) << "Injected " << injected.bad_crc << " bad CRCs, "
+                    << injected.truncated << " truncations and "
+                    << injected.bad_header << " bad headers";
+  } catch (const pflib::Exception& e) {
+    pflib_log(fatal) << "[" << e.name() << "] " << e.message();
+    return 1;
+  }
+
+  return 0;
+}
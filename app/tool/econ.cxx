@@ -49,6 +49,8 @@ static void econ_expert_render(Target* tgt) {
  * ## Commands
  * - READ : read a specific register
  * - WRITE : write to a specific register
+ * - VERIFY : choose when writes are read back pflib::ECON::setVerifyPolicy
+ * - BURST : set the longest register transfer pflib::ECON::setMaxBurst
  */
 static void econ_expert(const std::string& cmd, Target* tgt) {
   auto& econ = tgt->econ(pftool::state.iecon);
@@ -72,6 +74,24 @@ static void econ_expert(const std::string& cmd, Target* tgt) {
     econ.setValue(address, value, nbytes);
     printf("Wrote 0x%lx to register 0x%04x (%d bytes)\n", value, address,
            nbytes);
+  } else if (cmd == "VERIFY") {
+    static const std::vector<std::string> policies = {"ALWAYS", "SAMPLED",
+                                                      "NEVER"};
+    std::string policy = pftool::readline(
+        "Read back writes: ", policies,
+        policies[static_cast<int>(econ.verifyPolicy())]);
+    if (policy == "SAMPLED") {
+      int every = pftool::readline_int("Verify one write out of: ", 16);
+      econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Sampled, every);
+    } else if (policy == "NEVER") {
+      econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Never);
+    } else {
+      econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Always);
+    }
+    printf("%d read-back mismatches so far\n", econ.verifyMismatches());
+  } else if (cmd == "BURST") {
+    econ.setMaxBurst(
+        pftool::readline_int("Maximum bytes per transfer: ", econ.maxBurst()));
   }
 }
 
@@ -136,6 +156,7 @@ static void econ_status(const std::string& cmd, Target* tgt) {
  * - RUNMODE : enable run bit on the ECON
  * - POKE : pflib::ECON::applyParameter
  * - LOAD : Load parameters from a YAML file
+ * - LOAD_ALL : pflib::Target::loadParameters for several ECONs at once
  * - READ : pflib::ECON::readParameter
  * - READCONFIG : Read parameters from a YAML file
  * - DUMP : pflib::ECON::dumpSettings with decompile=true
@@ -202,6 +223,25 @@ static void econ(const std::string& cmd, Target* pft) {
         false);
     econ.loadParameters(fname, prepend_defaults);
   }
+  if (cmd == "LOAD_ALL") {
+    std::cout << "\n"
+                 " --- Provide a YAML file for each ECON, leave empty to skip "
+                 "that ECON.\n"
+                 " --- ECONs on independent I2C buses are loaded at the same "
+                 "time.\n"
+              << std::flush;
+    std::map<int, std::string> files;
+    for (int id : pft->econ_ids()) {
+      std::string fname =
+          pftool::readline("Filename for ECON " + std::to_string(id) + ": ");
+      if (not fname.empty()) files[id] = fname;
+    }
+    bool prepend_defaults = pftool::readline_bool(
+        "Update all parameter values on the chips using the defaults in the "
+        "manual for any values not provided? ",
+        false);
+    pft->loadParameters({}, files, prepend_defaults);
+  }
   if (cmd == "READ") {
     auto page = pftool::readline("Page? ", pftool::state.econ_page_names(econ));
     auto param = pftool::readline("Parameter: ",
@@ -271,6 +311,7 @@ auto menu_econ =
         ->line("RUNMODE", "set/clear the run mode", econ)
         ->line("POKE", "change a single parameter value", econ)
         ->line("LOAD", "load all parameters", econ)
+        ->line("LOAD_ALL", "load parameters onto several ECONs", econ)
         ->line("DUMP", "dump parameters", econ)
         ->line("READCONFIG", "read a yaml file", econ)
         ->line("READ", "read one parameter and page", econ)
@@ -280,5 +321,9 @@ auto menu_econ_expert =
     menu_econ
         ->submenu("EXPERT", "expert interaction with ECON", econ_expert_render)
         ->line("READ", "read a single register's value", econ_expert)
-        ->line("WRITE", "read a single register's value", econ_expert);
+        ->line("WRITE", "read a single register's value", econ_expert)
+        ->line("VERIFY", "choose when register writes are read back",
+               econ_expert)
+        ->line("BURST", "set the maximum register transfer length",
+               econ_expert);
 }  // namespace
@@ -18,6 +18,7 @@
  * - READ : pflib::I2C::read_byte after passing 100 to pflib::I2C::set_bus_speed
  * - MULTIREAD : pflib::I2C::general_write_read
  * - MULTIWRITE : pflib::I2C::general_write_read
+ * - INVALIDATE : pflib::I2C::invalidate_bus_state
  *
  * @param[in] cmd I2C command
  * @param[in] pft active target
@@ -87,6 +88,9 @@ static void i2c(const std::string& cmd, Target* target) {
     }
     i2c.general_write_read(i2caddr, wdata);
   }
+  if (cmd == "INVALIDATE") {
+    i2c.invalidate_bus_state();
+  }
 }
 
 /**
@@ -267,7 +271,10 @@ auto menu_i2c = menu_expert->submenu("I2C", "raw I2C interactions")
                     ->line("READ", "Read from an address", i2c)
                     ->line("WRITE", "Write to an address", i2c)
                     ->line("MULTIREAD", "Read from an address", i2c)
-                    ->line("MULTIWRITE", "Write to an address", i2c);
+                    ->line("MULTIWRITE", "Write to an address", i2c)
+                    ->line("INVALIDATE",
+                           "Forget the cached bus speed and mux selections",
+                           i2c);
 auto menu_elinks =
     menu_expert->submenu("ELINKS", "manage the elinks")
         ->line("RELINK", "Follow standard procedure to establish links", elinks)
@@ -4,10 +4,14 @@
  * The commands are written into files corresponding to the menu's name.
  */
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <set>
 
 #include "pflib/Compile.h"
+#include "pflib/CompileCache.h"
 #include "pflib/Parameters.h"
 #include "pflib/version/Version.h"
 #include "pftool.h"
@@ -21,7 +25,8 @@ pflib::logging::logger get_by_file(const std::string& filepath) {
   return pflib::logging::get("pftool." + relative);
 }
 
-void pftool::State::init(Target* tgt, int cfg) {
+void pftool::State::init(Target* tgt, int cfg, bool eager) {
+  tgt_ = tgt;
   cfg_ = cfg;
   /**
    * set default format mode depending on readout config
@@ -34,41 +39,49 @@ void pftool::State::init(Target* tgt, int cfg) {
   } else {
     daq_format_mode = Target::DaqFormat::ECOND_SW_HEADERS;
   }
-  /// copy over page and param names for tab completion
-  std::vector<int> roc_ids{tgt->roc_ids()};
-  for (int id : roc_ids) {
-    auto defs = tgt->roc(id).defaults();
-    for (const auto& page : defs) {
-      roc_page_names_[id].push_back(page.first);
-      for (const auto& param : page.second) {
-        roc_param_names_[id][page.first].push_back(param.first);
-      }
-    }
+  if (not eager) return;
+  /// build the names for all chip types on the target in parallel
+  std::set<std::string> types;
+  for (int id : tgt->roc_ids()) types.insert(tgt->roc(id).type());
+  for (int id : tgt->econ_ids()) types.insert(tgt->econ(id).type());
+  std::vector<std::future<void>> jobs;
+  for (const std::string& type : types) {
+    jobs.push_back(
+        std::async(std::launch::async, [this, type]() { names(type); }));
   }
-  for (int id : tgt->econ_ids()) {
-    auto type = tgt->econ(id).type();
-    if (econ_page_names_.find(type) == econ_page_names_.end()) {
-      auto compiler = pflib::Compiler::get(type);
-      for (const auto& page : compiler.defaults()) {
-        econ_page_names_[type].push_back(page.first);
-        for (const auto& param : page.second) {
-          econ_param_names_[type][page.first].push_back(param.first);
-        }
-      }
-    }
+  for (auto& job : jobs) job.get();
+}
+
+const pftool::State::Names& pftool::State::names(
+    const std::string& type) const {
+  {
+    std::lock_guard<std::mutex> l{names_mutex_};
+    auto it = names_.find(type);
+    if (it != names_.end()) return it->second;
+  }
+  // copy over page and param names for tab completion outside of the
+  // lock so that different chip types can be built at the same time
+  Names type_names;
+  auto compiler = pflib::Compiler::get(type);
+  for (const auto& page : compiler.defaults()) {
+    type_names.pages.push_back(page.first);
+    auto& params{type_names.params[page.first]};
+    for (const auto& param : page.second) params.push_back(param.first);
   }
+  std::lock_guard<std::mutex> l{names_mutex_};
+  return names_.emplace(type, std::move(type_names)).first->second;
 }
 
 const std::vector<std::string>& pftool::State::roc_page_names() const {
-  return roc_page_names_.at(iroc);
+  return names(tgt_->roc(iroc).type()).pages;
 }
 
 const std::vector<std::string>& pftool::State::roc_param_names(
     const std::string& page) const {
   auto PAGE{pflib::upper_cp(page)};
-
-  auto param_list_it = roc_param_names_.at(iroc).find(PAGE);
-  if (param_list_it == roc_param_names_.at(iroc).end()) {
+  const auto& params{names(tgt_->roc(iroc).type()).params};
+  auto param_list_it = params.find(PAGE);
+  if (param_list_it == params.end()) {
     PFEXCEPTION_RAISE("BadPage", "Page name " + page + " not a known page.");
   }
   return param_list_it->second;
@@ -76,14 +89,15 @@ const std::vector<std::string>& pftool::State::roc_param_names(
 
 const std::vector<std::string>& pftool::State::econ_page_names(
     pflib::ECON& econ) const {
-  return econ_page_names_.at(econ.type());
+  return names(econ.type()).pages;
 }
 
 const std::vector<std::string>& pftool::State::econ_param_names(
     pflib::ECON& econ, const std::string& page) const {
   auto PAGE{pflib::upper_cp(page)};
-  auto param_list_it = econ_param_names_.at(econ.type()).find(PAGE);
-  if (param_list_it == econ_param_names_.at(econ.type()).end()) {
+  const auto& params{names(econ.type()).params};
+  auto param_list_it = params.find(PAGE);
+  if (param_list_it == params.end()) {
     PFEXCEPTION_RAISE("BadPage", "Page name " + page + " not a known page.");
   }
   return param_list_it->second;
@@ -298,6 +312,18 @@ int main(int argc, char* argv[]) {
         pftool_params.get<std::string>("runnumber_file");
   }
 
+  if (pftool_params.exists("compile_cache")) {
+    // cache compiled configurations on disk, size is in MB
+    pflib::CompileCache::enable(
+        pftool_params.get<std::string>("compile_cache"),
+        std::uintmax_t(pftool_params.get<int>("compile_cache_size", 64))
+            << 20);
+  }
+
+  // build tab-completion names for all chips at startup (in parallel)
+  // instead of when each chip type is first used
+  bool eager_init = (pftool_params.get<int>("eager_init", 0) != 0);
+
   if (not configuration.exists("target")) {
     std::cerr << "Need to define a 'target' in the configuration." << std::endl;
     return 3;
@@ -311,6 +337,7 @@ int main(int argc, char* argv[]) {
   }
 
   auto target_type{target.get<std::string>("type")};
+  auto start_connect{std::chrono::steady_clock::now()};
   std::unique_ptr<Target> tgt;
   int readout_cfg = -1;
   try {
@@ -383,6 +410,15 @@ int main(int argc, char* argv[]) {
       pflib_log(fatal) << "Target type '" << target_type << "' requires Rogue.";
       return 1;
 #endif
+    } else if (target_type == "Emulated") {
+      auto nrocs = target.get<int>("nrocs", 1);
+      auto roc_type = target.get<std::string>("roc_type", "sipm_rocv3b");
+      auto seed = target.get<int>("seed", 0);
+      pflib_log(info) << "emulating " << nrocs << " " << roc_type
+                      << " ROCs in software";
+      tgt.reset(pflib::makeTargetEmulated(nrocs, roc_type, seed));
+      readout_cfg = pftool::State::CFG_HCALFMC;
+      pftool::root()->hide(NEED_FIBER);
     } else {
       pflib_log(fatal) << "Target type '" << target_type << "' not recognized.";
       return 1;
@@ -396,9 +432,20 @@ int main(int argc, char* argv[]) {
    * Run tool
    ****************************************************************************/
   try {
-    pftool::state.init(tgt.get(), readout_cfg);
+    auto start_init{std::chrono::steady_clock::now()};
+    pftool::state.init(tgt.get(), readout_cfg, eager_init);
     pftool::set_history_filepath("~/.pftool-history");
+    auto start_status{std::chrono::steady_clock::now()};
     status(tgt.get());
+    auto end_status{std::chrono::steady_clock::now()};
+    auto ms = [](auto begin, auto end) {
+      return std::chrono::duration<double, std::milli>(end - begin).count();
+    };
+    pflib_log(debug) << "startup took " << ms(start_connect, end_status)
+                     << " ms: connect " << ms(start_connect, start_init)
+                     << " ms, state init" << (eager_init ? " (eager) " : " ")
+                     << ms(start_init, start_status) << " ms, status "
+                     << ms(start_status, end_status) << " ms";
     pftool::run(tgt.get());
   } catch (const std::exception& e) {
     pflib_log(fatal) << "Unrecognized Exception : " << e.what();
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "pflib/ECON.h"
 #include "pflib/Target.h"
 #include "pflib/logging/Logging.h"
@@ -55,22 +57,38 @@ class pftool : public pflib::menu::Menu<Target*> {
     static constexpr int CFG_ECALOPTO_BW = 22;
 
    private:
-    /// list of page names for tab completion per ROC ID
-    std::map<int, std::vector<std::string>> roc_page_names_;
-    /// list of parameter names for tab-completion per ROC ID
-    std::map<int, std::map<std::string, std::vector<std::string>>>
-        roc_param_names_;
-    /// list of page names for tab completion per ECON type
-    std::map<std::string, std::vector<std::string>> econ_page_names_;
-    /// list of parameter names for tab-completion per ECON type
-    std::map<std::string, std::map<std::string, std::vector<std::string>>>
-        econ_param_names_;
+    /// page and parameter names of a single chip type for tab completion
+    struct Names {
+      /// list of page names
+      std::vector<std::string> pages;
+      /// list of parameter names per page
+      std::map<std::string, std::vector<std::string>> params;
+    };
+    /// names per chip type, filled on first use of that type
+    mutable std::map<std::string, Names> names_;
+    /// protect names_ while it is being filled in parallel
+    mutable std::mutex names_mutex_;
+    /// get the names for a chip type, building them if necessary
+    const Names& names(const std::string& type) const;
+    /// the target we are connected to
+    Target* tgt_{nullptr};
     /// readout configuration
     int cfg_;
 
    public:
-    /// initialize the state with a Target
-    void init(Target* tgt, int readout_config);
+    /**
+     * initialize the state with a Target
+     *
+     * The page and parameter names used for tab completion are only
+     * built the first time a chip type is interacted with unless
+     * eager is true. In that case, they are built for all the chip
+     * types on the target in parallel.
+     *
+     * @param[in] tgt target that pftool is connected to
+     * @param[in] readout_config readout configuration of target
+     * @param[in] eager build the names for all chip types now
+     */
+    void init(Target* tgt, int readout_config, bool eager = false);
     /// get page names for tab completion
     const std::vector<std::string>& roc_page_names() const;
     /// get the parameter names for tab completion
@@ -42,6 +42,8 @@ static void roc_expert_render(Target* tgt) {
  * - DIRECT_ACCESS_PARAMETERS : prints all direct access parameters in the ROC
  * - GET_DIRECT_ACCESS : print direct access parameters and their values
  * - SET_DIRECT_ACCESS : set direct access parameter to specific value
+ * - SHADOW : enable/disable the register shadow pflib::ROC::enableShadow
+ * - REFRESH : re-read the register shadow from the chip pflib::ROC::refresh
  */
 static void roc_expert(const std::string& cmd, Target* tgt) {
   auto roc = tgt->roc(pftool::state.iroc);
@@ -95,6 +97,26 @@ static void roc_expert(const std::string& cmd, Target* tgt) {
     bool val = pftool::readline_bool("On/Off: ", true);
     roc.setDirectAccess(name, val);
   }
+  if (cmd == "SHADOW") {
+    bool enable =
+        pftool::readline_bool("Use register shadow? ", roc.hasShadow());
+    if (enable) {
+      bool verify = pftool::readline_bool(
+          "Verify shadow against chip on every read? ", roc.shadowVerify());
+      roc.enableShadow(verify);
+    } else {
+      roc.disableShadow();
+    }
+  }
+  if (cmd == "REFRESH") {
+    if (not roc.hasShadow()) {
+      std::cout << "Register shadow is not enabled for this ROC." << std::endl;
+    } else {
+      int n_changed = roc.refresh();
+      std::cout << n_changed << " registers differed from the shadow."
+                << std::endl;
+    }
+  }
 }
 
 /**
@@ -112,7 +134,10 @@ static void roc_expert(const std::string& cmd, Target* tgt) {
  * - PAGE : pflib::ROC::readPage
  * - PARAM_NAMES : Use pflib::parameters to get list ROC parameter names
  * - POKE : pflib::ROC::setValue
+ * - POKE_ALL : pflib::Target::broadcastParameters for a single parameter
  * - LOAD : pflib::ROC::loadParameters
+ * - LOAD_ALL : pflib::Target::loadParameters for several ROCs at once
+ * - LOAD_SAME : pflib::Target::broadcastParameters with one file for all ROCs
  * - DUMP : pflib::ROC::dumpSettings with decompile=true
  *
  * @param[in] cmd ROC command
@@ -121,6 +146,11 @@ static void roc_expert(const std::string& cmd, Target* tgt) {
 static void roc(const std::string& cmd, Target* pft) {
   if (cmd == "HARDRESET") {
     pft->hardResetROCs();
+    // chip registers are back to power-on values
+    for (int id : pft->roc_ids()) {
+      pflib::ROC& r{pft->roc(id)};
+      if (r.hasShadow()) r.refresh();
+    }
   }
   if (cmd == "SOFTRESET") {
     pft->softResetROC();
@@ -166,6 +196,15 @@ static void roc(const std::string& cmd, Target* pft) {
     int val = pftool::readline_int("New value: ");
     roc.applyParameter(page, param, val);
   }
+  if (cmd == "POKE_ALL") {
+    auto page = pftool::readline("Page: ", pftool::state.roc_page_names());
+    auto param =
+        pftool::readline("Parameter: ", pftool::state.roc_param_names(page));
+    int val = pftool::readline_int("New value: ");
+    int n_skipped = pft->broadcastParameters({{page, {{param, val}}}});
+    pflib_log(debug) << "skipped " << n_skipped
+                     << " register writes across all ROCs";
+  }
   if (cmd == "LOAD") {
     std::cout << "\n"
                  " --- This command expects a YAML file with page names, "
@@ -178,6 +217,40 @@ static void roc(const std::string& cmd, Target* pft) {
         false);
     roc.loadParameters(fname, prepend_defaults);
   }
+  if (cmd == "LOAD_ALL") {
+    std::cout << "\n"
+                 " --- Provide a YAML file for each ROC, leave empty to skip "
+                 "that ROC.\n"
+                 " --- ROCs on independent I2C buses are loaded at the same "
+                 "time.\n"
+              << std::flush;
+    std::map<int, std::string> files;
+    for (int id : pft->roc_ids()) {
+      std::string fname =
+          pftool::readline("Filename for ROC " + std::to_string(id) + ": ");
+      if (not fname.empty()) files[id] = fname;
+    }
+    bool prepend_defaults = pftool::readline_bool(
+        "Update all parameter values on the chips using the defaults in the "
+        "manual for any values not provided? ",
+        false);
+    pft->loadParameters(files, {}, prepend_defaults);
+  }
+  if (cmd == "LOAD_SAME") {
+    std::cout << "\n"
+                 " --- This command expects a YAML file with page names, "
+                 "parameter names and their values.\n"
+                 " --- The file is compiled once and loaded onto every ROC.\n"
+              << std::flush;
+    std::string fname = pftool::readline("Filename: ");
+    bool prepend_defaults = pftool::readline_bool(
+        "Update all parameter values on the chips using the defaults in the "
+        "manual for any values not provided? ",
+        false);
+    int n_skipped = pft->broadcastParameters(fname, prepend_defaults);
+    pflib_log(debug) << "skipped " << n_skipped
+                     << " register writes across all ROCs";
+  }
   if (cmd == "DUMP") {
     std::string fname = pftool::readline_path(
         "hgcroc_" + std::to_string(pftool::state.iroc) + "_settings", ".yaml");
@@ -196,8 +269,13 @@ auto menu_roc =
         ->line("PAGE", "a page of the parameters on the chip", roc)
         ->line("PARAM_NAMES", "Print a list of parameters on a page", roc)
         ->line("POKE", "change a single parameter value", roc)
+        ->line("POKE_ALL", "change a single parameter value on all ROCs", roc)
         ->line("LOAD", "Load parameter values onto the chip from a YAML file",
                roc)
+        ->line("LOAD_ALL",
+               "Load parameter values onto several chips from YAML files", roc)
+        ->line("LOAD_SAME", "Load one YAML file of parameters onto all ROCs",
+               roc)
         ->line("DUMP", "Dump hgcroc settings to a file", roc);
 
 auto menu_roc_expert =
@@ -214,5 +292,9 @@ auto menu_roc_expert =
         ->line("GET_DIRECT_ACCESS",
                "print out values of direct access parameters", roc_expert)
         ->line("SET_DIRECT_ACCESS", "set direct access parameter bits",
+               roc_expert)
+        ->line("SHADOW", "enable/disable the in-memory register shadow",
+               roc_expert)
+        ->line("REFRESH", "re-read the register shadow from the chip",
                roc_expert);
 }  // namespace
@@ -57,13 +57,18 @@ static void gen_scan_writer(Target* tgt, pflib::ROC& roc, size_t nevents,
       },
       n_links};
 
+  // look up the parameters once instead of at every point
+  std::vector<pflib::ParameterHandle> params;
+  for (const auto& [page, parameter] : param_names) {
+    params.push_back(roc.resolve(page, parameter));
+  }
+
   tgt->setup_run(1 /* dummy - not stored */, pftool::state.daq_format_mode,
                  1 /* dummy */);
   for (; i_param_point < param_values.size(); i_param_point++) {
     auto test_param_builder = roc.testParameters();
-    for (std::size_t i_param{0}; i_param < param_names.size(); i_param++) {
-      test_param_builder.add(param_names[i_param].first,
-                             param_names[i_param].second,
+    for (std::size_t i_param{0}; i_param < params.size(); i_param++) {
+      test_param_builder.add(params[i_param],
                              param_values[i_param_point][i_param]);
     }
     auto test_param = test_param_builder.apply();
@@ -0,0 +1,107 @@
+/**
+ * @file extract.cxx
+ * Benchmark extracting large settings files with Compiler::extract
+ *
+ * The files are the full defaults of a chip written out page by page
+ * (like pfdefaults does) and a version of the same settings using a
+ * wildcard for each family of numbered pages (e.g. CH_*).
+ */
+
+#include <yaml-cpp/yaml.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+#include "pflib/Compile.h"
+#include "pflib/CompileCache.h"
+
+using Settings = std::map<std::string, std::map<std::string, uint64_t>>;
+
+/// write the settings as YAML into a file in the temporary directory
+static std::string write(const std::string& name, const Settings& settings) {
+  YAML::Emitter out;
+  out << YAML::BeginMap;
+  for (const auto& [page, params] : settings) {
+    out << YAML::Key << page << YAML::Value << YAML::BeginMap;
+    for (const auto& [param, val] : params) {
+      out << YAML::Key << param << YAML::Value << val;
+    }
+    out << YAML::EndMap;
+  }
+  out << YAML::EndMap;
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::ofstream f{path};
+  f << out.c_str() << std::endl;
+  return path.string();
+}
+
+/// replace numbered pages with a single wildcard page
+static Settings wildcards(const Settings& settings) {
+  Settings globbed;
+  for (const auto& [page, params] : settings) {
+    auto end = page.find_last_not_of("0123456789");
+    if (end + 1 == page.size()) {
+      globbed[page] = params;
+    } else if (globbed.find(page.substr(0, end + 1) + "*") == globbed.end()) {
+      globbed[page.substr(0, end + 1) + "*"] = params;
+    }
+  }
+  return globbed;
+}
+
+/// time the input function, returning the mean milliseconds per call
+template <typename F>
+static double time_it(int n, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i{0}; i < n; i++) f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+  int n_iter = argc > 1 ? std::stoi(argv[1]) : 20;
+  // measure the full work, not the compile cache
+  pflib::CompileCache::disable();
+
+  for (const std::string type : {"sipm_rocv3b", "si_rocv3b", "econd"}) {
+    auto c = pflib::Compiler::get(type);
+    Settings defaults = c.defaults();
+    std::size_t n_params{0};
+    for (const auto& page : defaults) n_params += page.second.size();
+
+    std::string full = write("pflib-bench-" + type + "-full.yaml", defaults);
+    std::string glob =
+        write("pflib-bench-" + type + "-glob.yaml", wildcards(defaults));
+
+    for (const auto& [label, file] : {std::make_pair("full", full),
+                                      std::make_pair("glob", glob)}) {
+      double extract_ms = time_it(n_iter, [&]() {
+        Settings settings;
+        c.extract({file}, settings);
+      });
+      double compile_ms = time_it(n_iter, [&]() {
+        auto image = c.compile_image({file}, false);
+      });
+      std::cout << type << " " << label << " (" << defaults.size()
+                << " pages, " << n_params << " parameters): extract "
+                << extract_ms << " ms, extract+compile " << compile_ms
+                << " ms" << std::endl;
+    }
+
+    std::set<std::string> patterns;
+    for (const auto& page : wildcards(defaults)) patterns.insert(page.first);
+    double match_us = time_it(n_iter * 100, [&]() {
+                        for (const auto& p : patterns) c.match_pages(p);
+                      }) *
+                      1000 / patterns.size();
+    std::cout << type << " match_pages: " << match_us << " us per pattern"
+              << std::endl;
+
+    std::filesystem::remove(full);
+    std::filesystem::remove(glob);
+  }
+  return 0;
+}
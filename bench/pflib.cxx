@@ -0,0 +1,304 @@
+/**
+ * @file pflib.cxx
+ * Micro-benchmarks of the decoding and configuration hot paths
+ *
+ * The events are generated before timing with the emulated target
+ * (sim::EmulatedTarget) in the SIMPLEROC and ECON-D formats. Each
+ * benchmark runs over these events repeatedly until it has run for the
+ * minimum time and reports events/s, MB/s of input, and the number of
+ * heap allocations per event (counted by replacing operator new).
+ * Configure with -DCMAKE_BUILD_TYPE=Release when comparing numbers.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <nlohmann/json.hpp>
+
+#include "pflib/Compile.h"
+#include "pflib/ECOND_Formatter.h"
+#include "pflib/logging/Logging.h"
+#include "pflib/packing/DAQLinkFrame.h"
+#include "pflib/packing/ECONDEventPacket.h"
+#include "pflib/packing/MultiSampleECONDEventPacket.h"
+#include "pflib/packing/SingleROCEventPacket.h"
+#include "pflib/sim/EmulatedTarget.h"
+#include "pflib/utility/crc.h"
+#include "pflib/version/Version.h"
+
+/// number of heap allocations so far
+static std::atomic<uint64_t> n_allocs{0};
+
+void* operator new(std::size_t size) {
+  n_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+/// measurement of one benchmark
+struct Result {
+  std::string name;
+  uint64_t n_events;
+  double seconds;
+  uint64_t bytes;
+  uint64_t allocs;
+  double events_per_s() const { return n_events / seconds; }
+  double mb_per_s() const { return bytes / seconds / 1e6; }
+  double allocs_per_event() const { return double(allocs) / n_events; }
+};
+
+/// keep the compiler from dropping the work we are timing
+static volatile uint64_t sink;
+
+/**
+ * run the input function over the events until the minimum time passed
+ *
+ * @param[in] name name of the benchmark
+ * @param[in] n_inputs number of different events to cycle through
+ * @param[in] bytes size of each of the events in bytes
+ * @param[in] min_seconds minimum time to run for
+ * @param[in] f function processing event i, returning something to sink
+ */
+static Result run(const std::string& name, std::size_t n_inputs,
+                  std::function<std::size_t(std::size_t)> bytes,
+                  double min_seconds,
+                  std::function<uint64_t(std::size_t)> f) {
+  Result r{name, 0, 0., 0, 0};
+  // warm up caches and lazily built lookup tables
+  for (std::size_t i{0}; i < n_inputs; i++) sink = sink + f(i);
+  uint64_t allocs_start = n_allocs.load();
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (std::size_t i{0}; i < n_inputs; i++) {
+      sink = sink + f(i);
+      r.bytes += bytes(i);
+    }
+    r.n_events += n_inputs;
+    r.seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  } while (r.seconds < min_seconds);
+  r.allocs = n_allocs.load() - allocs_start;
+  return r;
+}
+
+static void usage() {
+  std::cout << "\n"
+               " USAGE:\n"
+               "  bench-pflib [options] [filter ...]\n"
+               "\n"
+               "  Run the benchmarks whose name contains one of the filters "
+               "(all if none).\n"
+               "\n"
+               " OPTIONS:\n"
+               "  -h,--help     : Print this help and exit\n"
+               "  -j,--json     : Print the results as JSON\n"
+               "  -t,--min-time : Minimum seconds to run each benchmark "
+               "(default 0.5)\n"
+               "  -n,--events   : Number of different events to generate "
+               "(default 256)\n"
+            << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  pflib::logging::fixture f;
+  // the decoders print each word at info level, keep that out of the timing
+  pflib::logging::set(pflib::logging::level::warn);
+  bool json{false};
+  double min_seconds{0.5};
+  int n_events{256};
+  std::vector<std::string> filters;
+  for (int i_arg{1}; i_arg < argc; i_arg++) {
+    std::string arg{argv[i_arg]};
+    if (arg == "-h" or arg == "--help") {
+      usage();
+      return 0;
+    } else if (arg == "-j" or arg == "--json") {
+      json = true;
+    } else if (arg == "-t" or arg == "--min-time" or arg == "-n" or
+               arg == "--events") {
+      if (i_arg + 1 == argc) {
+        std::cerr << arg << " requires an argument after it." << std::endl;
+        return 1;
+      }
+      i_arg++;
+      if (arg == "-t" or arg == "--min-time") {
+        min_seconds = std::stod(argv[i_arg]);
+      } else {
+        n_events = std::stoi(argv[i_arg]);
+      }
+    } else if (arg[0] == '-') {
+      std::cerr << arg << " not a recognized argument." << std::endl;
+      return 1;
+    } else {
+      filters.push_back(arg);
+    }
+  }
+  auto selected = [&](const std::string& name) {
+    if (filters.empty()) return true;
+    for (const auto& f : filters) {
+      if (name.find(f) != std::string::npos) return true;
+    }
+    return false;
+  };
+
+  using pflib::packing::DAQLinkFrame;
+  using pflib::packing::SingleROCEventPacket;
+
+  /*
+   * Generate events, with charge injected into a few channels of
+   * every other event so the ADC values and codes vary
+   */
+  pflib::sim::EmulatedTarget roc_tgt(1, "sipm_rocv3b", 1);
+  pflib::sim::EmulatedTarget econ_tgt(3, "sipm_rocv3b", 2);
+  for (pflib::sim::EmulatedTarget* tgt : {&roc_tgt, &econ_tgt}) {
+    for (int iroc : tgt->roc_ids()) {
+      tgt->roc(iroc).applyParameters(
+          {{"REFERENCEVOLTAGE_0", {{"INTCTEST", 1}, {"CALIB", 600}}},
+           {"REFERENCEVOLTAGE_1", {{"INTCTEST", 1}, {"CALIB", 600}}},
+           {"CH_5", {{"HIGHRANGE", 1}}},
+           {"CH_40", {{"HIGHRANGE", 1}}},
+           {"CH_60", {{"LOWRANGE", 1}}}});
+    }
+  }
+  const int n_samples{3}, n_erx{2 * econ_tgt.nrocs()};
+  roc_tgt.setup_run(1, pflib::Target::DaqFormat::SIMPLEROC);
+  econ_tgt.daq().setup(1, n_samples, 1);
+  econ_tgt.fc().setL1AperROR(n_samples);
+  econ_tgt.setup_run(1, pflib::Target::DaqFormat::ECOND_SW_HEADERS);
+  std::vector<std::vector<uint32_t>> simpleroc, link_frames, multisample,
+      econd;
+  for (int i{0}; i < n_events; i++) {
+    for (pflib::sim::EmulatedTarget* tgt : {&roc_tgt, &econ_tgt}) {
+      if (i % 2) {
+        tgt->fc().chargepulse();
+      } else {
+        tgt->fc().sendROR();
+      }
+    }
+    simpleroc.push_back(roc_tgt.read_event());
+    // first DAQ link frame after the software header and the lengths
+    const auto& ev{simpleroc.back()};
+    auto first_link = ev.begin() + SingleROCEventPacket::N_SW_WORDS +
+                      SingleROCEventPacket::N_LENGTH_WORDS;
+    link_frames.emplace_back(first_link, first_link + DAQLinkFrame::N_WORDS);
+    multisample.push_back(econ_tgt.read_event());
+    // ECON-D packet of the first sample after its software header
+    const auto& ms{multisample.back()};
+    econd.emplace_back(ms.begin() + 1, ms.begin() + 1 + (ms[0] & 0xFFF));
+  }
+  auto size_of = [](const std::vector<std::vector<uint32_t>>& events) {
+    return [&events](std::size_t i) { return 4 * events[i].size(); };
+  };
+
+  std::vector<Result> results;
+  auto bench = [&](const std::string& name, std::size_t n_inputs,
+                   std::function<std::size_t(std::size_t)> bytes,
+                   std::function<uint64_t(std::size_t)> f) {
+    if (not selected(name)) return;
+    results.push_back(run(name, n_inputs, bytes, min_seconds, f));
+    if (not json) {
+      const Result& r{results.back()};
+      std::cout << std::left << std::setw(32) << r.name << std::right
+                << std::setw(14) << std::fixed << std::setprecision(0)
+                << r.events_per_s() << " events/s " << std::setw(10)
+                << std::setprecision(1) << r.mb_per_s() << " MB/s "
+                << std::setw(8) << std::setprecision(2)
+                << r.allocs_per_event() << " allocs/event" << std::endl;
+    }
+  };
+
+  // the CRC is computed over all but the last word of the frame
+  bench("crc32", link_frames.size(),
+        [](std::size_t) { return 4 * (DAQLinkFrame::N_WORDS - 1); },
+        [&](std::size_t i) {
+          return pflib::utility::crc32(
+              std::span(link_frames[i].begin(), DAQLinkFrame::N_WORDS - 1));
+        });
+
+  pflib::packing::DAQLinkFrame link_frame;
+  bench("DAQLinkFrame::from", link_frames.size(), size_of(link_frames),
+        [&](std::size_t i) {
+          link_frame.from(link_frames[i]);
+          return link_frame.channels[0].word;
+        });
+
+  pflib::packing::SingleROCEventPacket roc_packet;
+  bench("SingleROCEventPacket::from", simpleroc.size(), size_of(simpleroc),
+        [&](std::size_t i) {
+          roc_packet.from(
+              std::span(simpleroc[i].begin() + SingleROCEventPacket::N_SW_WORDS,
+                        simpleroc[i].end() - SingleROCEventPacket::N_SW_WORDS));
+          return roc_packet.daq_links[0].channels[0].word;
+        });
+
+  pflib::packing::ECONDEventPacket econd_packet(n_erx);
+  bench("ECONDEventPacket::from", econd.size(), size_of(econd),
+        [&](std::size_t i) {
+          econd_packet.from(econd[i]);
+          return econd_packet.links[0].channels[0].word;
+        });
+
+  bench("MultiSampleECONDEventPacket::from", multisample.size(),
+        size_of(multisample), [&](std::size_t i) {
+          pflib::packing::MultiSampleECONDEventPacket ep(n_erx);
+          ep.from(multisample[i]);
+          return ep.samples.size();
+        });
+
+  pflib::ECOND_Formatter formatter;
+  bench("ECOND_Formatter", link_frames.size(), size_of(link_frames),
+        [&](std::size_t i) {
+          formatter.startEvent(i, i, 0);
+          for (int i_erx{0}; i_erx < n_erx; i_erx++) {
+            formatter.add_elink_packet(
+                i_erx, link_frames[(i + i_erx) % link_frames.size()]);
+          }
+          formatter.finishEvent();
+          return formatter.getPacket().size();
+        });
+
+  std::ofstream csv{"/dev/null"};
+  bench("Sample::to_csv", link_frames.size(),
+        [](std::size_t) { return 4 * 36; },
+        [&](std::size_t i) {
+          link_frame.from(link_frames[i]);
+          for (const auto& s : link_frame.channels) s.to_csv(csv);
+          return uint64_t(0);
+        });
+
+  auto compiler = pflib::Compiler::get("sipm_rocv3b");
+  auto defaults = compiler.defaults();
+  auto image = compiler.compile_image(defaults);
+  bench("Compiler::compile_image", 1,
+        [&](std::size_t) { return image.size(); },
+        [&](std::size_t) { return compiler.compile_image(defaults).size(); });
+  bench("Compiler::decompile", 1, [&](std::size_t) { return image.size(); },
+        [&](std::size_t) { return compiler.decompile(image, false).size(); });
+
+  if (json) {
+    nlohmann::json out;
+    out["version"] = pflib::version::debug();
+    out["min_time"] = min_seconds;
+    out["n_events"] = n_events;
+    out["benchmarks"] = nlohmann::json::array();
+    for (const auto& r : results) {
+      out["benchmarks"].push_back({{"name", r.name},
+                                   {"events", r.n_events},
+                                   {"seconds", r.seconds},
+                                   {"bytes", r.bytes},
+                                   {"events_per_s", r.events_per_s()},
+                                   {"mb_per_s", r.mb_per_s()},
+                                   {"allocs_per_event", r.allocs_per_event()}});
+    }
+    std::cout << out.dump(2) << std::endl;
+  }
+  return 0;
+}
@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 
+#include "pflib/RegisterImage.h"
 #include "pflib/logging/Logging.h"
 #include "pflib/utility/str_to_int.h"
 
@@ -33,6 +34,7 @@ class Parameter;
 using Page = NoCopyMap<std::string, Parameter>;
 using PageLUT = NoCopyMap<std::string, const Page&>;
 using ParameterLUT = NoCopyMap<std::string, std::pair<int, const Page&>>;
+struct RegisterMap;
 
 namespace pflib {
 
@@ -41,6 +43,102 @@ namespace pflib {
  */
 std::string upper_cp(const std::string& str);
 
+/**
+ * A parameter whose register locations have already been looked up
+ *
+ * Obtained from Compiler::resolve, a handle can encode values into
+ * registers without any string handling or LUT lookups. This is
+ * helpful when the same parameter is set many times like in a scan.
+ *
+ * ```cpp
+ * auto trim_inv = compiler.resolve("CH_17", "TRIM_INV");
+ * pflib::RegisterImage image;
+ * for (uint64_t val{0}; val < 64; val++) {
+ *   trim_inv.encode(val, image);
+ *   // write image onto chip...
+ * }
+ * ```
+ */
+class ParameterHandle {
+ public:
+  /// page number the parameter is on
+  int page() const { return page_; }
+  /// total number of bits in the parameter
+  int nbits() const { return nbits_; }
+  /// page name the parameter was resolved with
+  const std::string& page_name() const { return page_name_; }
+  /// parameter name the parameter was resolved with
+  const std::string& param_name() const { return param_name_; }
+
+  /**
+   * Overlay the value onto the registers of the image
+   *
+   * Only the bits of this parameter are changed.
+   *
+   * @throw pflib::Exception if the value does not fit in the parameter
+   *
+   * @param[in] val value of parameter
+   * @param[in,out] registers image to overlay the value onto
+   */
+  void encode(uint64_t val, RegisterImage& registers) const;
+
+  /// overlay the value onto the registers of the nested map
+  void encode(uint64_t val,
+              std::map<int, std::map<int, uint8_t>>& registers) const;
+
+  /**
+   * Extract the value of the parameter from the image
+   *
+   * Registers missing from the image are taken to be zero.
+   *
+   * @param[in] registers image to read the value from
+   * @return value of parameter
+   */
+  uint64_t decode(const RegisterImage& registers) const;
+
+ private:
+  friend class Compiler;
+  /// where a slice of the parameter lives
+  struct Location {
+    /// register number in page
+    int reg;
+    /// bit in register where slice starts
+    int min_bit;
+    /// mask of slice (not shifted)
+    uint8_t mask;
+    /// bit in parameter value where slice starts
+    int value_bit;
+  };
+  /// throw the exception for a value that doesn't fit
+  [[noreturn]] void value_too_large(uint64_t val) const;
+
+  int page_{0};
+  int nbits_{0};
+  std::vector<Location> locations_;
+  std::string page_name_;
+  std::string param_name_;
+};
+
+/**
+ * A parameter whose value differs between two configurations
+ *
+ * @see Compiler::diff
+ */
+struct ParameterDiff {
+  /// name of page
+  std::string page;
+  /// name of parameter
+  std::string param;
+  /// value in the first configuration
+  uint64_t a;
+  /// value in the second configuration
+  uint64_t b;
+  /// the parameter could be deduced from the first configuration
+  bool in_a;
+  /// the parameter could be deduced from the second configuration
+  bool in_b;
+};
+
 /**
  * The object that does the compiling
  *
@@ -95,6 +193,19 @@ class Compiler {
                const uint64_t& val,
                std::map<int, std::map<int, uint8_t>>& registers);
 
+  /**
+   * Overlay a single parameter onto the input register image
+   *
+   * @see compile for the map version
+   *
+   * @param[in] page name of page parameter is on
+   * @param[in] param name of parameter
+   * @param[in] val value parameter should be
+   * @param[in,out] registers image to apply parameter to
+   */
+  void compile(const std::string& page, const std::string& param,
+               const uint64_t& val, RegisterImage& registers);
+
   /**
    * Compile a single parameter into the (potentially several)
    * registers that it should set. Any other bits in the register(s)
@@ -139,6 +250,45 @@ class Compiler {
   std::map<int, std::map<int, uint8_t>> compile(
       const std::map<std::string, std::map<std::string, uint64_t>>& settings);
 
+  /**
+   * Compile the settings into a register image
+   *
+   * This is what the map-returning compile uses underneath and
+   * should be preferred when many parameters are compiled.
+   *
+   * @param[in] settings page names, parameter names, and parameter value
+   * settings
+   * @return image of the registers touched by the settings
+   */
+  RegisterImage compile_image(
+      const std::map<std::string, std::map<std::string, uint64_t>>& settings);
+
+  /**
+   * Compile settings and record which bits of the registers they set
+   *
+   * Registers whose bits are not all covered by the mask need the
+   * values of the other bits from the chip before they can be written.
+   *
+   * @param[in] settings page names, parameter names, and parameter value
+   * settings
+   * @param[out] mask for each register touched, the bits set by the settings
+   * @return image of the registers touched by the settings
+   */
+  RegisterImage compile_image(
+      const std::map<std::string, std::map<std::string, uint64_t>>& settings,
+      RegisterImage& mask);
+
+  /**
+   * Look up a parameter once so it can be compiled many times
+   *
+   * @throw pflib::Exception if the page or parameter does not exist
+   *
+   * @param[in] page name of page parameter is on (case insensitive)
+   * @param[in] param name of parameter (case insensitive)
+   * @return handle to encode values of this parameter
+   */
+  ParameterHandle resolve(const std::string& page, const std::string& param);
+
   std::map<uint16_t, size_t> build_register_byte_lut();
 
   /**
@@ -177,6 +327,57 @@ class Compiler {
       const std::map<int, std::map<int, uint8_t>>& compiled_config,
       bool be_careful, bool little_endian = false);
 
+  /**
+   * unpack a register image into parameter values
+   *
+   * @see decompile for the map version
+   *
+   * @param[in] compiled_config image of register values
+   * @param[in] be_careful true if we should print warnings and skip
+   * partially-set params
+   * @return page name, parameter name, parameter value of registers provided
+   */
+  std::map<std::string, std::map<std::string, uint64_t>> decompile(
+      const RegisterImage& compiled_config, bool be_careful,
+      bool little_endian = false);
+
+  /**
+   * unpack only the parameters that use the provided registers
+   *
+   * The parameters using each register are looked up in an index that
+   * is built the first time any compiler for this chip type decompiles,
+   * so the work done is proportional to the number of registers provided
+   * instead of the number of parameters in the register map. This is
+   * what decompile does when be_careful is false.
+   *
+   * @param[in] compiled_config image of register values
+   * @param[in] little_endian registers of multi-register parameters
+   * are combined as a little-endian integer
+   * @return page name, parameter name, parameter value of parameters
+   * using any of the provided registers
+   */
+  std::map<std::string, std::map<std::string, uint64_t>> decompile_partial(
+      const RegisterImage& compiled_config, bool little_endian = false);
+
+  /**
+   * Find the parameters that differ between two configurations
+   *
+   * The registers are compared first and then only the parameters
+   * using the registers that differ (or are only in one of the images)
+   * are decompiled, so this is fast when the configurations are close.
+   * A parameter that cannot be deduced from one of the images (none of
+   * its registers are present) is reported with in_a or in_b false.
+   *
+   * @param[in] a first configuration
+   * @param[in] b second configuration
+   * @param[in] little_endian registers of multi-register parameters
+   * are combined as a little-endian integer
+   * @return parameters with different values, in page and parameter order
+   */
+  std::vector<ParameterDiff> diff(const RegisterImage& a,
+                                  const RegisterImage& b,
+                                  bool little_endian = false);
+
   /**
    * get the registers corresponding to the input page
    *
@@ -263,12 +464,135 @@ class Compiler {
   std::map<int, std::map<int, uint8_t>> compile(const std::string& setting_file,
                                                 bool prepend_defaults = true);
 
+  /**
+   * compile a series of yaml files into a register image
+   *
+   * If a CompileCache is enabled, the image is loaded from it when
+   * the same file contents have been compiled for this chip type and
+   * register map before and stored in it otherwise.
+   *
+   * @see compile(const std::vector<std::string>&, bool)
+   *
+   * @param[in] setting_files list of YAML files to extract in order and compile
+   * @param[in] prepend_defaults start construction of settings map by including
+   *    defaults from **all** parameter settings
+   * @return image of the registers set by the files
+   */
+  RegisterImage compile_image(const std::vector<std::string>& setting_files,
+                              bool prepend_defaults = true);
+
+  /// the chip type_version this compiler is for
+  const std::string& type() const { return type_; }
+
+  /**
+   * Hash of the contents of the register map
+   *
+   * This changes whenever a page, parameter, default, or register
+   * location changes, so it can be used to invalidate compiled
+   * configurations.
+   */
+  uint64_t register_map_version() const;
+
+  /**
+   * Number of registers spanned by each page of the register map
+   *
+   * This is one past the highest register any parameter on the page
+   * uses, so it is at most ROC::N_REGISTERS_PER_PAGE for the HGCROC.
+   * Compiled images never hold registers outside of these.
+   *
+   * @return map of page number to number of registers
+   */
+  const std::map<int, int>& page_sizes() const;
+
+  /// entry in the ParameterLUT for a single page
+  using PageEntry = std::pair<const std::string, std::pair<int, const Page&>>;
+
+  /**
+   * Find the position of a page in the LUT
+   *
+   * This uses the perfect hash generated alongside the register map
+   * if it is available and a binary search otherwise.
+   *
+   * @param[in] PAGE name of page (already in all caps)
+   * @return position of page or -1 if it doesn't exist
+   */
+  int page_index(const std::string& PAGE) const;
+
+  /**
+   * Find the pages matching a page name from a settings file
+   *
+   * The match is case insensitive. If the name contains a '*', it
+   * matches all pages starting with the text before the '*', otherwise
+   * it needs to match the whole page name. Prefix matches are found
+   * with a binary search over the page names sorted when the register
+   * map is first used.
+   *
+   * @param[in] pattern page name possibly with a glob character
+   * @return positions of the matching pages in the LUT, in order
+   */
+  std::vector<int> match_pages(const std::string& pattern) const;
+
+  /// the LUT entry for the page at the input position
+  const PageEntry& page_entry(int i_page) const;
+
+  /**
+   * Find a parameter on a page
+   *
+   * @param[in] i_page position of page from page_index
+   * @param[in] PARAM name of parameter (already in all caps)
+   * @return specification of parameter or nullptr if it doesn't exist
+   */
+  const Parameter* find_parameter(int i_page, const std::string& PARAM) const;
+
  private:
   /**
    * Private constructor, only access Compiler instances from the
    * static get method so that we can ensure they are properly configured.
    */
-  Compiler(const ParameterLUT& parameter_lut, const PageLUT& page_lut);
+  Compiler(const std::string& type, const RegisterMap& register_map);
+
+  /**
+   * Look up a parameter and check that the value fits within it
+   *
+   * @throw pflib::Exception if the page or parameter does not exist
+   * or the value is too large
+   *
+   * @param[in] page_name name of page (already in all caps)
+   * @param[in] param_name name of parameter (already in all caps)
+   * @param[in] val value that will be compiled
+   * @param[out] page_id page number of the parameter
+   * @return specification of the parameter
+   */
+  const Parameter& lookup(const std::string& page_name,
+                          const std::string& param_name, const uint64_t& val,
+                          int& page_id);
+
+  /// a parameter (by its LUT entry) on a page (by position)
+  using ParameterRef =
+      std::pair<int, const std::pair<const std::string, Parameter>*>;
+
+  /// parameters using any of the provided registers, in LUT order
+  std::vector<ParameterRef> touched_parameters(
+      const RegisterImage& registers) const;
+
+  /**
+   * Deduce the value of a single parameter from the registers
+   *
+   * @param[in] page_name name of page for printouts
+   * @param[in] page_id page number the parameter is on
+   * @param[in] param_name name of parameter for printouts
+   * @param[in] spec parameter specification
+   * @param[in] compiled_config register values
+   * @param[in] be_careful print warnings and skip partially-set params
+   * @param[in] little_endian combine registers as a little-endian integer
+   * @param[out] pval deduced value
+   * @return true if the parameter could be deduced
+   */
+  bool decompile_parameter(const std::string& page_name, int page_id,
+                           const std::string& param_name,
+                           const Parameter& spec,
+                           const RegisterImage& compiled_config,
+                           bool be_careful, bool little_endian, uint64_t& pval);
 
   /**
    * Extract a map of page_name, param_name to their values by crawling the YAML
@@ -286,8 +610,15 @@ class Compiler {
       std::map<std::string, std::map<std::string, uint64_t>>& settings);
 
  private:
+  std::string type_;
   const ParameterLUT& parameter_lut_;
   const PageLUT& page_lut_;
+  const RegisterMap& register_map_;
+  /// LUT entries in name order, shared by all compilers of this chip type
+  struct Index;
+  const Index* index_;
+  /// get the index of the input register map, building it on first use
+  static const Index& get_index(const RegisterMap& register_map);
   mutable ::pflib::logging::logger the_log_{::pflib::logging::get("compile")};
 };
 }  // namespace pflib
@@ -0,0 +1,83 @@
+#ifndef PFLIB_CompileBatch_H_INCLUDED
+#define PFLIB_CompileBatch_H_INCLUDED
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "pflib/Compile.h"
+
+namespace pflib {
+
+/**
+ * Many compilations or decompilations listed in a manifest
+ *
+ * This is the batch mode shared by pfcompile and pfdecompile. The
+ * manifest is a YAML list of jobs, each with the chip type_version,
+ * the input file(s), the output file, and a flag changing how the job
+ * is done (e.g. if the defaults are prepended). Relative paths are
+ * relative to the directory of the manifest.
+ *
+ * ```yaml
+ * - chip: sipm_rocv3b
+ *   inputs: [common.yaml, roc0.yaml]
+ *   output: roc0.csv
+ * ```
+ */
+namespace batch {
+
+/// one job listed in a manifest
+struct Job {
+  /// chip type_version
+  std::string chip;
+  /// input files in order
+  std::vector<std::string> inputs;
+  /// output file
+  std::string output;
+  /// value of the flag of the job
+  bool flag;
+};
+
+/**
+ * Read the list of jobs from a manifest
+ *
+ * @throws pflib::Exception if the manifest cannot be read or a job is
+ * missing its inputs or output
+ *
+ * @param[in] manifest path to manifest YAML file
+ * @param[in] chip default chip type_version
+ * @param[in] flag_key name of the flag in the manifest
+ * @param[in] flag default for the flag
+ * @param[in] single_input jobs have exactly one 'input' instead of a
+ * list of 'inputs'
+ * @return list of jobs
+ */
+std::vector<Job> read_manifest(const std::string& manifest,
+                               const std::string& chip,
+                               const std::string& flag_key, bool flag,
+                               bool single_input = false);
+
+/// work done for one job, writing its results to the opened output
+using Task = std::function<void(const Job&, Compiler&, std::ostream&)>;
+
+/**
+ * Run all of the jobs on a thread pool
+ *
+ * There is one Compiler per chip type shared by all of the jobs.
+ * A failing job is reported and does not stop the others.
+ *
+ * @param[in] jobs list of jobs to run
+ * @param[in] n_threads number of threads, values less than one use
+ * one per hardware thread
+ * @param[in] what past tense of what is done to the jobs for the summary
+ * @param[in] task work for each job
+ * @return number of jobs that failed
+ */
+int run_batch(const std::vector<Job>& jobs, int n_threads,
+              const std::string& what, Task task);
+
+}  // namespace batch
+}  // namespace pflib
+
+#endif  // PFLIB_CompileBatch_H_INCLUDED
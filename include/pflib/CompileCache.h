@@ -0,0 +1,162 @@
+/**
+ * @file CompileCache.h
+ * Definition of an on-disk cache of compiled configurations
+ */
+#ifndef PFLIB_COMPILECACHE_H
+#define PFLIB_COMPILECACHE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pflib/RegisterImage.h"
+#include "pflib/logging/Logging.h"
+
+namespace pflib {
+
+/**
+ * Cache of compiled register images stored on disk
+ *
+ * Compiling a YAML configuration means parsing the YAML, matching
+ * every page name against the register map, and then compiling each
+ * parameter. When the same configuration files are loaded again and
+ * again, this is wasted work, so the resulting RegisterImage is stored
+ * in a compact binary file named by a hash of everything that went into
+ * it: the contents of the YAML files, the chip type, the version of the
+ * register map, and whether the defaults were prepended. A change to any
+ * of these leads to a different key, so stale entries are never read and
+ * are eventually evicted.
+ *
+ * Each entry carries a checksum of its contents and the registers in it
+ * are checked against the pages of the register map before it is used,
+ * so a damaged entry is recompiled instead of loaded.
+ *
+ * The total size of the cache directory is kept below a maximum by
+ * removing the least recently used entries after each store. Temporary
+ * files left behind by writers that did not finish are removed as well.
+ *
+ * The cache used by Compiler::compile_image is disabled by default.
+ * It is enabled by calling enable or by setting the environment variable
+ * PFLIB_COMPILE_CACHE to the directory to hold the cache.
+ */
+class CompileCache {
+ public:
+  /// default maximum size of the cache directory
+  static constexpr std::uintmax_t DEFAULT_MAX_BYTES{64 * 1024 * 1024};
+
+  /**
+   * Open a cache in the input directory, creating it if necessary
+   *
+   * @throw pflib::Exception if the directory cannot be created
+   *
+   * @param[in] directory path to directory holding cache entries
+   * @param[in] max_bytes maximum total size of the entries
+   */
+  CompileCache(const std::string& directory,
+               std::uintmax_t max_bytes = DEFAULT_MAX_BYTES);
+
+  /**
+   * Cache used by the Compiler
+   *
+   * @return pointer to cache or nullptr if caching is disabled
+   */
+  static CompileCache* global();
+
+  /// use a cache in the input directory for the Compiler
+  static void enable(const std::string& directory,
+                     std::uintmax_t max_bytes = DEFAULT_MAX_BYTES);
+
+  /// stop using a cache for the Compiler
+  static void disable();
+
+  /**
+   * 64-bit FNV-1a hash of the input data
+   *
+   * @param[in] data bytes to hash
+   * @param[in] h hash to continue from, allowing several pieces to be chained
+   * @return hash of data
+   */
+  static uint64_t hash(std::string_view data,
+                       uint64_t h = 0xcbf29ce484222325ull);
+
+  /**
+   * Calculate the key for a configuration
+   *
+   * @param[in] type chip type_version the files are compiled for
+   * @param[in] map_version version of the register map for that chip
+   * @param[in] prepend_defaults if the defaults are compiled as well
+   * @param[in] contents contents of the YAML files in order
+   * @return key identifying the compiled image
+   */
+  static uint64_t key(const std::string& type, uint64_t map_version,
+                      bool prepend_defaults,
+                      const std::vector<std::string>& contents);
+
+  /**
+   * Load an image from the cache
+   *
+   * Entries that cannot be read, do not match the key or their checksum,
+   * or have registers outside of the input pages are removed.
+   *
+   * @param[in] key key of image
+   * @param[in] page_sizes number of registers on each page the image
+   * may use (e.g. Compiler::page_sizes)
+   * @param[out] image image read from the cache
+   * @return true if the image was found
+   */
+  bool load(uint64_t key, const std::map<int, int>& page_sizes,
+            RegisterImage& image);
+
+  /**
+   * Store an image in the cache, evicting old entries if necessary
+   *
+   * Failing to write the entry is not an error, the image is just not
+   * cached.
+   *
+   * @param[in] key key of image
+   * @param[in] image image to store
+   */
+  void store(uint64_t key, const RegisterImage& image);
+
+  /// remove all entries from the cache
+  void clear();
+
+  /// total size of the entries in the cache
+  std::uintmax_t disk_usage() const;
+
+  /// directory holding the cache
+  const std::string& directory() const { return directory_; }
+
+  /// number of successful loads so far
+  int hits() const { return n_hits_; }
+  /// number of failed loads so far
+  int misses() const { return n_misses_; }
+
+ private:
+  /// path to the entry for a key
+  std::string path(uint64_t key) const;
+  /**
+   * remove least recently used entries until we are below the max size
+   * and temporary files which are too old to still be written
+   */
+  void evict();
+
+ private:
+  std::string directory_;
+  std::uintmax_t max_bytes_;
+  std::atomic<int> n_hits_{0};
+  std::atomic<int> n_misses_{0};
+  /// serialize evictions
+  std::mutex evict_mutex_;
+  mutable logging::logger the_log_{logging::get("compile_cache")};
+};
+
+}  // namespace pflib
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef PFLIB_ConfigExecutor_H_INCLUDED
+#define PFLIB_ConfigExecutor_H_INCLUDED
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pflib/I2C.h"
+#include "pflib/logging/Logging.h"
+
+namespace pflib {
+
+/**
+ * Run configuration tasks for many chips, concurrently across I2C buses
+ *
+ * Tasks are grouped by the physical bus (I2C::bus_key) the chip they
+ * configure sits on. Tasks on the same bus are run one after another in
+ * the order they were added while separate buses are worked on at the
+ * same time by a pool of threads.
+ *
+ * ```cpp
+ * ConfigExecutor exec;
+ * for (int id : tgt->roc_ids()) {
+ *   ROC& roc{tgt->roc(id)};
+ *   exec.add(roc.i2c(), "ROC " + std::to_string(id),
+ *            [&roc]() { roc.loadParameters("roc.yaml", true); });
+ * }
+ * exec.run();
+ * ```
+ */
+class ConfigExecutor {
+ public:
+  /**
+   * @param[in] n_threads maximum number of buses to work on at once,
+   * values less than one use one thread per bus
+   */
+  explicit ConfigExecutor(int n_threads = 0);
+
+  /**
+   * Add a task
+   *
+   * @param[in] bus I2C bus the task talks on
+   * @param[in] name human readable name used when reporting failures
+   * @param[in] task function doing the configuration
+   */
+  void add(const I2C& bus, const std::string& name, std::function<void()> task);
+
+  /// number of independent buses that have tasks
+  int nbuses() const { return int(buses_.size()); }
+
+  /// number of tasks waiting to be run
+  int ntasks() const;
+
+  /**
+   * Run all of the tasks, returning when they are all done
+   *
+   * A failing task stops the remaining tasks on its bus but not
+   * the tasks on other buses. The tasks are cleared afterwards.
+   *
+   * @throws Exception listing the failed tasks if any failed
+   */
+  void run();
+
+ private:
+  /// a named configuration task
+  struct Task {
+    std::string name;
+    std::function<void()> job;
+  };
+  /// tasks grouped by bus, in the order buses were first seen
+  std::vector<std::pair<const void*, std::vector<Task>>> buses_;
+  /// maximum number of threads
+  int n_threads_;
+  mutable logging::logger the_log_{logging::get("ConfigExecutor")};
+};
+
+}  // namespace pflib
+
+#endif  // PFLIB_ConfigExecutor_H_INCLUDED
@@ -23,7 +23,44 @@ class ECON {
   ECON(const ECON&) = delete;
   ECON& operator=(const ECON&) = delete;
 
+  /// when to read registers back after writing them
+  enum class VerifyPolicy {
+    /// read back every write and compare
+    Always,
+    /// read back one write out of every verify_every
+    Sampled,
+    /// never read back
+    Never
+  };
+
+  /**
+   * Choose when writes are read back and compared
+   *
+   * Mismatches are reported as warnings since some registers
+   * (e.g. self-clearing bits) are not expected to read back
+   * what was written.
+   *
+   * @param[in] policy when to verify
+   * @param[in] verify_every for Sampled, verify one write out of this many
+   */
+  void setVerifyPolicy(VerifyPolicy policy, int verify_every = 16);
+  VerifyPolicy verifyPolicy() const { return verify_policy_; }
+  /// number of read-back mismatches seen so far
+  int verifyMismatches() const { return n_verify_mismatch_; }
+
+  /**
+   * Set the largest number of data bytes in a single read or write
+   *
+   * The ECON increments its register address after each byte so
+   * contiguous registers are transferred together up to this
+   * length (and the limit of the I2C bus).
+   */
+  void setMaxBurst(int nbytes);
+  int maxBurst() const { return max_burst_; }
+
   const std::string& type() const { return type_; }
+  /// the I2C bus this ECON is on
+  const I2C& i2c() const { return *i2c_; }
   void setRunMode(bool active = true, int edgesel = -1, int fcmd_invert = -1);
   int getPUSMRunValue();
   int getPUSMStateValue();
@@ -82,12 +119,26 @@ class ECON {
 
   TestParameters::Builder testParameters();
 
+ private:
+  /// largest number of bytes we read at once
+  int readBurst() const;
+  /// largest number of bytes we write at once
+  int writeBurst() const;
+  /// write a burst of values without splitting or verifying
+  void writeBurstValues(int reg_addr, const uint8_t* values, int n);
+
  private:
   std::shared_ptr<I2C> i2c_;
   uint8_t econ_base_;
   Compiler compiler_;
   std::string type_;
   std::map<uint16_t, size_t> econ_reg_nbytes_lut_;
+  int max_burst_{DEFAULT_MAX_BURST};
+  VerifyPolicy verify_policy_{VerifyPolicy::Always};
+  int verify_every_{16};
+  int n_writes_{0};
+  int n_verify_mismatch_{0};
+  static constexpr int DEFAULT_MAX_BURST = 256;
   mutable ::pflib::logging::logger the_log_{::pflib::logging::get("econ")};
 };
 
@@ -3,28 +3,138 @@
 
 #include <stdint.h>
 
+#include <array>
+#include <span>
 #include <vector>
 
 namespace pflib {
 
+/**
+ * Software emulation of the ECON-D formatting of HGCROC DAQ link frames
+ *
+ * Each event is built in place into a buffer that is reserved once, so
+ * formatting events does not allocate.
+ *
+ * Zero suppression (unless disabled) follows the ECON-D specification.
+ * For each channel with Tc=Tp=0 and the common mode
+ * CM = (CM0 + CM1) / 2 of its eRx,
+ * - the channel passes if ADC >= lambda + kappa * CM / 64 or it is masked
+ * - ADC(-1) is kept if ADC(-1) >= beta + kappa * CM / 64 or it is masked
+ * - the TOA is dropped when it is zero (unless TOA suppression is off)
+ * and the channel is written with the matching code from Fig. 20.
+ * Channels in TOT mode (Tc=Tp=1) and invalid channels (Tc=1,Tp=0)
+ * always pass with all 32 bits. Channels with an ongoing TOT (Tc=0,Tp=1)
+ * pass with code 0010 unless their suppression is requested.
+ * An eRx without any passing channel is sent as a single header word.
+ *
+ * The buffer model follows the words of each event through the ECON-D
+ * output buffer which is drained by the eTx output links (32 bits per
+ * BX each). Events that do not fit in the buffer are truncated to their
+ * header and CRC (with the T bit set) like the ECON-D does.
+ */
 class ECOND_Formatter {
  public:
+  /// maximum number of eRx on an ECON-D
+  static constexpr int MAX_ERX = 12;
+  /// number of channels in an eRx sub-packet (including calib)
+  static constexpr int N_CHANNELS = 37;
+
+  /// zero-suppression settings of one channel
+  struct ChannelZS {
+    /// ADC threshold
+    uint16_t lambda{0};
+    /// weight of the common mode in the thresholds in units of 1/64
+    uint8_t kappa{0};
+    /// ADC(-1) threshold
+    uint16_t beta{0};
+    /// always pass this channel
+    bool mask{false};
+    /// always keep ADC(-1) of this channel
+    bool mask_m1{false};
+  };
+
+  /// statistics of the output buffer model
+  struct BufferStats {
+    /// BX the buffer has been drained for
+    uint64_t n_bx{0};
+    /// events offered to the buffer
+    uint64_t n_events{0};
+    /// events truncated because the buffer was full
+    uint64_t n_truncated{0};
+    /// words offered to the buffer (before truncation)
+    uint64_t words_in{0};
+    /// words sent on the output links
+    uint64_t words_out{0};
+    /// words currently in the buffer
+    int occupancy{0};
+    /// largest occupancy seen
+    int max_occupancy{0};
+    /// fraction of events truncated
+    double truncation_rate() const {
+      return n_events > 0 ? double(n_truncated) / n_events : 0.;
+    }
+  };
+
   ECOND_Formatter();
 
   void startEvent(int bx, int l1a, int orbit);
   void finishEvent();
   const std::vector<uint32_t>& getPacket() const { return packet_; }
   void disable_zs(bool disable = true) { disable_ZS_ = disable; }
-  void add_elink_packet(int ielink, const std::vector<uint32_t>& src);
+  void add_elink_packet(int ielink, std::span<const uint32_t> src);
+
+  /**
+   * Set the zero suppression of a channel
+   *
+   * @param[in] ielink eRx the channel is on
+   * @param[in] ichannel channel 0-35 or -1 for the calib channel
+   * @param[in] zs settings for the channel
+   */
+  void set_zs(int ielink, int ichannel, const ChannelZS& zs);
+  /// set the zero suppression of all the channels
+  void set_zs(const ChannelZS& zs);
+  /// get the zero suppression of a channel
+  const ChannelZS& get_zs(int ielink, int ichannel) const;
+  /// drop the TOA of channels where it is zero (on by default)
+  void suppress_toa(bool suppress = true) { suppress_toa_ = suppress; }
+  /// drop channels with an ongoing TOT (Tc=0,Tp=1) (off by default)
+  void suppress_tot_busy(bool suppress = true) {
+    suppress_tot_busy_ = suppress;
+  }
+
+  /**
+   * Configure the output buffer model
+   *
+   * @param[in] n_etx number of output links
+   * @param[in] buffer_words capacity of the buffer in 32-bit words,
+   * zero for a buffer that never fills
+   */
+  void setup_buffer(int n_etx, int buffer_words);
+  /// drain the buffer for the input number of BX
+  void advance(uint64_t n_bx);
+  /// statistics of the buffer model so far
+  const BufferStats& buffer_stats() const { return stats_; }
+  /// fraction of the output link bandwidth used so far
+  double link_utilization() const;
+  /// empty the buffer and reset its statistics
+  void reset_buffer();
 
  private:
-  std::vector<uint32_t> format_elink(int ielink,
-                                     const std::vector<uint32_t>& src);
-  int zs_process(int ielink, int ic, uint32_t word);
+  void format_elink(int ielink, std::span<const uint32_t> src);
+  /// code to write the channel at iw in the sub-packet with, -1 if it fails
+  int zs_process(int ielink, int iw, uint32_t word, int cm);
 
   std::vector<uint32_t> packet_;
 
   bool disable_ZS_;
+  bool suppress_toa_;
+  bool suppress_tot_busy_;
+  /// zero suppression of each channel in the order of the sub-packet
+  std::array<std::array<ChannelZS, N_CHANNELS>, MAX_ERX> zs_;
+
+  int n_etx_;
+  int buffer_words_;
+  BufferStats stats_;
 };
 
 }  // namespace pflib
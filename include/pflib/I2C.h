@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include <map>
+#include <memory>
 #include <vector>
 
 #include "pflib/Exception.h"
@@ -16,11 +18,44 @@ namespace pflib {
  * bus
  */
 class I2C {
+ public:
+  /**
+   * What was last programmed onto a physical bus
+   *
+   * Bus objects driving the same hardware share one of these so that
+   * they agree on what does and does not need to be re-programmed.
+   */
+  struct BusState {
+    /// bus speed in kbps last programmed, negative if unknown
+    int speed{-1};
+    /// mux address -> channel selection last written
+    std::map<int, int> mux;
+  };
+
  protected:
   mutable logging::logger the_log_{logging::get("I2C")};
-  I2C() {}
+  I2C() : bus_state_{std::make_shared<BusState>()} {}
+  /// use a bus state shared with other objects on the same hardware
+  I2C(std::shared_ptr<BusState> bus_state) : bus_state_{bus_state} {}
+  /// cached state of the physical bus
+  std::shared_ptr<BusState> bus_state_;
 
  public:
+  virtual ~I2C() = default;
+
+  /**
+   * Forget what we know about the state of the bus
+   *
+   * The next transactions will re-program the bus speed and any
+   * multiplexer selections. This is done automatically when a
+   * transaction fails and should be called after anything that could
+   * change the bus behind our back (e.g. a reset).
+   */
+  void invalidate_bus_state() {
+    bus_state_->speed = -1;
+    bus_state_->mux.clear();
+  }
+
   /**
    * Set the speed for the bus in kbps
    */
@@ -52,6 +87,24 @@ class I2C {
   virtual std::vector<uint8_t> general_write_read(
       uint8_t i2c_dev_addr, const std::vector<uint8_t>& wdata,
       int nread = 0) = 0;
+
+  /**
+   * Maximum number of bytes that can be written or read
+   * within a single general_write_read call
+   *
+   * Callers streaming many bytes (e.g. auto-increment register access)
+   * should split their transfers into chunks no larger than this.
+   */
+  virtual int max_transfer_bytes() const { return 1; }
+
+  /**
+   * Identify the physical resource behind this bus
+   *
+   * Bus objects returning the same key share hardware and must not
+   * be used from different threads at the same time.
+   * By default, each bus object is its own physical bus.
+   */
+  virtual const void* bus_key() const { return this; }
 };
 
 }  // namespace pflib
@@ -50,6 +50,12 @@ class I2C_Linux : public I2C {
                                           const std::vector<uint8_t>& wdata,
                                           int nread = 0);
 
+  /**
+   * The kernel does not limit the message size in a meaningful way,
+   * we just keep the buffers reasonable.
+   */
+  int max_transfer_bytes() const { return 1024; }
+
  private:
   void obtain_control(uint8_t i2c_dev_addr);
 
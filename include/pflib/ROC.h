@@ -25,11 +25,50 @@ class ROC {
   void setRunMode(bool active = true);
   bool isRunMode();
   const std::string& type() const;
+  /// the I2C bus this ROC is on
+  const I2C& i2c() const { return *i2c_; }
 
   std::vector<uint8_t> readPage(int ipage, int len);
   uint8_t getValue(int page, int offset);
   void setValue(int page, int offset, uint8_t value);
 
+  /**
+   * Enable the write-through register shadow
+   *
+   * All of the known pages are read from the chip once and stored
+   * in memory. Afterwards, reads of these pages (getValue, readPage,
+   * getRegisters, getParameters, ...) are served from the shadow
+   * and every write updates both the chip and the shadow.
+   * The direct access registers are never shadowed.
+   *
+   * The shadow is shared between copies of this ROC object,
+   * so enabling it on one copy enables it for all of them.
+   *
+   * @param[in] verify if true, every read served from the shadow is
+   * also read from the chip and compared, mismatches are reported and
+   * the chip value is kept
+   */
+  void enableShadow(bool verify = false);
+
+  /// stop using the shadow and drop its contents
+  void disableShadow();
+
+  /// is the register shadow enabled?
+  bool hasShadow() const;
+
+  /// is the register shadow comparing against the chip on every read?
+  bool shadowVerify() const;
+
+  /**
+   * Re-read all of the known pages from the chip into the shadow
+   *
+   * This is necessary after anything modifies the chip behind
+   * our back, e.g. a hard reset. Does nothing if the shadow is disabled.
+   *
+   * @return number of registers whose value differed from the shadow
+   */
+  int refresh();
+
   std::vector<std::string> getDirectAccessParameters();
   bool getDirectAccess(const std::string& name);
   bool getDirectAccess(int reg, int bit);
@@ -44,6 +83,49 @@ class ROC {
    */
   void setRegisters(const std::map<int, std::map<int, uint8_t>>& registers);
 
+  /**
+   * set only the registers on the HGCROC whose values differ
+   *
+   * The registers that do need to be written are handed to setRegisters
+   * so consecutive registers are still written in runs.
+   *
+   * @param[in] registers target register values, page -> register -> value
+   * @param[in] current register values believed to be on the chip,
+   * registers missing from this image are always written
+   * @return number of register writes that were skipped
+   */
+  int setChangedRegisters(
+      const std::map<int, std::map<int, uint8_t>>& registers,
+      const std::map<int, std::map<int, uint8_t>>& current);
+
+  /**
+   * set only the registers on the HGCROC whose values differ
+   *
+   * The current values are retrieved with getRegisters, so they come
+   * from the shadow if it is enabled and a bulk read of the chip otherwise.
+   *
+   * @param[in] registers target register values, page -> register -> value
+   * @return number of register writes that were skipped
+   */
+  int setChangedRegisters(
+      const std::map<int, std::map<int, uint8_t>>& registers);
+
+  /**
+   * Apply already compiled register values onto the chip
+   *
+   * This is how the same configuration is put onto many ROCs without
+   * compiling it for each one (see Target::broadcastParameters).
+   * Only the bits in the mask are changed. The current values are read
+   * only for pages that have a register not fully covered by the mask
+   * or that are held in the shadow (where reading is free), and registers
+   * already known to hold their target value are not written.
+   *
+   * @param[in] values register values to apply
+   * @param[in] mask for each register in values, the bits to apply
+   * @return number of register writes that were skipped
+   */
+  int applyImage(const RegisterImage& values, const RegisterImage& mask);
+
   /**
    * get registers from the HGCROC
    *
@@ -93,6 +175,32 @@ class ROC {
   std::map<int, std::map<int, uint8_t>> applyParameters(
       const std::map<std::string, std::map<std::string, uint64_t>>& parameters);
 
+  /**
+   * Apply already resolved parameters onto the chip
+   *
+   * Parameters are applied in order so later values of the same
+   * parameter take precedence.
+   *
+   * @see resolve for getting the handles
+   *
+   * @param[in] parameters handles to parameters and their values
+   * @return chip registers that **were** on the chip before the application
+   * of these parameters
+   */
+  std::map<int, std::map<int, uint8_t>> applyParameters(
+      const std::vector<std::pair<ParameterHandle, uint64_t>>& parameters);
+
+  /**
+   * Look up a parameter once so that it can be set many times
+   *
+   * @see Compiler::resolve
+   *
+   * @param[in] page name of page
+   * @param[in] param name of parameter in that page
+   * @return handle to the parameter
+   */
+  ParameterHandle resolve(const std::string& page, const std::string& param);
+
   /**
    * Load the input parameters onto the chip
    *
@@ -129,6 +237,8 @@ class ROC {
    */
   class TestParameters {
     std::map<int, std::map<int, uint8_t>> previous_registers_;
+    /// what we put on the chip, so we only need to restore what changed
+    std::map<int, std::map<int, uint8_t>> applied_registers_;
     ROC& roc_;
 
    public:
@@ -141,6 +251,10 @@ class ROC {
     TestParameters(
         ROC& roc,
         std::map<std::string, std::map<std::string, uint64_t>> new_params);
+    /// apply already resolved parameters
+    TestParameters(
+        ROC& roc,
+        const std::vector<std::pair<ParameterHandle, uint64_t>>& new_params);
     /// applies the unset parameters to the ROC
     ~TestParameters();
     /// cannot copy or assign this lock
@@ -148,13 +262,15 @@ class ROC {
     TestParameters& operator=(const TestParameters&) = delete;
     /// Build a TestParameters parameter by parameter
     class Builder {
-      std::map<std::string, std::map<std::string, uint64_t>> parameters_;
+      std::vector<std::pair<ParameterHandle, uint64_t>> parameters_;
       ROC& roc_;
 
      public:
       Builder(ROC& roc);
       Builder& add(const std::string& page, const std::string& param,
                    const uint64_t& val);
+      /// add a parameter that was already resolved, no name lookups
+      Builder& add(const ParameterHandle& handle, const uint64_t& val);
       Builder& add_all_channels(const std::string& param, const uint64_t& val);
       [[nodiscard]] TestParameters apply();
     };
@@ -182,11 +298,37 @@ class ROC {
    */
   TestParameters::Builder testParameters();
 
+ private:
+  /// compile the parameters on top of the input register values
+  void compileOnto(
+      const std::map<std::string, std::map<std::string, uint64_t>>& parameters,
+      std::map<int, std::map<int, uint8_t>>& registers);
+  /// read a single register from the chip, bypassing the shadow
+  uint8_t getValueFromChip(int page, int offset);
+  /// write a single register on the chip, bypassing the shadow
+  void setValueOnChip(int page, int offset, uint8_t value);
+  /**
+   * read consecutive registers from the chip, bypassing the shadow
+   *
+   * The register pointer is set once and then the data is streamed
+   * out of the auto-incrementing data register in chunks as large
+   * as the I2C bus allows.
+   */
+  std::vector<uint8_t> getValuesFromChip(int page, int offset, int n);
+  /// write consecutive registers on the chip, bypassing the shadow
+  void setValuesOnChip(int page, int offset,
+                       const std::vector<uint8_t>& values);
+  /// write consecutive registers on the chip and update the shadow
+  void setValues(int page, int offset, const std::vector<uint8_t>& values);
+
  private:
   std::shared_ptr<I2C> i2c_;
   uint8_t roc_base_;
   std::string type_version_;
   Compiler compiler_;
+  /// register shadow, shared between copies of this ROC
+  struct Shadow;
+  std::shared_ptr<Shadow> shadow_;
   mutable ::pflib::logging::logger the_log_{::pflib::logging::get("roc")};
 };
 
@@ -0,0 +1,159 @@
+/**
+ * @file RegisterImage.h
+ * Definition of a dense image of chip register values
+ */
+#ifndef PFLIB_REGISTERIMAGE_H
+#define PFLIB_REGISTERIMAGE_H
+
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+namespace pflib {
+
+/**
+ * A set of register values held in contiguous arrays
+ *
+ * Each page is stored as a byte array alongside two bitsets: one
+ * marking which registers hold a value (valid) and one marking which
+ * registers have been changed since the last call to clear_dirty (dirty).
+ * This replaces the nested `std::map<int, std::map<int, uint8_t>>`
+ * used throughout pflib when many registers are handled at once
+ * since setting or reading a register is an array access instead of
+ * a walk through two red-black trees.
+ *
+ * Conversion to and from the nested map is provided so that the image
+ * can be used where the map is still expected.
+ */
+class RegisterImage {
+ public:
+  /**
+   * A contiguous run of registers within a page
+   *
+   * The values pointer is only valid as long as the image
+   * it came from is not modified.
+   */
+  struct Run {
+    /// page the run is in
+    int page;
+    /// first register of the run
+    int reg;
+    /// number of registers in the run
+    int n;
+    /// values of the registers in the run
+    const uint8_t* values;
+  };
+
+  RegisterImage() = default;
+
+  /**
+   * Construct an image from the nested map, all registers are marked dirty
+   *
+   * @param[in] registers page numbers, register numbers, and register values
+   */
+  explicit RegisterImage(
+      const std::map<int, std::map<int, uint8_t>>& registers);
+
+  /**
+   * Convert back into the nested map
+   *
+   * @return page numbers, register numbers, and register values
+   */
+  std::map<int, std::map<int, uint8_t>> to_map() const;
+
+  /// make room for registers [0, n_registers) on the input page
+  void reserve(int page, int n_registers);
+
+  /// check if the page has been given any registers
+  bool has_page(int page) const;
+  /// check if the register holds a value
+  bool has(int page, int reg) const;
+  /// check if the register was changed since the last clear_dirty
+  bool is_dirty(int page, int reg) const;
+  /// get the value of a register, zero if it does not hold a value
+  uint8_t get(int page, int reg) const;
+
+  /**
+   * Set the value of a register
+   *
+   * The register is marked dirty if it did not hold a value before
+   * or if the value changed.
+   */
+  void set(int page, int reg, uint8_t value);
+
+  /**
+   * Overwrite only the bits in mask with the input bits
+   *
+   * Registers that do not hold a value yet start from zero.
+   *
+   * @param[in] page page number
+   * @param[in] reg register number
+   * @param[in] mask bits in register to overwrite
+   * @param[in] bits new values of bits (outside of mask are ignored)
+   */
+  void set_bits(int page, int reg, uint8_t mask, uint8_t bits);
+
+  /// page numbers held in the image in increasing order
+  std::vector<int> pages() const;
+  /// register numbers holding a value in the input page in increasing order
+  std::vector<int> registers(int page) const;
+  /// number of registers holding a value
+  std::size_t size() const;
+  /// true if no register holds a value
+  bool empty() const { return size() == 0; }
+
+  /// forget all register values
+  void clear();
+  /// mark all registers as clean
+  void clear_dirty();
+
+  /// contiguous runs of registers holding a value, in page and register order
+  std::vector<Run> runs() const;
+  /// contiguous runs of dirty registers, in page and register order
+  std::vector<Run> dirty_runs() const;
+
+  /**
+   * Copy all register values from the other image onto this one
+   *
+   * Registers that change value (or are new) are marked dirty.
+   *
+   * @param[in] other image to overlay on this one
+   */
+  void merge(const RegisterImage& other);
+
+  /**
+   * Find the register values needed to go from this image to the other
+   *
+   * @param[in] other target image
+   * @return registers in other that are either missing from this image or
+   * hold a different value, all marked dirty
+   */
+  RegisterImage diff(const RegisterImage& other) const;
+
+  /// images are equal if the same registers hold the same values
+  bool operator==(const RegisterImage& other) const;
+
+ private:
+  /// storage of a single page
+  struct Page {
+    int id;
+    std::vector<uint8_t> values;
+    std::vector<uint64_t> valid;
+    std::vector<uint64_t> dirty;
+  };
+  /// find a page, nullptr if it doesn't exist
+  const Page* find(int page) const;
+  /// get a page making sure it has room for the input register
+  Page& page(int id, int reg);
+  /// collect runs of bits set in the bitset selected by the member pointer
+  std::vector<Run> runs(std::vector<uint64_t> Page::*bits) const;
+
+ private:
+  /// pages sorted by id
+  std::vector<Page> pages_;
+};
+
+}  // namespace pflib
+
+#endif
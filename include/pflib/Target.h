@@ -71,6 +71,77 @@ class Target {
   /** Generate a soft reset to a specific ECON board, -1 for all */
   virtual void softResetECON(int which = -1) {}
 
+  /// parameter values for one chip: page -> parameter -> value
+  using ParameterMap = std::map<std::string, std::map<std::string, uint64_t>>;
+
+  /**
+   * Apply parameters to many ROCs and ECONs at once
+   *
+   * The chips are grouped by the physical I2C bus they sit on and
+   * independent buses are configured concurrently (see ConfigExecutor).
+   *
+   * @param[in] roc_parameters ROC id -> parameters to apply to it
+   * @param[in] econ_parameters ECON id -> parameters to apply to it
+   * @param[in] n_threads maximum number of buses to work on at once,
+   * less than one for one thread per bus
+   */
+  void applyParameters(const std::map<int, ParameterMap>& roc_parameters,
+                       const std::map<int, ParameterMap>& econ_parameters,
+                       int n_threads = 0);
+
+  /**
+   * Load YAML parameter files onto many ROCs and ECONs at once
+   *
+   * Just like applyParameters, but calling loadParameters on each chip.
+   *
+   * @param[in] roc_files ROC id -> YAML file to load onto it
+   * @param[in] econ_files ECON id -> YAML file to load onto it
+   * @param[in] prepend_defaults passed to each chip's loadParameters
+   * @param[in] n_threads maximum number of buses to work on at once,
+   * less than one for one thread per bus
+   */
+  void loadParameters(const std::map<int, std::string>& roc_files,
+                      const std::map<int, std::string>& econ_files,
+                      bool prepend_defaults, int n_threads = 0);
+
+  /**
+   * Apply the same parameters to many ROCs
+   *
+   * The parameters are compiled once for each ROC type and the resulting
+   * register image is handed to ROC::applyImage for every ROC, so the
+   * ROCs only read back the registers they need to and skip writing the
+   * ones they already hold (all of them if the shadow is enabled).
+   * Like applyParameters, ROCs on independent buses are configured
+   * concurrently.
+   *
+   * @param[in] parameters page -> parameter -> value to apply
+   * @param[in] roc_ids ROCs to apply them to, all ROCs if empty
+   * @param[in] n_threads maximum number of buses to work on at once,
+   * less than one for one thread per bus
+   * @return number of register writes skipped across all of the ROCs
+   */
+  int broadcastParameters(const ParameterMap& parameters,
+                          const std::vector<int>& roc_ids = {},
+                          int n_threads = 0);
+
+  /**
+   * Load the same YAML parameter file onto many ROCs
+   *
+   * Just like broadcastParameters, but the file is compiled once
+   * for each ROC type.
+   *
+   * @param[in] file_path YAML file to load
+   * @param[in] prepend_defaults if true, set every parameter not in the
+   * file to its default, otherwise only apply the parameters in the file
+   * @param[in] roc_ids ROCs to load the file onto, all ROCs if empty
+   * @param[in] n_threads maximum number of buses to work on at once,
+   * less than one for one thread per bus
+   * @return number of register writes skipped across all of the ROCs
+   */
+  int broadcastParameters(const std::string& file_path, bool prepend_defaults,
+                          const std::vector<int>& roc_ids = {},
+                          int n_threads = 0);
+
   /** get the Elinks object */
   virtual Elinks& elinks() = 0;
 
@@ -125,6 +196,8 @@ Target* makeTargetHcalBackplaneBittware(int ilink, uint8_t board_mask,
                                         const char* dev);
 Target* makeTargetEcalSMMZCU(int ilink, uint8_t roc_mask);
 Target* makeTargetEcalSMMBittware(int ilink, uint8_t rocmask, const char* dev);
+Target* makeTargetEmulated(int nrocs, const std::string& roc_type,
+                           uint64_t seed);
 
 }  // namespace pflib
 
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "pflib/Exception.h"
+#include "pflib/I2C.h"
 #include "pflib/lpgbt/GPIO.h"
 
 namespace pflib {
@@ -35,6 +36,39 @@ class lpGBT_ConfigTransport {
       communication.
   */
   virtual void write_regs(uint16_t reg, const std::vector<uint8_t>& value);
+
+  /** Queue a write of the given values to a sequence of registers
+      beginning with the listed one. Nothing is sent until flush is
+      called and a write continuing the previously queued write is
+      merged with it so that it can go out in as few frames as possible.
+   */
+  void queue_write(uint16_t reg, const std::vector<uint8_t>& values);
+  /** Queue a write of a single register */
+  void queue_write(uint16_t reg, uint8_t value) {
+    queue_write(reg, std::vector<uint8_t>(1, value));
+  }
+  /** Queue a read of n registers beginning with the listed one,
+      merged with the previously queued read if it continues it.
+   */
+  void queue_read(uint16_t reg, int n = 1);
+  /** Number of (merged) transactions waiting in the queue */
+  size_t queued() const { return queue_.size(); }
+  /** Carry out the queued transactions in the order they were queued
+      using read_regs and write_regs. The queue is empty afterwards,
+      even if one of the transactions failed.
+      \return values of all the queued reads, in the order they were queued
+   */
+  std::vector<uint8_t> flush();
+
+ private:
+  /// one queued transaction
+  struct Transaction {
+    bool read;
+    uint16_t reg;
+    int n;
+    std::vector<uint8_t> values;
+  };
+  std::vector<Transaction> queue_;
 };
 
 /** Class which provides an interface with an lpGBT ASIC **as mounted
@@ -54,11 +88,11 @@ class lpGBT {
  public:
   lpGBT(lpGBT_ConfigTransport& transport);
 
-  void write(uint16_t reg, uint8_t value) { tport_.write_reg(reg, value); }
-  uint8_t read(uint16_t reg) { return tport_.read_reg(reg); }
-  std::vector<uint8_t> read(uint16_t reg, int len) {
-    return tport_.read_regs(reg, len);
-  }
+  void write(uint16_t reg, uint8_t value);
+  uint8_t read(uint16_t reg);
+  std::vector<uint8_t> read(uint16_t reg, int len);
+  /** Write a sequence of registers beginning with the listed one */
+  void write(uint16_t reg, const std::vector<uint8_t>& values);
 
   typedef std::pair<uint16_t, uint8_t> RegisterValue;
   typedef std::vector<RegisterValue> RegisterValueVector;
@@ -71,6 +105,47 @@ class lpGBT {
   void bit_set(uint16_t reg, int ibit);
   void bit_clr(uint16_t reg, int ibit);
 
+  /* -------------------------------------------------------
+     Register shadow
+  */
+
+  /// number of registers in the shadow image (the full register space)
+  static constexpr uint16_t SHADOW_SIZE = 0x1CF;
+
+  /** Is this a configuration register that can be served from the shadow?
+      The read-only status registers, the I2C masters, the eFuse
+      programming and the ADC registers are always accessed on the chip.
+   */
+  static bool is_shadowed(uint16_t reg);
+
+  /** Read the full register space with one bulk sweep and serve
+      reads of configuration registers from memory afterwards.
+      All writes through this object keep the shadow up to date.
+   */
+  void enable_shadow();
+  /** Stop using the shadow, all reads go to the chip again */
+  void disable_shadow();
+  /** Is the shadow in use? */
+  bool has_shadow() const { return shadow_enabled_; }
+  /** Re-read the full register space into the shadow (e.g. after the chip
+      was reset behind our back)
+      \return number of configuration registers which changed
+   */
+  int refresh_shadow();
+
+  /** Current values of all configuration registers, from the shadow if
+      it is in use and from the chip otherwise */
+  RegisterValueVector snapshot();
+  /** Configuration registers of the snapshot with a value different from
+      the one currently on the chip, non-configuration registers are ignored
+      \return the registers with the values from the snapshot
+   */
+  RegisterValueVector diff(const RegisterValueVector& snapshot);
+  /** Write the registers which differ from the snapshot back to the chip
+      \return number of registers written
+   */
+  int restore(const RegisterValueVector& snapshot);
+
   /* -------------------------------------------------------
      Medium-level interfaces
   */
@@ -238,16 +313,51 @@ class lpGBT {
   /** Get back the data from the read */
   std::vector<uint8_t> i2c_read_data(int ibus);
 
-  /** finalize the configuration */
+  /** Carry out a complete I2C transaction on the given bus: an optional
+      write of up to 16 bytes followed by an optional read of up to 16 bytes.
+      The register accesses are batched into as few transport transactions
+      as possible and the status polling starts after the time the transfer
+      is expected to take on the bus, with back-off afterwards.
+      \return bytes read (empty if nread is zero)
+   */
+  std::vector<uint8_t> i2c_transaction(int ibus, uint8_t i2c_addr,
+                                       const std::vector<uint8_t>& wdata,
+                                       int nread = 0);
+
+  /** Get the cached state of an I2C master, shared by all of the
+      I2C bus objects using that master. setup_i2c clears the cached
+      state since it can be called with non-standard drive settings. */
+  std::shared_ptr<::pflib::I2C::BusState> i2c_bus_state(int ibus);
+
+  /** Forget the cached speed and mux selections of all I2C masters,
+      e.g. after the chip or the devices behind it were reset. The
+      next access through each bus object programs them again. */
+  void invalidate_i2c_bus_state();
+
+  /** finalize the configuration, forgetting the cached I2C bus state */
   void finalize_setup();
 
  private:
+  /** Program the master's address and control register and start
+      the command, staging any data into the master's buffer */
+  void i2c_launch(int ibus, uint8_t i2c_addr, uint8_t ctl_reg, uint8_t cmd,
+                  const std::vector<uint8_t>& data, int nbytes);
+  /** Wait for the current transaction on the bus to finish
+      \return the status register and the n_after_status registers following
+      it from the poll that saw the success */
+  std::vector<uint8_t> i2c_wait(int ibus, int n_after_status);
+
   lpGBT_ConfigTransport& tport_;
   struct I2C {
     uint8_t ctl_reg;
     uint8_t read_len;
+    /// number of bytes of the transaction in flight
+    int pending_bytes;
   } i2c_[3];
+  std::shared_ptr<::pflib::I2C::BusState> i2c_bus_state_[3];
   ::pflib::lpgbt::GPIO gpio_;
+  bool shadow_enabled_;
+  std::vector<uint8_t> shadow_;
 };
 
 }  // namespace pflib
@@ -10,7 +10,11 @@ namespace lpgbt {
 /** Synchronous I2C implementation */
 class I2C : public ::pflib::I2C {
  public:
-  I2C(lpGBT& lpGBT, int ibus) : lpgbt_{lpGBT}, ibus_{ibus}, ispeed_{100} {}
+  I2C(lpGBT& lpGBT, int ibus)
+      : ::pflib::I2C(lpGBT.i2c_bus_state(ibus)),
+        lpgbt_{lpGBT},
+        ibus_{ibus},
+        ispeed_{100} {}
 
   virtual void set_bus_speed(int speed = 100);
   virtual int get_bus_speed();
@@ -18,6 +22,13 @@ class I2C : public ::pflib::I2C {
   virtual uint8_t read_byte(uint8_t i2c_dev_addr);
   virtual std::vector<uint8_t> general_write_read(
       uint8_t i2c_dev_addr, const std::vector<uint8_t>& wdata, int nread = 0);
+  /// the lpGBT I2C masters have a 16-byte data buffer
+  virtual int max_transfer_bytes() const { return 16; }
+  /**
+   * all the I2C masters of one lpGBT share its configuration
+   * transport, so the lpGBT is the physical resource
+   */
+  virtual const void* bus_key() const { return &lpgbt_; }
 
  private:
   lpGBT& lpgbt_;
@@ -37,6 +48,8 @@ class I2CwithMux : public ::pflib::lpgbt::I2C {
       uint8_t i2c_dev_addr, const std::vector<uint8_t>& wdata, int nread = 0);
 
  private:
+  /// select our mux channel if it isn't already
+  void select();
   uint8_t muxaddr_, wval_;
 };
 }  // namespace lpgbt
@@ -1,16 +1,53 @@
 #ifndef PFLIB_lpGBT_ConfigTransport_I2C_H_INCLUDED
 #define PFLIB_lpGBT_ConfigTransport_I2C_H_INCLUDED
 
+#include <sys/types.h>
+
+#include <array>
+#include <memory>
 #include <string>
 
 #include "pflib/lpGBT.h"
 
 namespace pflib {
 
+/**
+ * Configuration transport using the I2C slave interface of the lpGBT
+ * through a Linux I2C bus device file
+ *
+ * Register reads are a single I2C_RDWR ioctl combining the write of
+ * the register address with the read of the data (repeated start) and
+ * writes are a single message with the address followed by the data.
+ * The lpGBT increments the register address after each byte, so
+ * transfers are only split into chunks of a configurable size.
+ */
 class lpGBT_ConfigTransport_I2C : public lpGBT_ConfigTransport {
  public:
+  /**
+   * Access to the I2C bus device file
+   *
+   * Normally this is the device file itself but a mock can be
+   * put in its place for testing.
+   */
+  class Device {
+   public:
+    virtual ~Device() = default;
+    /// ioctl(2) on the device file
+    virtual int ioctl(unsigned long request, void* arg) = 0;
+    /// read(2) from the device file
+    virtual ssize_t read(void* buf, size_t n) = 0;
+    /// write(2) to the device file
+    virtual ssize_t write(const void* buf, size_t n) = 0;
+  };
+
+  /// largest chunk, the lpGBT register space
+  static constexpr int MAX_CHUNK = lpGBT::SHADOW_SIZE;
+  /// chunk size used unless configured otherwise
+  static constexpr int DEFAULT_CHUNK = 64;
+
   lpGBT_ConfigTransport_I2C(uint8_t i2c_addr, const std::string& bus_dev);
-  virtual ~lpGBT_ConfigTransport_I2C();
+  lpGBT_ConfigTransport_I2C(uint8_t i2c_addr, std::shared_ptr<Device> dev);
+  virtual ~lpGBT_ConfigTransport_I2C() = default;
 
   void write_raw(uint8_t a);
   void write_raw(uint8_t a, uint8_t b);
@@ -19,6 +56,8 @@ class lpGBT_ConfigTransport_I2C : public lpGBT_ConfigTransport {
 
   uint8_t read_raw();
   std::vector<uint8_t> read_raw(int n);
+  /** Read n bytes into the caller's buffer of the given size */
+  void read_raw(uint8_t* buf, size_t size, int n);
 
   virtual uint8_t read_reg(uint16_t reg) final;
   virtual void write_reg(uint16_t reg, uint8_t value) final;
@@ -26,8 +65,33 @@ class lpGBT_ConfigTransport_I2C : public lpGBT_ConfigTransport {
   virtual std::vector<uint8_t> read_regs(uint16_t reg, int n);
   virtual void write_regs(uint16_t reg, const std::vector<uint8_t>& value);
 
+  /**
+   * Read n registers beginning with the listed one into the caller's
+   * buffer without any allocation
+   *
+   * @param[in] reg first register
+   * @param[in] n number of registers
+   * @param[out] buf destination
+   * @param[in] size number of bytes available at buf
+   */
+  void read_regs(uint16_t reg, int n, uint8_t* buf, size_t size);
+  /**
+   * Write n registers beginning with the listed one from the caller's
+   * buffer without any allocation
+   */
+  void write_regs(uint16_t reg, const uint8_t* values, size_t n);
+
+  /// set the largest number of registers in one transfer
+  void set_chunk_size(int n);
+  /// largest number of registers in one transfer
+  int chunk_size() const { return chunk_; }
+
  private:
-  int handle_;
+  uint8_t i2c_addr_;
+  std::shared_ptr<Device> dev_;
+  int chunk_;
+  /// address and data of a write, kept around to avoid allocations
+  std::array<uint8_t, 2 + MAX_CHUNK> wbuf_;
 };
 
 }  // namespace pflib
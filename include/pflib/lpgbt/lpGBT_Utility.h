@@ -25,6 +25,20 @@ lpGBT::RegisterValueVector loadRegisterCSV(const std::string& filename);
  */
 void applylpGBTCSV(const std::string& filename, lpGBT& lpgbt);
 
+/** Save a snapshot of register values (e.g. from lpGBT::snapshot).
+ * Files ending in .yaml or .yml are written as a YAML map from register
+ * address to value, anything else as a binary image of the full
+ * register space with unlisted registers set to zero.
+ */
+void saveRegisterSnapshot(const std::string& filename,
+                          const lpGBT::RegisterValueVector& snapshot);
+
+/** Load a snapshot written by saveRegisterSnapshot.
+ * A binary image is returned as all of its configuration registers
+ * (see lpGBT::is_shadowed).
+ */
+lpGBT::RegisterValueVector loadRegisterSnapshot(const std::string& filename);
+
 }  // namespace lpgbt
 }  // namespace pflib
 
@@ -21,6 +21,8 @@ class DAQLinkFrame {
   mutable ::pflib::logging::logger the_log_{::pflib::logging::get("decoding")};
 
  public:
+  /// words in a full frame: header, common mode, 37 samples and CRC
+  static constexpr int N_WORDS = 40;
   /// id number for bunch crossing of this sample
   int bx;
   /// event number for this readout-request
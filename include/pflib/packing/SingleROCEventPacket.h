@@ -1,7 +1,9 @@
 #pragma once
 
 #include <array>
+#include <functional>
 #include <span>
+#include <vector>
 
 #include "pflib/logging/Logging.h"
 #include "pflib/packing/DAQLinkFrame.h"
@@ -24,6 +26,18 @@ class SingleROCEventPacket {
   mutable ::pflib::logging::logger the_log_{::pflib::logging::get("decoding")};
 
  public:
+  /// first word of the software header in front of each packet
+  static constexpr uint32_t HEADER_0 = 0x11888811;
+  /// second word of the software header in front of each packet
+  static constexpr uint32_t HEADER_1 = 0xbeef2025;
+  /// first word of the software trailer after each packet
+  static constexpr uint32_t TRAILER_0 = 0xd07e2025;
+  /// second word of the software trailer after each packet
+  static constexpr uint32_t TRAILER_1 = 0x12345678;
+  /// number of words in the software header, and in the software trailer
+  static constexpr int N_SW_WORDS = 2;
+  /// total length and the lengths of the six links, two per word
+  static constexpr int N_LENGTH_WORDS = 1 + 3;
   /// the two daq links for the connected HGCROC
   std::array<DAQLinkFrame, 2> daq_links;
   /// the four trigger links
@@ -80,4 +94,23 @@ class SingleROCEventPacket {
   SingleROCEventPacket() = default;
 };
 
+/**
+ * Append one sample as a SIMPLEROC packet
+ *
+ * This is the packing done in software by the targets reading out a
+ * single ROC: the software header, the total length, the lengths of
+ * the links, the data of the links, and the software trailer.
+ * SingleROCEventPacket::from decodes what is between the header and
+ * trailer.
+ *
+ * @param[in] n_links number of links, the two DAQ links of the ROC first
+ * and then its trigger links
+ * @param[in] link_data data of the link with the input index, the trigger
+ * links get a header with their index and length in front of it
+ * @param[in,out] buffer words to append the packet to
+ */
+void write_simpleroc(
+    int n_links, const std::function<std::vector<uint32_t>(int)>& link_data,
+    std::vector<uint32_t>& buffer);
+
 }  // namespace pflib::packing
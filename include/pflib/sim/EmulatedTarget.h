@@ -0,0 +1,229 @@
+#ifndef pflib_sim_EmulatedTarget_h_included
+#define pflib_sim_EmulatedTarget_h_included
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "pflib/ECOND_Formatter.h"
+#include "pflib/Target.h"
+#include "pflib/sim/FrontEnd.h"
+#include "pflib/sim/HGCROC_I2C.h"
+
+namespace pflib {
+namespace sim {
+
+/**
+ * FastControl that records the commands it is asked to send
+ *
+ * Commands are given consecutive bunch crossings of a software clock
+ * which wraps around at the end of each orbit. The counters use the same
+ * names as FastControlCMS_MMap so that the tools reading them work
+ * unchanged. Every L1A is handed to the trigger callback along with the
+ * number of BX since the charge (or LED) pulse preceding it.
+ */
+class RecordingFastControl : public FastControl {
+ public:
+  /// number of BX in one orbit
+  static constexpr int BX_PER_ORBIT = 3564;
+
+  /// a command that was sent
+  struct Command {
+    /// name of the command, same as its counter
+    std::string name;
+    /// bunch crossing it was sent in
+    int bx;
+    /// orbit it was sent in
+    int orbit;
+  };
+
+  /**
+   * called for each L1A with the BX, the L1A counter, the orbit,
+   * and the BX since the charge injection (negative if there was none)
+   */
+  using Trigger = std::function<void(int, int, int, int)>;
+
+  RecordingFastControl();
+
+  /// set who receives the L1As
+  void set_trigger(Trigger trigger) { trigger_ = trigger; }
+
+  /// commands sent so far in the order they were sent
+  const std::vector<Command>& history() const { return history_; }
+  /// forget the commands sent so far
+  void clear_history() { history_.clear(); }
+
+  virtual std::map<std::string, uint32_t> getCmdCounters() override;
+  virtual void resetCounters() override;
+  virtual void sendL1A() override;
+  virtual void linkreset_rocs() override;
+  virtual void linkreset_econs() override;
+  virtual void bx_custom(int bx_addr, int bx_mask, int bx_new) override;
+  virtual void bufferclear() override;
+  virtual void orbit_count_reset() override;
+  virtual void chargepulse() override;
+  virtual void ledpulse() override;
+  virtual void clear_run() override;
+  virtual void fc_setup_calib(int charge_to_l1a) override {
+    charge_to_l1a_ = charge_to_l1a;
+  }
+  virtual int fc_get_setup_calib() override { return charge_to_l1a_; }
+  virtual void fc_setup_led(int led_to_l1a) override {
+    led_to_l1a_ = led_to_l1a;
+  }
+  virtual int fc_get_setup_led() override { return led_to_l1a_; }
+
+ private:
+  /// record the command and advance the clock by the input number of BX
+  void send(const std::string& name, int n_bx = 1);
+  /// send one L1A
+  void l1a(int bx_since_charge);
+  /// send a pulse followed by the L1As of a readout request
+  void pulse(const std::string& name, int pulse_to_l1a);
+
+ private:
+  Trigger trigger_;
+  std::vector<Command> history_;
+  std::map<std::string, uint32_t> counters_;
+  int bx_, orbit_, n_l1a_;
+  int charge_to_l1a_, led_to_l1a_;
+};
+
+/**
+ * Emulated elinks and event buffer
+ *
+ * Each L1A captures the link frames of every ROC into a buffer
+ * which is read out link by link like the real capture. The buffer
+ * has a limited depth, L1As arriving while it is full are dropped.
+ */
+class EmulatedCapture : public Elinks, public DAQ {
+ public:
+  /// the frames of all links for one L1A
+  using Capture = std::vector<std::vector<uint32_t>>;
+
+  /**
+   * Create the capture for the input number of links
+   *
+   * @param[in] nlinks number of links
+   * @param[in] depth number of L1As the buffer can hold
+   */
+  EmulatedCapture(int nlinks, int depth = 64);
+
+  /// store the frames for a new L1A, returns false if the buffer was full
+  bool push(Capture&& capture);
+  /// number of L1As dropped because the buffer was full
+  int dropped() const { return dropped_; }
+
+  virtual std::vector<uint32_t> spy(int ilink) override;
+  virtual void setBitslip(int ilink, int bitslip) override;
+  virtual int getBitslip(int ilink) override { return bitslip_.at(ilink); }
+  virtual int scanBitslip(int ilink) override { return bitslip_.at(ilink); }
+  virtual uint32_t getStatusRaw(int ilink) override { return 0; }
+  virtual void clearErrorCounters(int ilink) override {}
+  virtual void resetHard() override {}
+  virtual void setAlignPhase(int ilink, int iphase) override {
+    phase_.at(ilink) = iphase;
+  }
+  virtual int getAlignPhase(int ilink) override { return phase_.at(ilink); }
+
+  virtual void reset() override;
+  virtual int getEventOccupancy() override;
+  virtual void setupLink(int ilink, int l1a_delay,
+                         int l1a_capture_width) override;
+  virtual void getLinkSetup(int ilink, int& l1a_delay,
+                            int& l1a_capture_width) override;
+  virtual void bufferStatus(int ilink, bool& empty, bool& full) override;
+  virtual std::vector<uint32_t> getLinkData(int ilink) override;
+  virtual void advanceLinkReadPtr() override;
+
+ private:
+  std::size_t depth_;
+  std::deque<Capture> buffer_;
+  int dropped_;
+  std::vector<int> bitslip_, phase_, l1a_delay_, capture_width_;
+};
+
+/**
+ * A Target that exists only in software
+ *
+ * Each ROC sits alone on its own emulated I2C bus (HGCROC_I2C) which
+ * starts out holding the defaults of the chip type. The data produced
+ * for each L1A comes from a FrontEnd model reading those registers so
+ * that configuring the ROCs through the normal interfaces changes the
+ * data like it would on hardware. This allows running pftool and the
+ * analysis of its output without any boards.
+ *
+ * Each ROC has six links (2 DAQ then 4 trigger). The SIMPLEROC format
+ * only includes the links of the first ROC like the Fiberless target,
+ * the ECOND formats put the DAQ links of all ROCs into one ECON-D packet
+ * for each sample. There are no emulated ECONs.
+ */
+class EmulatedTarget : public Target {
+ public:
+  /**
+   * Create the emulated target
+   *
+   * @param[in] nrocs number of ROCs
+   * @param[in] roc_type type_version of the ROCs
+   * @param[in] seed seed for the channel-to-channel variation and noise
+   */
+  EmulatedTarget(int nrocs = 1, const std::string& roc_type = "sipm_rocv3b",
+                 uint64_t seed = 0);
+
+  virtual int nrocs() override { return int(rocs_.size()); }
+  virtual int necons() override { return 0; }
+  virtual bool have_roc(int iroc) const override {
+    return iroc >= 0 and iroc < int(rocs_.size());
+  }
+  virtual std::vector<int> roc_ids() const override;
+  virtual ROC& roc(int which) override;
+  virtual ECON& econ(int which) override {
+    PFEXCEPTION_RAISE("InvalidECONid",
+                      "No ECONs connected for Emulated targets.");
+  }
+  /// put the defaults back into the registers of all ROCs
+  virtual void hardResetROCs() override;
+  virtual uint32_t getFirmwareVersion() override { return 0; }
+
+  virtual Elinks& elinks() override { return *capture_; }
+  virtual FastControl& fc() override { return *fc_; }
+  virtual DAQ& daq() override { return *capture_; }
+  virtual const std::vector<std::pair<int, int>>& getRocErxMapping() override {
+    return roc_to_erx_map_;
+  }
+
+  virtual void setup_run(int irun, DaqFormat format,
+                         int contrib_id = -1) override;
+  virtual std::vector<uint32_t> read_event() override;
+
+  /// register memory of a ROC for looking behind its back
+  HGCROC_I2C& chip(int which) { return *chips_.at(which); }
+  /// front-end model of a ROC
+  FrontEnd& front_end(int which) { return front_ends_.at(which); }
+  /// the fast control with its command history
+  RecordingFastControl& recorder() { return *fc_; }
+  /// the capture holding the events
+  EmulatedCapture& capture() { return *capture_; }
+
+ private:
+  /// capture the frames of all ROCs for an L1A
+  void trigger(int bx, int event, int orbit, int bx_since_charge);
+
+ private:
+  std::string roc_type_;
+  std::vector<std::shared_ptr<HGCROC_I2C>> chips_;
+  std::vector<ROC> rocs_;
+  std::vector<FrontEnd> front_ends_;
+  std::shared_ptr<RecordingFastControl> fc_;
+  std::shared_ptr<EmulatedCapture> capture_;
+  DaqFormat daqformat_;
+  int l1a_;
+  ECOND_Formatter formatter_;
+  /// frames of one ROC, reused between L1As
+  std::array<std::vector<uint32_t>, FrontEnd::N_LINKS> frames_;
+};
+
+}  // namespace sim
+}  // namespace pflib
+
+#endif  // pflib_sim_EmulatedTarget_h_included
@@ -0,0 +1,135 @@
+#ifndef pflib_sim_EventGenerator_h_included
+#define pflib_sim_EventGenerator_h_included
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include "pflib/ECOND_Formatter.h"
+
+namespace pflib {
+namespace sim {
+
+/**
+ * Generator of synthetic raw data for load testing the decoders
+ *
+ * The channels of each DAQ link frame sit on a pedestal with gaussian
+ * noise. With a probability given by the occupancy, a channel is hit
+ * instead and gets an exponentially falling amplitude on top of its
+ * pedestal with a non-zero TOA. Amplitudes beyond the ADC range are
+ * written in TOT mode. The same seed always gives the same events.
+ *
+ * The frames are packaged in one of the formats the decoders read
+ * - SIMPLEROC: one ROC with the software header and trailer of
+ *   SingleROCEventPacket around each sample (pfdecoder)
+ * - ECOND: for each ECON-D, the samples as packets from ECOND_Formatter
+ *   behind the software DAQ headers and followed by the ending trailer
+ *   (econd-decoder)
+ * - ROGUE: the same ECON-D packets behind the LDMX readout request
+ *   header and wrapped as records of a rogue data file (rogue-decoder)
+ *
+ * Defects are injected into packets at the requested rates. For SIMPLEROC
+ * they hit one of the DAQ link frames, for the ECON-D formats the ECON-D
+ * packet.
+ * - bad CRC: one bit of the CRC is flipped
+ * - truncated: the DAQ link frame is cut short (with the lengths in the
+ *   header still matching) or the ECON-D packet is truncated to its
+ *   header and CRC like the ECON-D does on a buffer overflow
+ * - bad header: the marker of the link frame header or the ECON-D event
+ *   header is wrong, the CRCs still match
+ */
+class EventGenerator {
+ public:
+  /// format of the generated data
+  enum class Format { SIMPLEROC, ECOND, ROGUE };
+
+  /// what to generate
+  struct Config {
+    Format format{Format::ECOND};
+    /// probability for each channel to be hit
+    double occupancy{0.1};
+    /// number of samples (L1As) for each event
+    int n_samples{1};
+    /// index of the sample of interest
+    int i_soi{0};
+    /// number of eRx on each ECON-D
+    int n_links{2};
+    /// number of ECON-Ds
+    int n_econs{1};
+    /// zero suppress the pedestals in the ECON-D
+    bool zero_suppression{true};
+    /// seed for the random numbers
+    uint64_t seed{0};
+    /// contributor ID in the readout request header (ROGUE only)
+    int contrib_id{20};
+    /// probability for each packet to have a bad CRC
+    double bad_crc_rate{0.};
+    /// probability for each packet to be truncated
+    double truncation_rate{0.};
+    /// probability for each packet to have a bad header
+    double bad_header_rate{0.};
+  };
+
+  /// number of packets with each defect so far
+  struct Injected {
+    uint64_t bad_crc{0};
+    uint64_t truncated{0};
+    uint64_t bad_header{0};
+  };
+
+  /// mean pedestal of the channels in ADC counts
+  static constexpr int PEDESTAL = 100;
+  /// ADC threshold of the zero suppression
+  static constexpr int ZS_THRESHOLD = PEDESTAL + 20;
+
+  /**
+   * Create the generator, checking the configuration
+   *
+   * @throws pflib::Exception if the configuration is not possible
+   */
+  EventGenerator(const Config& cfg);
+
+  /**
+   * Generate the next event
+   *
+   * @param[out] event words of the event, replacing what was there
+   */
+  void next(std::vector<uint32_t>& event);
+
+  /// number of events generated so far
+  uint64_t n_events() const { return n_events_; }
+  /// defects injected so far
+  const Injected& injected() const { return injected_; }
+
+ private:
+  /// advance the clock to the next L1A
+  void l1a();
+  /// build a DAQ link frame for the current L1A into the input frame
+  void daq_link_frame(std::vector<uint32_t>& frame, bool bad_header);
+  /// one channel word with the pedestal or a hit
+  uint32_t channel_word();
+  /// append one sample as a SIMPLEROC packet
+  void simpleroc(std::vector<uint32_t>& event);
+  /// append all the samples of one ECON-D
+  void econd(int i_econ, std::vector<uint32_t>& event);
+  /// draw if a defect should happen with the input rate
+  bool chance(double rate);
+
+ private:
+  Config cfg_;
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> uniform_;
+  std::normal_distribution<double> noise_;
+  std::exponential_distribution<double> amplitude_;
+  ECOND_Formatter formatter_;
+  /// frames reused between samples
+  std::vector<std::vector<uint32_t>> frames_;
+  int bx_, orbit_, l1a_;
+  uint64_t n_events_, n_bx_;
+  Injected injected_;
+};
+
+}  // namespace sim
+}  // namespace pflib
+
+#endif  // pflib_sim_EventGenerator_h_included
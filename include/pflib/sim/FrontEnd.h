@@ -0,0 +1,150 @@
+#ifndef pflib_sim_FrontEnd_h_included
+#define pflib_sim_FrontEnd_h_included
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pflib/Compile.h"
+#include "pflib/sim/HGCROC_I2C.h"
+
+namespace pflib {
+namespace sim {
+
+/**
+ * Simple model of the analog front end of an HGCROC
+ *
+ * The model reads the parameters it needs from the register memory of
+ * an HGCROC_I2C (decoded with the Compiler for the chip type) so that
+ * configuring the emulated chip through a ROC changes the data it
+ * produces. The parameters are decoded again whenever the registers
+ * have been written.
+ *
+ * Pedestals
+ * - each channel has a fixed offset drawn from the seed around 100 ADC
+ * - TRIM_INV raises the pedestal and DACB lowers (SIGN_DAC = 1) or
+ *   raises (SIGN_DAC = 0) it on the SiPM ROCs which have these
+ * - INV_VREF and NOINV_VREF of the half move all of its channels
+ * - gaussian noise is added to each sample
+ *
+ * Charge injection (REFERENCEVOLTAGE_N.INTCTEST with CH_M.HIGHRANGE or
+ * LOWRANGE set)
+ * - the amplitude is proportional to CALIB of the half, larger for
+ *   HIGHRANGE than for LOWRANGE
+ * - the pulse is a CR-RC shape peaking one BX after the charge, the
+ *   sampled time is set by the number of BX between the charge and
+ *   the L1A relative to DIGITALHALF_N.L1OFFSET and by TOP.PHASE_STROBE,
+ *   the peak is read when the L1A comes L1OFFSET+4 BX after the charge
+ * - TOA fires above a threshold set by TOA_VREF and TRIM_TOA
+ * - TOT replaces the ADC above a threshold set by TOT_VREF and TRIM_TOT
+ *
+ * The trigger links carry valid headers with all sums zero.
+ */
+class FrontEnd {
+ public:
+  /// number of 32-bit words in a DAQ link frame
+  static constexpr int DAQ_FRAME_WORDS = 40;
+  /// number of 32-bit words in a trigger link frame
+  static constexpr int TRIGGER_FRAME_WORDS = 4;
+  /// number of links (2 DAQ links followed by 4 trigger links)
+  static constexpr int N_LINKS = 6;
+
+  /**
+   * Model the chip with the input registers
+   *
+   * @param[in] chip register memory of the chip, must outlive the model
+   * @param[in] type_version chip type used to decode the registers
+   * @param[in] seed seed for the channel offsets and the noise
+   */
+  FrontEnd(const HGCROC_I2C& chip, const std::string& type_version,
+           uint64_t seed);
+
+  /// width of the pedestal noise in ADC counts
+  void set_noise(double sigma) { noise_ = sigma; }
+
+  /**
+   * Produce the link frames for one L1A
+   *
+   * @param[in] bx bunch crossing of the L1A
+   * @param[in] event L1A counter
+   * @param[in] orbit orbit counter
+   * @param[in] bx_since_charge number of BX between a charge injection
+   * and this L1A, negative if there was none
+   * @param[out] links frames of the links, 2 DAQ then 4 trigger, the
+   * vectors are reused so that no allocation happens once they are sized
+   */
+  void readout(int bx, int event, int orbit, int bx_since_charge,
+               std::array<std::vector<uint32_t>, N_LINKS>& links);
+
+  /// expected pedestal of a channel (0-71) with the current registers
+  double pedestal(int channel);
+
+ private:
+  /// per-channel parameters we use, in the order they are resolved
+  enum ChannelParameter {
+    TRIM_INV,
+    DACB,
+    SIGN_DAC,
+    HIGHRANGE,
+    LOWRANGE,
+    TRIM_TOA,
+    TRIM_TOT,
+    N_CHANNEL_PARAMETERS
+  };
+  /// per-half parameters we use, in the order they are resolved
+  enum HalfParameter {
+    INV_VREF,
+    NOINV_VREF,
+    TOA_VREF,
+    TOT_VREF,
+    CALIB,
+    INTCTEST,
+    L1OFFSET,
+    N_HALF_PARAMETERS
+  };
+  /// state of one channel deduced from the parameters
+  struct Channel {
+    /// fixed offset of this channel from the seed
+    double offset;
+    /// mean ADC without charge
+    double pedestal;
+    /// peak of an injected pulse above the pedestal in ADC
+    double amplitude;
+    /// pulse height above pedestal where TOA fires
+    double toa_threshold;
+    /// ADC value above which TOT is measured
+    double tot_threshold;
+  };
+  /// decode the registers again if they changed
+  void update();
+  /// build the 32-bit word for one channel
+  uint32_t sample(const Channel& ch, double t_ns);
+
+ private:
+  const HGCROC_I2C& chip_;
+  /// handles to the channel parameters, channels 0-71 then the calib channels
+  std::array<std::array<ParameterHandle, N_CHANNEL_PARAMETERS>, 74>
+      channel_handles_;
+  /// handles to the parameters of each half
+  std::array<std::array<ParameterHandle, N_HALF_PARAMETERS>, 2> half_handles_;
+  ParameterHandle phase_strobe_;
+  /// pages holding parameters we use
+  std::vector<int> pages_;
+  /// chip revision the channel parameters were decoded at
+  int revision_;
+  /// channels 0-71 followed by the two calib channels
+  std::array<Channel, 74> channels_;
+  /// L1A latency of each half
+  std::array<int, 2> l1offset_;
+  /// strobe phase in ns
+  double phase_ns_;
+  double noise_;
+  std::mt19937_64 rng_;
+  std::normal_distribution<double> gauss_;
+};
+
+}  // namespace sim
+}  // namespace pflib
+
+#endif  // pflib_sim_FrontEnd_h_included
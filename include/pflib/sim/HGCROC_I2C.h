@@ -0,0 +1,144 @@
+#ifndef pflib_sim_HGCROC_I2C_h_included
+#define pflib_sim_HGCROC_I2C_h_included
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+#include "pflib/I2C.h"
+
+namespace pflib {
+namespace sim {
+
+/**
+ * Software model of an HGCROC sitting alone on an I2C bus
+ *
+ * The HGCROC occupies eight consecutive I2C addresses starting
+ * at its base address.
+ * - R0 (base+0) : least significant byte of the register pointer
+ * - R1 (base+1) : most significant byte of the register pointer
+ * - R2 (base+2) : data at the register pointer
+ * - R3 (base+3) : data at the register pointer, pointer is incremented
+ *   after each byte
+ * - R4-R7 (base+4 to base+7) : direct access registers
+ *
+ * The register pointer is the full address (page << 5) | offset.
+ * Any other I2C address on the bus does not acknowledge.
+ *
+ * Every transaction (a write or a read) is counted along with the
+ * bytes it moves and the time it would take on a real bus at the
+ * current bus speed. Transactions can also be slowed down by a fixed
+ * latency and made to fail (not acknowledge) so that the retries and
+ * the configuration sequences above this layer can be exercised and
+ * measured without a board.
+ */
+class HGCROC_I2C : public ::pflib::I2C {
+ public:
+  /**
+   * Create the model
+   *
+   * @param[in] roc_base_addr I2C address of R0
+   * @param[in] max_transfer_bytes largest transfer we accept in one
+   * general_write_read, defaults to the lpGBT I2C master limit
+   */
+  HGCROC_I2C(uint8_t roc_base_addr, int max_transfer_bytes = 16);
+
+  virtual void set_bus_speed(int speed = 100) { speed_ = speed; }
+  virtual int get_bus_speed() { return speed_; }
+  virtual void write_byte(uint8_t i2c_dev_addr, uint8_t data);
+  virtual uint8_t read_byte(uint8_t i2c_dev_addr);
+  virtual std::vector<uint8_t> general_write_read(
+      uint8_t i2c_dev_addr, const std::vector<uint8_t>& wdata, int nread = 0);
+  virtual int max_transfer_bytes() const { return max_transfer_bytes_; }
+
+  /// look at a register without going through I2C
+  uint8_t peek(int page, int offset) const;
+  /// change a register without going through I2C
+  void poke(int page, int offset, uint8_t value);
+
+  /// number of I2C transactions (a write or a read) seen so far
+  int transactions() const { return n_transactions_; }
+  /// number of data bytes written so far
+  int bytes_written() const { return n_bytes_written_; }
+  /// number of data bytes read so far
+  int bytes_read() const { return n_bytes_read_; }
+  /**
+   * time the transactions so far would have taken on the bus
+   *
+   * Each transaction is a start, the address byte, the data bytes and a
+   * stop where each byte takes nine clock cycles (with its acknowledge).
+   * Failed transactions only take the address byte.
+   */
+  double bus_time_us() const { return bus_time_us_; }
+  /// number of transactions that failed on purpose so far
+  int injected_errors() const { return n_injected_errors_; }
+  /// reset the transaction, byte, time, and error counters
+  void reset_transactions();
+
+  /**
+   * wait this long in every transaction
+   *
+   * This is real time spent in the calling thread, e.g. for
+   * checking that independent buses are configured concurrently.
+   */
+  void set_latency(std::chrono::microseconds latency) { latency_ = latency; }
+
+  /**
+   * fail the transactions starting after the input number of
+   * transactions from now
+   *
+   * The failing transactions do not acknowledge their address and throw
+   * I2CErrorNoACK without touching the registers.
+   *
+   * @param[in] n_ok number of transactions that succeed before the failures
+   * @param[in] n_fail number of failing transactions in a row
+   */
+  void fail_after(int n_ok, int n_fail = 1);
+
+  /**
+   * fail every n-th transaction
+   *
+   * @param[in] n period of the failures, less than one to stop failing
+   */
+  void fail_every(int n) { fail_every_ = n; }
+
+  /**
+   * number of writes into the register memory so far
+   *
+   * Models of the chip's behavior can compare this to a value they
+   * stored earlier to know if they need to look at the registers again.
+   */
+  int revision() const { return revision_; }
+
+ private:
+  /// convert the I2C address to a sub-register, throw if it isn't ours
+  int sub_address(uint8_t i2c_dev_addr) const;
+  /// write a single byte into one of the sub-registers
+  void write_sub(int sub, uint8_t data);
+  /// read a single byte from one of the sub-registers
+  uint8_t read_sub(int sub);
+  /// account for a transaction of n_bytes, throw if it is meant to fail
+  void transaction(int n_bytes);
+
+ private:
+  uint8_t roc_base_;
+  int max_transfer_bytes_;
+  int speed_;
+  uint16_t pointer_;
+  std::vector<uint8_t> memory_;
+  std::array<uint8_t, 4> direct_access_;
+  int n_transactions_;
+  int n_bytes_written_, n_bytes_read_;
+  double bus_time_us_;
+  std::chrono::microseconds latency_;
+  /// transactions to go before and during the requested failures
+  int n_until_fail_, n_fail_;
+  int fail_every_;
+  int n_injected_errors_;
+  int revision_;
+};
+
+}  // namespace sim
+}  // namespace pflib
+
+#endif  // pflib_sim_HGCROC_I2C_h_included
@@ -0,0 +1,60 @@
+#ifndef pflib_sim_ICEC_ZCU_h_included
+#define pflib_sim_ICEC_ZCU_h_included
+
+#include <deque>
+
+#include "pflib/zcu/lpGBT_ICEC_ZCU_Simple.h"
+
+namespace pflib {
+namespace sim {
+
+/**
+ * Software model of the ZCU IC/EC firmware block and the lpGBT
+ * answering on the other side of the link
+ *
+ * Register writes are loaded into the TX FIFO and sent as one frame
+ * when the write is started. A read request produces a reply of six
+ * header bytes, the register values and a parity byte in the RX FIFO.
+ * The register accesses are forwarded to the given lpGBT transport,
+ * usually a lpGBT_Model. Frames addressed to another lpGBT are
+ * silently dropped like on the link.
+ */
+class ICEC_ZCU : public ::pflib::zcu::lpGBT_ICEC_Simple::Registers {
+ public:
+  ICEC_ZCU(::pflib::lpGBT_ConfigTransport& lpgbt, bool isEC,
+           uint8_t lpgbt_i2c_addr);
+
+  virtual uint32_t read(size_t i);
+  virtual void write(size_t where, uint32_t what);
+
+  /// number of status reads a reply takes to show up after a read starts
+  void set_reply_delay(int polls) { reply_delay_ = polls; }
+
+  /// number of IC frames (read requests or writes) sent so far
+  int frames() const { return n_frames_; }
+  /// number of firmware register reads and writes so far
+  int accesses() const { return n_accesses_; }
+  /// reset the counters
+  void reset_counters() {
+    n_frames_ = 0;
+    n_accesses_ = 0;
+  }
+
+ private:
+  ::pflib::lpGBT_ConfigTransport& lpgbt_;
+  int offset_;
+  int offset_status_;
+  uint8_t lpgbt_i2c_addr_;
+  uint32_t tx_data_;
+  std::deque<uint32_t> tx_fifo_;
+  std::deque<uint8_t> rx_fifo_;
+  int reply_delay_;
+  int reply_wait_;
+  int n_frames_;
+  int n_accesses_;
+};
+
+}  // namespace sim
+}  // namespace pflib
+
+#endif  // pflib_sim_ICEC_ZCU_h_included
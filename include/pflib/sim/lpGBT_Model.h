@@ -0,0 +1,83 @@
+#ifndef pflib_sim_lpGBT_Model_h_included
+#define pflib_sim_lpGBT_Model_h_included
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "pflib/I2C.h"
+#include "pflib/lpGBT.h"
+
+namespace pflib {
+namespace sim {
+
+/**
+ * Software model of the lpGBT register space as seen through its
+ * configuration transport
+ *
+ * Only the I2C masters are modeled beyond plain memory. Writing to
+ * the command register of a master executes the command against the
+ * I2C device attached to that master (if any). The status register of
+ * the master reads zero until the time the transaction would take on
+ * the bus has passed and then reports success (or no acknowledge if
+ * the device threw an exception). The multi-byte read data is stored
+ * backwards ending at READ15 like in the chip.
+ */
+class lpGBT_Model : public ::pflib::lpGBT_ConfigTransport {
+ public:
+  lpGBT_Model();
+
+  virtual uint8_t read_reg(uint16_t reg);
+  virtual void write_reg(uint16_t reg, uint8_t value);
+  virtual std::vector<uint8_t> read_regs(uint16_t reg, int n);
+  virtual void write_regs(uint16_t reg, const std::vector<uint8_t>& value);
+
+  /// attach an I2C device model to one of the masters
+  void attach(int ibus, std::shared_ptr<::pflib::I2C> device);
+
+  /// extra time each I2C transaction takes (e.g. clock stretching)
+  void set_stretch_us(int us) { stretch_us_ = us; }
+
+  /// look at a register without going through the transport
+  uint8_t peek(uint16_t reg) const { return memory_.at(reg); }
+  /// change a register without going through the transport
+  void poke(uint16_t reg, uint8_t value) { memory_.at(reg) = value; }
+
+  /// number of transport transactions (single or multi-register) so far
+  int transactions() const { return n_transactions_; }
+  /// number of transport reads that included a master status register
+  int status_polls() const { return n_status_polls_; }
+  /// reset the counters
+  void reset_counters() {
+    n_transactions_ = 0;
+    n_status_polls_ = 0;
+  }
+
+ private:
+  /// read a register, returning zero for busy master status registers
+  uint8_t get(uint16_t reg);
+  /// write a register, executing master commands
+  void set(uint16_t reg, uint8_t value);
+  /// execute a command on one of the I2C masters
+  void execute(int ibus, uint8_t cmd);
+
+ private:
+  std::vector<uint8_t> memory_;
+  struct Master {
+    std::shared_ptr<::pflib::I2C> device;
+    uint8_t ctl_reg{0};
+    std::array<uint8_t, 16> buffer{};
+    uint8_t status{0};
+    std::chrono::steady_clock::time_point done;
+  };
+  std::array<Master, 3> masters_;
+  int stretch_us_;
+  int n_transactions_;
+  int n_status_polls_;
+};
+
+}  // namespace sim
+}  // namespace pflib
+
+#endif  // pflib_sim_lpGBT_Model_h_included
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace pflib::utility {
+
+/**
+ * A fixed-size pool of worker threads running submitted jobs
+ *
+ * Jobs are run in the order they are submitted, as soon as a worker
+ * is free. The destructor waits for all submitted jobs to finish.
+ *
+ * ```cpp
+ * pflib::utility::ThreadPool pool(4);
+ * auto result = pool.submit([]() { return 42; });
+ * int v = result.get(); // re-throws any exception from the job
+ * ```
+ */
+class ThreadPool {
+ public:
+  /**
+   * Start the workers
+   *
+   * @param[in] n_threads number of workers, values less than one
+   * use the number of hardware threads
+   */
+  explicit ThreadPool(int n_threads = 0);
+
+  /// wait for submitted jobs and stop the workers
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// number of workers in the pool
+  std::size_t size() const { return workers_.size(); }
+
+  /**
+   * Submit a job to the pool
+   *
+   * @param[in] job callable taking no arguments
+   * @return future holding the result (or exception) of the job
+   */
+  template <typename Job>
+  auto submit(Job&& job) -> std::future<decltype(job())> {
+    using Result = decltype(job());
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<Job>(job));
+    std::future<Result> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.emplace([task]() { (*task)(); });
+    }
+    job_available_.notify_one();
+    return result;
+  }
+
+ private:
+  /// loop run by each worker
+  void work();
+
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> jobs_;
+  std::mutex mutex_;
+  std::condition_variable job_available_;
+  bool stopping_;
+};
+
+}  // namespace pflib::utility
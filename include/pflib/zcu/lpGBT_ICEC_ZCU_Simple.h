@@ -1,6 +1,8 @@
 #ifndef PFLIB_lpGBT_ICEC_H_INCLUDED
 #define PFLIB_lpGBT_ICEC_H_INCLUDED
 
+#include <memory>
+
 #include "pflib/lpGBT.h"
 #include "pflib/zcu/UIO.h"
 
@@ -14,8 +16,26 @@ namespace zcu {
  */
 class lpGBT_ICEC_Simple : public lpGBT_ConfigTransport {
  public:
+  /**
+   * Access to the registers of the IC/EC firmware block
+   *
+   * Normally this is the UIO block but a software model can be
+   * put in its place for testing.
+   */
+  class Registers {
+   public:
+    virtual ~Registers() = default;
+    virtual uint32_t read(size_t i) = 0;
+    virtual void write(size_t where, uint32_t what) = 0;
+  };
+
+  /// largest number of register bytes the firmware carries in one IC frame
+  static constexpr int MAX_FRAME_BYTES = 8;
+
   lpGBT_ICEC_Simple(const std::string& target, bool isEC,
                     uint8_t lpgbt_i2c_addr);
+  lpGBT_ICEC_Simple(std::shared_ptr<Registers> registers, bool isEC,
+                    uint8_t lpgbt_i2c_addr);
   virtual ~lpGBT_ICEC_Simple() {}
 
   virtual std::vector<uint8_t> read_regs(uint16_t reg, int n);
@@ -23,6 +43,15 @@ class lpGBT_ICEC_Simple : public lpGBT_ConfigTransport {
   virtual uint8_t read_reg(uint16_t reg);
   virtual void write_reg(uint16_t reg, uint8_t value);
 
+ private:
+  /// reset the FIFOs of the firmware block
+  void reset();
+  /// wait until the status register has the mask bits set (or cleared)
+  uint32_t wait_status(uint32_t mask, bool set, const char* what,
+                       uint16_t reg);
+  /// read up to MAX_FRAME_BYTES registers with a single IC frame
+  void read_frame(uint16_t reg, int n, std::vector<uint8_t>& retval);
+
  private:
   /// Offset depending on EC/IC
   int offset_;
@@ -30,7 +59,7 @@ class lpGBT_ICEC_Simple : public lpGBT_ConfigTransport {
   /// i2c address of the device
   uint8_t lpgbt_i2c_addr_;
   /// UIO block
-  UIO transport_;
+  std::shared_ptr<Registers> transport_;
 };
 
 }  // namespace zcu
@@ -6,6 +6,8 @@ from dataclasses import dataclass, asdict
 from typing import List, Dict
 from pathlib import Path
 
+import perfect_hash
+
 
 def byte_pair_to_subblock_register(r0, r1):
     fulladdr = (r1 << 8) | r0
@@ -208,22 +210,18 @@ with open(args.output.with_suffix('.h'), 'w') as f:
             for parameter_name, parameter_spec in parameters.items()
         ))
         f.write('  return the_map;\n')
-        f.write('} // get_%s()\n'%(name))
-        f.write('\nconst Page %s = get_%s();\n\n'%(name,name))
-
-    f.write('const PageLUT PAGE_LUT = PageLUT::Mapping({\n')
-    f.write(',\n'.join(
-        '  {"%s", %s }'%(name, name)
-        for name in subblock_types
-    ))
-    f.write('\n});\n\n')
-
-    f.write('const ParameterLUT PARAMETER_LUT = ParameterLUT::Mapping({\n')
-    f.write(',\n'.join(
-        '  {"%s", { %d, %s }}'%(name, subblock.address, subblock.type)
-        for name, subblock in subblocks.items()
+        f.write('} // get_%s()\n\n'%(name))
+        _sorted, table = perfect_hash.to_cpp(f'{name}_PARAMETERS', parameters.keys())
+        f.write(table)
+        f.write('\n')
+
+    f.write(perfect_hash.register_map_cpp(
+        pages = [(name, f'get_{name}()') for name in subblock_types],
+        page_lut = list(subblock_types),
+        parameter_lut = [
+            (name, subblock.address, subblock.type)
+            for name, subblock in subblocks.items()
+        ],
+        page_tables = 'PAGE_TABLE'
     ))
-    f.write('\n});\n\n')
-    f.write('} // namespace %s\n'%(args.namespace))
-
-
+    f.write('\n} // namespace %s\n'%(args.namespace))
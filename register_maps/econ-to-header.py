@@ -1,7 +1,10 @@
 import sys
+import re
 import yaml
 from pathlib import Path
 
+import perfect_hash
+
 def count_bits(mask):
     """Count number of 1s in the binary representation of mask."""
     return bin(mask).count("1")
@@ -214,21 +217,25 @@ def generate_header(input_yaml, data, econ_type):
                     process_register(name_prefix, props, lines, register_byte_lut)
             
         page_names.append(page_var)
+        # parameter names are only known from the lines we just wrote
+        param_names = [
+            m.group(1)
+            for line in lines[lines.index(f"static Page::Mapping get_{page_var}() {{"):]
+            for m in [re.match(r'  the_map\["([^"]+)"\]', line)] if m
+        ]
         lines.append("  return the_map;")
         lines.append(f"}} // get_{page_var}\n")
-        lines.append(f"const Page {page_var} = get_{page_var}();\n")
+        _sorted, table = perfect_hash.to_cpp(f"{page_var}_PARAMETERS", param_names)
+        lines.append(table)
 
     # print(register_byte_lut)
-        
-    lines.append("\nconst PageLUT PAGE_LUT = PageLUT::Mapping({")
-    for name in page_names:
-        lines.append(f'  {{"{name}", {name}}},')
-    lines.append("});")
 
-    lines.append("\nconst ParameterLUT PARAMETER_LUT = ParameterLUT::Mapping({")
-    for name in page_names:
-        lines.append(f'  {{"{name}", {{0, {name}}}}},')
-    lines.append("});")
+    lines.append(perfect_hash.register_map_cpp(
+        pages = [(name, f"get_{name}()") for name in page_names],
+        page_lut = page_names,
+        parameter_lut = [(name, 0, name) for name in page_names],
+        page_tables = "PAGE_TABLE"
+    ))
     
     lines.append("\n} //"+f" namespace econ{econ_type}\n")
 
@@ -0,0 +1,133 @@
+"""Write sorted name tables with a perfect hash for the C++ LUT headers
+
+The hash and lookup must match NameTable and name_hash defined in
+register_maps/register_maps_types.h.
+
+We use a simple "hash and displace" scheme. Names are first put into
+buckets by their hash with seed zero. Then, starting with the largest
+bucket, we search for a displacement (used as the seed of a second hash)
+which puts all of the names in that bucket into free slots. A lookup then
+only needs two hashes and a single string comparison to confirm the name.
+"""
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+
+
+def name_hash(seed, name):
+    """FNV-1a hash of the name starting from a seeded offset basis
+
+    The high bits are folded into the low bits at the end since the
+    low bits of FNV-1a alone are not well mixed for short names.
+    """
+    h = (FNV_OFFSET ^ seed) & 0xFFFFFFFF
+    for c in name.encode('ascii'):
+        h ^= c
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h ^ (h >> 16)
+
+
+def build(names):
+    """Build the perfect hash for the input names
+
+    Returns
+    -------
+    (names, displacements, slots)
+        names sorted in the same order as a std::map<std::string>,
+        displacement for each bucket, and index into names for each slot
+    """
+    names = sorted(set(names))
+    n = len(names)
+    n_buckets = max(1, (n + 3) // 4)
+    n_slots = max(1, n + n // 4)
+    buckets = [[] for _ in range(n_buckets)]
+    for i, name in enumerate(names):
+        buckets[name_hash(0, name) % n_buckets].append(i)
+
+    empty = 0xFFFF
+    displacements = [0] * n_buckets
+    slots = [empty] * n_slots
+    for b in sorted(range(n_buckets), key=lambda b: -len(buckets[b])):
+        bucket = buckets[b]
+        if not bucket:
+            continue
+        for d in range(1, 0xFFFF):
+            positions = [name_hash(d, names[i]) % n_slots for i in bucket]
+            if len(set(positions)) == len(positions) and all(slots[p] == empty for p in positions):
+                break
+        else:
+            raise ValueError('Unable to find a perfect hash for the names.')
+        displacements[b] = d
+        for i, p in zip(bucket, positions):
+            slots[p] = i
+
+    return names, displacements, slots
+
+
+def _wrap(values, indent='  ', per_line=16):
+    values = list(values)
+    return ',\n'.join(
+        indent + ', '.join(values[i:i + per_line])
+        for i in range(0, len(values), per_line)
+    )
+
+
+def to_cpp(cpp_name, names):
+    """Write the C++ definition of a NameTable named cpp_name holding names
+
+    Returns the sorted names so callers can write other tables in the same order.
+    """
+    names, displacements, slots = build(names)
+    lines = []
+    lines.append(f'constexpr std::string_view {cpp_name}_NAMES[] = {{')
+    lines.append(_wrap((f'"{n}"' for n in names), per_line=4))
+    lines.append('};')
+    lines.append(f'constexpr uint16_t {cpp_name}_DISPLACEMENTS[] = {{')
+    lines.append(_wrap(str(d) for d in displacements))
+    lines.append('};')
+    lines.append(f'constexpr uint16_t {cpp_name}_SLOTS[] = {{')
+    lines.append(_wrap(str(s) for s in slots))
+    lines.append('};')
+    lines.append(f'constexpr NameTable {cpp_name}{{')
+    lines.append(f'  {cpp_name}_NAMES, {len(names)},')
+    lines.append(f'  {cpp_name}_DISPLACEMENTS, {len(displacements)},')
+    lines.append(f'  {cpp_name}_SLOTS, {len(slots)}}};')
+    return names, '\n'.join(lines) + '\n'
+
+
+def register_map_cpp(pages, page_lut, parameter_lut, page_tables):
+    """Write the function returning the RegisterMap for a chip
+
+    The pages and LUTs are function-local statics so that they are
+    only built when the chip type is used.
+
+    Parameters
+    ----------
+    pages: list of (page type name, C++ expression constructing it)
+    page_lut: list of (page type name) in PAGE_LUT
+    parameter_lut: list of (page name, page number, page type name)
+    page_tables: C++ name of the NameTable of page names
+    """
+    page_names, page_table_cpp = to_cpp(page_tables, [name for name, _, _ in parameter_lut])
+    page_type = {name: t for name, _, t in parameter_lut}
+    lines = [page_table_cpp]
+    lines.append('constexpr const NameTable* PARAMETER_TABLES[] = {')
+    lines.append(',\n'.join(f'  &{page_type[name]}_PARAMETERS' for name in page_names))
+    lines.append('};\n')
+    lines.append('inline const RegisterMap& register_map() {')
+    for name, construct in pages:
+        lines.append(f'  static const Page {name} = {construct};')
+    lines.append('  static const PageLUT PAGE_LUT = PageLUT::Mapping({')
+    lines.append(',\n'.join(f'    {{"{name}", {name}}}' for name in page_lut))
+    lines.append('  });')
+    lines.append('  static const ParameterLUT PARAMETER_LUT = ParameterLUT::Mapping({')
+    lines.append(',\n'.join(
+        f'    {{"{name}", {{{address}, {t}}}}}'
+        for name, address, t in parameter_lut
+    ))
+    lines.append('  });')
+    lines.append('  static const RegisterMap the_map{PAGE_LUT, PARAMETER_LUT,')
+    lines.append(f'                                   &{page_tables}, PARAMETER_TABLES}};')
+    lines.append('  return the_map;')
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
@@ -15,6 +15,7 @@
 
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 /**
@@ -128,3 +129,72 @@ using ParameterLUT = NoCopyMap<std::string, std::pair<int, const Page&>>;
 
 /// direct access parameters LUT
 using DirectAccessParameterLUT = NoCopyMap<std::string, DirectAccessParameter>;
+
+/**
+ * FNV-1a hash of a name with a seeded offset basis
+ *
+ * This must match name_hash in register_maps/perfect_hash.py
+ * which is used to generate the NameTable contents.
+ */
+constexpr uint32_t name_hash(uint32_t seed, std::string_view name) {
+  uint32_t h = 2166136261u ^ seed;
+  for (char c : name) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 16777619u;
+  }
+  // fold high bits into the low bits used by the modulus
+  return h ^ (h >> 16);
+}
+
+/**
+ * A sorted list of names with a perfect hash for looking them up
+ *
+ * The names are sorted in the same order as the keys of the std::map
+ * holding the corresponding LUT so the index of a name is also the
+ * position of its entry in the LUT. The tables are written by
+ * register_maps/perfect_hash.py.
+ */
+struct NameTable {
+  /// sorted names
+  const std::string_view* names;
+  /// number of names
+  std::size_t size;
+  /// second-hash seed for each bucket of the first hash
+  const uint16_t* displacements;
+  /// number of buckets
+  std::size_t n_buckets;
+  /// index into names for each slot of the second hash
+  const uint16_t* slots;
+  /// number of slots
+  std::size_t n_slots;
+
+  /**
+   * Find the index of the input name
+   *
+   * @param[in] name name to look for (already in all caps)
+   * @return index of name in names or -1 if the name is not present
+   */
+  constexpr int find(std::string_view name) const {
+    if (size == 0) return -1;
+    uint32_t d = displacements[name_hash(0, name) % n_buckets];
+    uint16_t i = slots[name_hash(d, name) % n_slots];
+    if (i >= size or names[i] != name) return -1;
+    return i;
+  }
+};
+
+/**
+ * Everything the compiler needs to know about a chip type
+ *
+ * The name tables are optional (nullptr) for maps that were not generated.
+ */
+struct RegisterMap {
+  /// abstract pages by type name
+  const PageLUT& page_lut;
+  /// concrete pages by page name
+  const ParameterLUT& parameter_lut;
+  /// perfect-hashed names of the pages in parameter_lut
+  const NameTable* page_names;
+  /// perfect-hashed parameter names of each page in page_names order
+  const NameTable* const* parameter_names;
+};
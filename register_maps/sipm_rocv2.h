@@ -354,4 +354,13 @@ const ParameterLUT PARAMETER_LUT = ParameterLUT::Mapping(
      {"CHANNEL_70", {36, CHANNEL_WISE_LUT}},
      {"CHANNEL_71", {37, CHANNEL_WISE_LUT}}});
 
+/**
+ * This legacy map is written by hand and so it does not have
+ * the perfect-hash name tables that the generated maps have.
+ */
+inline const RegisterMap& register_map() {
+  static const RegisterMap the_map{PAGE_LUT, PARAMETER_LUT, nullptr, nullptr};
+  return the_map;
+}
+
 }  // namespace sipm_rocv2
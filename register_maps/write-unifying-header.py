@@ -26,7 +26,7 @@ parser.add_argument(
 )
 args = parser.parse_args()
 
-lut_of_luts_type = 'const std::map<std::string, std::pair<const PageLUT&, const ParameterLUT&>>'
+lut_of_luts_type = 'const std::map<std::string, const RegisterMap& (*)()>'
 
 with open(args.output_header, 'w') as f:
     f.write('/* auto generated from scratch */\n\n')
@@ -49,11 +49,12 @@ with open(args.output_src, 'w') as f:
     f.write(f'{lut_of_luts_type}&\n')
     f.write('get() {\n')
     f.write('  // name the register maps so they can be retrieved by name\n')
+    f.write('  // the maps themselves are only built once they are retrieved\n')
     all_types = args.roc_types + args.econ_types
     f.write(f'  static {lut_of_luts_type}\n')
     f.write('  REGISTER_MAP_BY_TYPE = {\n')
     f.write(',\n'.join(
-        '    {"%s", {%s::PAGE_LUT, %s::PARAMETER_LUT}}'%(rt,rt,rt)
+        '    {"%s", &%s::register_map}'%(rt,rt)
         for rt in all_types
     ))
     f.write('\n  };\n')
@@ -1,14 +1,18 @@
 #include "pflib/Compile.h"
 
-#include <strings.h>
 #include <yaml-cpp/yaml.h>
 
 #include <algorithm>
 #include <cinttypes>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <unordered_map>
 
+#include "pflib/CompileCache.h"
 #include "pflib/Exception.h"
 #include "register_maps/register_maps.h"
 #include "register_maps/register_maps_types.h"
@@ -24,7 +28,7 @@ std::string upper_cp(const std::string& str) {
 Compiler Compiler::get(const std::string& type_version) {
   auto chip_it = register_maps::get().find(type_version);
   if (chip_it != register_maps::get().end()) {
-    return Compiler(chip_it->second.second, chip_it->second.first);
+    return Compiler(chip_it->first, chip_it->second());
   }
 
   PFEXCEPTION_RAISE("BadType",
@@ -32,8 +36,188 @@ Compiler Compiler::get(const std::string& type_version) {
                         " is not present within ROC or ECON register maps.");
 }
 
-Compiler::Compiler(const ParameterLUT& parameter_lut, const PageLUT& page_lut)
-    : parameter_lut_{parameter_lut}, page_lut_{page_lut} {}
+/**
+ * Pointers to the LUT entries in the order of their names
+ *
+ * The position found by a NameTable (or by a binary search if the
+ * register map doesn't have the tables) leads directly to the entry.
+ */
+struct Compiler::Index {
+  using ParamEntry = Page::value_type;
+  std::vector<const PageEntry*> pages;
+  /// parameters of each page in pages
+  std::vector<const std::vector<const ParamEntry*>*> params;
+  /// parameters of each page type, pages of the same type share these
+  std::map<const Page*, std::vector<const ParamEntry*>> by_type;
+  /// the generated tables agree with the LUTs
+  bool use_tables{false};
+  /// hash of the contents of the register map
+  uint64_t version{0};
+  /// page number -> one past the highest register used on that page
+  std::map<int, int> page_sizes;
+  /// case-folded page names and their positions, sorted for prefix searches
+  std::vector<std::pair<std::string, int>> folded;
+
+  /// a parameter on a page (by position) using a register
+  using Touch = ParameterRef;
+  /// combine a page and register number into one key
+  static uint64_t key(int page, int reg) {
+    return (uint64_t(uint32_t(page)) << 32) | uint32_t(reg);
+  }
+  /**
+   * Get the parameters using each register, building this on first use
+   *
+   * This is only needed when decompiling so it is not built with
+   * the rest of the index.
+   */
+  const std::unordered_map<uint64_t, std::vector<Touch>>& inverse() const {
+    std::call_once(inverse_built, [&]() {
+      for (std::size_t i_page{0}; i_page < pages.size(); i_page++) {
+        int page_id = pages[i_page]->second.first;
+        for (const ParamEntry* param : *params[i_page]) {
+          for (const RegisterLocation& loc : param->second.registers) {
+            auto& touches{inverse_lut[key(page_id, loc.reg)]};
+            if (touches.empty() or touches.back() != Touch(i_page, param)) {
+              touches.emplace_back(i_page, param);
+            }
+          }
+        }
+      }
+    });
+    return inverse_lut;
+  }
+  mutable std::once_flag inverse_built;
+  mutable std::unordered_map<uint64_t, std::vector<Touch>> inverse_lut;
+};
+
+/**
+ * Get the index for the input register map, building it if necessary
+ *
+ * The index is built once per register map and then shared between
+ * all of the compilers using that map.
+ */
+const Compiler::Index& Compiler::get_index(const RegisterMap& register_map) {
+  static std::mutex m;
+  static std::map<const RegisterMap*, std::unique_ptr<Index>> indices;
+  std::lock_guard<std::mutex> l{m};
+  auto& index{indices[&register_map]};
+  if (index) return *index;
+
+  index = std::make_unique<Index>();
+  for (const auto& page : register_map.parameter_lut) {
+    index->pages.push_back(&page);
+    auto& params{index->by_type[&page.second.second]};
+    if (params.empty()) {
+      for (const auto& param : page.second.second) params.push_back(&param);
+    }
+    index->params.push_back(&params);
+    index->folded.emplace_back(upper_cp(page.first), index->pages.size() - 1);
+  }
+  std::sort(index->folded.begin(), index->folded.end());
+
+  // hash everything that could change the compiled registers
+  uint64_t& h{index->version};
+  h = CompileCache::hash({});
+  auto add = [&h](uint64_t n) {
+    h = CompileCache::hash(
+        std::string_view(reinterpret_cast<const char*>(&n), sizeof(n)), h);
+  };
+  for (std::size_t i{0}; i < index->pages.size(); i++) {
+    h = CompileCache::hash(index->pages[i]->first, h);
+    add(index->pages[i]->second.first);
+    int& page_size{index->page_sizes[index->pages[i]->second.first]};
+    for (const auto* param : *index->params[i]) {
+      h = CompileCache::hash(param->first, h);
+      add(param->second.def);
+      for (const RegisterLocation& location : param->second.registers) {
+        add(location.reg);
+        add(location.min_bit);
+        add(location.n_bits);
+        page_size = std::max(page_size, location.reg + 1);
+      }
+    }
+  }
+
+  // only use the tables if they are in the same order as the LUTs
+  index->use_tables = (register_map.page_names != nullptr and
+                       register_map.page_names->size == index->pages.size());
+  for (std::size_t i{0}; index->use_tables and i < index->pages.size(); i++) {
+    const NameTable& params{*register_map.parameter_names[i]};
+    index->use_tables =
+        (register_map.page_names->names[i] == index->pages[i]->first and
+         params.size == index->params[i]->size());
+    for (std::size_t j{0}; index->use_tables and j < params.size; j++) {
+      index->use_tables = (params.names[j] == index->params[i]->at(j)->first);
+    }
+  }
+  return *index;
+}
+
+Compiler::Compiler(const std::string& type, const RegisterMap& register_map)
+    : type_{type},
+      parameter_lut_{register_map.parameter_lut},
+      page_lut_{register_map.page_lut},
+      register_map_{register_map},
+      index_{&get_index(register_map)} {}
+
+uint64_t Compiler::register_map_version() const { return index_->version; }
+
+const std::map<int, int>& Compiler::page_sizes() const {
+  return index_->page_sizes;
+}
+
+int Compiler::page_index(const std::string& PAGE) const {
+  if (index_->use_tables) return register_map_.page_names->find(PAGE);
+  auto it = std::lower_bound(
+      index_->pages.begin(), index_->pages.end(), PAGE,
+      [](const PageEntry* entry, const std::string& name) {
+        return entry->first < name;
+      });
+  if (it == index_->pages.end() or (*it)->first != PAGE) return -1;
+  return it - index_->pages.begin();
+}
+
+std::vector<int> Compiler::match_pages(const std::string& pattern) const {
+  std::vector<int> matches;
+  auto star = pattern.find('*');
+  if (star == std::string::npos) {
+    int i_page = page_index(upper_cp(pattern));
+    if (i_page >= 0) matches.push_back(i_page);
+    return matches;
+  }
+  // all names starting with the prefix are contiguous in the sorted list
+  std::string prefix{upper_cp(pattern.substr(0, star))};
+  auto it = std::lower_bound(
+      index_->folded.begin(), index_->folded.end(), prefix,
+      [](const std::pair<std::string, int>& entry, const std::string& p) {
+        return entry.first < p;
+      });
+  for (; it != index_->folded.end() and it->first.starts_with(prefix); ++it) {
+    matches.push_back(it->second);
+  }
+  std::sort(matches.begin(), matches.end());
+  return matches;
+}
+
+const Compiler::PageEntry& Compiler::page_entry(int i_page) const {
+  return *index_->pages[i_page];
+}
+
+const Parameter* Compiler::find_parameter(int i_page,
+                                          const std::string& PARAM) const {
+  const auto& params{*index_->params[i_page]};
+  if (index_->use_tables) {
+    int i = register_map_.parameter_names[i_page]->find(PARAM);
+    return i < 0 ? nullptr : &params[i]->second;
+  }
+  auto it = std::lower_bound(
+      params.begin(), params.end(), PARAM,
+      [](const Index::ParamEntry* entry, const std::string& name) {
+        return entry->first < name;
+      });
+  if (it == params.end() or (*it)->first != PARAM) return nullptr;
+  return &(*it)->second;
+}
 
 /**
  * Calculate the Most Significant Bit of the input unsigned integer
@@ -50,30 +234,28 @@ std::size_t msb(uint64_t v) {
   return r;
 }
 
-void Compiler::compile(const std::string& page_name,
-                       const std::string& param_name, const uint64_t& val,
-                       std::map<int, std::map<int, uint8_t>>& register_values) {
-  if (parameter_lut_.find(page_name) == parameter_lut_.end()) {
+const Parameter& Compiler::lookup(const std::string& page_name,
+                                  const std::string& param_name,
+                                  const uint64_t& val, int& page_id) {
+  int i_page = page_index(page_name);
+  if (i_page < 0) {
     PFEXCEPTION_RAISE("BadPage", "Missing page: " + page_name);
   }
 
-  const auto& page_entry = parameter_lut_.at(page_name);
-  const auto& page_id = page_entry.first;
-  const auto& params_map = page_entry.second;
-  if (params_map.find(param_name) == params_map.end()) {
+  page_id = page_entry(i_page).second.first;
+  const Parameter* param = find_parameter(i_page, param_name);
+  if (param == nullptr) {
     PFEXCEPTION_RAISE("BadParam",
                       "Missing parameter: " + page_name + "." + param_name);
   }
 
-  const Parameter& spec{parameter_lut_.at(page_name).second.at(param_name)};
-  uint64_t uval{static_cast<uint64_t>(val)};
-
+  const Parameter& spec{*param};
   std::size_t total_nbits =
       std::accumulate(spec.registers.begin(), spec.registers.end(), 0,
                       [](std::size_t bit_count, const RegisterLocation& rhs) {
                         return bit_count + rhs.n_bits;
                       });
-  std::size_t val_msb = msb(uval);
+  std::size_t val_msb = msb(val);
 
   if (val_msb >= total_nbits) {
     std::stringstream msg;
@@ -82,6 +264,15 @@ void Compiler::compile(const std::string& page_name,
         << total_nbits << " bits -> value < " << (1u << total_nbits) << ")";
     PFEXCEPTION_RAISE("ValOver", msg.str());
   }
+  return spec;
+}
+
+void Compiler::compile(const std::string& page_name,
+                       const std::string& param_name, const uint64_t& val,
+                       std::map<int, std::map<int, uint8_t>>& register_values) {
+  int page_id{0};
+  const Parameter& spec{lookup(page_name, param_name, val, page_id)};
+  uint64_t uval{static_cast<uint64_t>(val)};
 
   std::size_t value_curr_min_bit{0};
   pflib_log(trace) << page_name << "." << param_name << " -> page " << page_id;
@@ -107,16 +298,31 @@ void Compiler::compile(const std::string& page_name,
   return;
 }
 
+void Compiler::compile(const std::string& page_name,
+                       const std::string& param_name, const uint64_t& val,
+                       RegisterImage& registers) {
+  int page_id{0};
+  const Parameter& spec{lookup(page_name, param_name, val, page_id)};
+
+  std::size_t value_curr_min_bit{0};
+  for (const RegisterLocation& location : spec.registers) {
+    uint8_t sub_val = ((val >> value_curr_min_bit) & location.mask);
+    value_curr_min_bit += location.n_bits;
+    registers.set_bits(page_id, location.reg, location.mask << location.min_bit,
+                       sub_val << location.min_bit);
+  }
+}
+
 std::map<int, std::map<int, uint8_t>> Compiler::compile(
     const std::string& page_name, const std::string& param_name,
     const uint64_t& val) {
   std::string PAGE_NAME(upper_cp(page_name)), PARAM_NAME(upper_cp(param_name));
-  if (parameter_lut_.find(PAGE_NAME) == parameter_lut_.end()) {
+  int i_page = page_index(PAGE_NAME);
+  if (i_page < 0) {
     PFEXCEPTION_RAISE("NotFound", "The page named '" + PAGE_NAME +
                                       "' is not found in the look up table.");
   }
-  const auto& page_lut{parameter_lut_.at(PAGE_NAME).second};
-  if (page_lut.find(PARAM_NAME) == page_lut.end()) {
+  if (find_parameter(i_page, PARAM_NAME) == nullptr) {
     PFEXCEPTION_RAISE("NotFound",
                       "The parameter named '" + PARAM_NAME +
                           "' is not found in the look up table for page " +
@@ -129,36 +335,127 @@ std::map<int, std::map<int, uint8_t>> Compiler::compile(
 
 std::map<int, std::map<int, uint8_t>> Compiler::compile(
     const std::map<std::string, std::map<std::string, uint64_t>>& settings) {
-  std::map<int, std::map<int, uint8_t>> register_values;
+  return compile_image(settings).to_map();
+}
+
+RegisterImage Compiler::compile_image(
+    const std::map<std::string, std::map<std::string, uint64_t>>& settings) {
+  RegisterImage mask;
+  return compile_image(settings, mask);
+}
+
+RegisterImage Compiler::compile_image(
+    const std::map<std::string, std::map<std::string, uint64_t>>& settings,
+    RegisterImage& mask) {
+  RegisterImage register_values;
+  mask.clear();
+  std::string page_name, param_name;
   for (const auto& page : settings) {
     // page.first => page name
     // page.second => parameter to value map
-    std::string page_name = upper_cp(page.first);
-    if (parameter_lut_.find(page_name) == parameter_lut_.end()) {
+    page_name = upper_cp(page.first);
+    int i_page = page_index(page_name);
+    if (i_page < 0) {
       // this exception shouldn't really ever happen because we check if the
       // input page matches any of the pages in the LUT in detail::apply, but we
       // leave this check in here for future development
       PFEXCEPTION_RAISE("NotFound", "The page named '" + page.first +
                                         "' is not found in the look up table.");
     }
-    const auto& page_lut{parameter_lut_.at(page_name).second};
     for (const auto& param : page.second) {
       // param.first => parameter name
       // param.second => value
-      std::string param_name = upper_cp(param.first);
-      if (page_lut.find(param_name) == page_lut.end()) {
+      param_name = upper_cp(param.first);
+      const Parameter* spec = find_parameter(i_page, param_name);
+      if (spec == nullptr) {
         PFEXCEPTION_RAISE("NotFound",
                           "The parameter named '" + param.first +
                               "' is not found in the look up table for page " +
                               page.first);
       }
       compile(page_name, param_name, param.second, register_values);
+      int page_id = page_entry(i_page).second.first;
+      for (const RegisterLocation& location : spec->registers) {
+        uint8_t bits = location.mask << location.min_bit;
+        mask.set_bits(page_id, location.reg, bits, bits);
+      }
     }  // loop over parameters in page
   }  // loop over pages
 
   return register_values;
 }
 
+ParameterHandle Compiler::resolve(const std::string& page,
+                                  const std::string& param) {
+  std::string PAGE_NAME(upper_cp(page)), PARAM_NAME(upper_cp(param));
+  int i_page = page_index(PAGE_NAME);
+  if (i_page < 0) {
+    PFEXCEPTION_RAISE("NotFound", "The page named '" + PAGE_NAME +
+                                      "' is not found in the look up table.");
+  }
+  const Parameter* spec = find_parameter(i_page, PARAM_NAME);
+  if (spec == nullptr) {
+    PFEXCEPTION_RAISE("NotFound",
+                      "The parameter named '" + PARAM_NAME +
+                          "' is not found in the look up table for page " +
+                          PAGE_NAME);
+  }
+
+  ParameterHandle handle;
+  handle.page_ = page_entry(i_page).second.first;
+  handle.page_name_ = PAGE_NAME;
+  handle.param_name_ = PARAM_NAME;
+  handle.locations_.reserve(spec->registers.size());
+  for (const RegisterLocation& location : spec->registers) {
+    handle.locations_.push_back(ParameterHandle::Location{
+        location.reg, location.min_bit, static_cast<uint8_t>(location.mask),
+        handle.nbits_});
+    handle.nbits_ += location.n_bits;
+  }
+  return handle;
+}
+
+void ParameterHandle::value_too_large(uint64_t val) const {
+  std::stringstream msg;
+  msg << "Parameter " << page_name_ << '.' << param_name_
+      << " is being set to a value (" << val << ") exceeding its size ("
+      << nbits_ << " bits)";
+  PFEXCEPTION_RAISE("ValOver", msg.str());
+}
+
+void ParameterHandle::encode(uint64_t val, RegisterImage& registers) const {
+  if (nbits_ < 64 and (val >> nbits_) != 0) value_too_large(val);
+  for (const Location& location : locations_) {
+    uint8_t sub_val = (val >> location.value_bit) & location.mask;
+    registers.set_bits(page_, location.reg, location.mask << location.min_bit,
+                       sub_val << location.min_bit);
+  }
+}
+
+void ParameterHandle::encode(
+    uint64_t val, std::map<int, std::map<int, uint8_t>>& registers) const {
+  if (nbits_ < 64 and (val >> nbits_) != 0) value_too_large(val);
+  auto& page_registers{registers[page_]};
+  for (const Location& location : locations_) {
+    uint8_t sub_val = (val >> location.value_bit) & location.mask;
+    // registers that haven't been touched before start at zero
+    uint8_t& reg_val{page_registers[location.reg]};
+    reg_val &= ~(location.mask << location.min_bit);
+    reg_val |= (sub_val << location.min_bit);
+  }
+}
+
+uint64_t ParameterHandle::decode(const RegisterImage& registers) const {
+  uint64_t val{0};
+  for (const Location& location : locations_) {
+    uint64_t sub_val =
+        (registers.get(page_, location.reg) >> location.min_bit) &
+        location.mask;
+    val |= (sub_val << location.value_bit);
+  }
+  return val;
+}
+
 std::map<uint16_t, size_t> Compiler::build_register_byte_lut() {
   // register address -> number of bytes used
   std::map<uint16_t, size_t> reg_byte_lut;
@@ -216,171 +513,252 @@ std::vector<int> Compiler::get_known_pages() {
 std::map<std::string, std::map<std::string, uint64_t>> Compiler::decompile(
     const std::map<int, std::map<int, uint8_t>>& compiled_config,
     bool be_careful, bool little_endian) {
+  return decompile(RegisterImage(compiled_config), be_careful, little_endian);
+}
+
+bool Compiler::decompile_parameter(const std::string& page_name, int page_id,
+                                   const std::string& param_name,
+                                   const Parameter& spec,
+                                   const RegisterImage& compiled_config,
+                                   bool be_careful, bool little_endian,
+                                   uint64_t& pval) {
+  pval = 0;
+  std::size_t value_curr_min_bit = 0;
+  int n_missing_regs{0};
+
+  if (little_endian) {
+    // collect all relevant registers in a vector in descending order
+    std::vector<uint8_t> data;
+    std::set<uint16_t> reg_set;
+    for (const auto& loc : spec.registers) {
+      reg_set.insert(loc.reg);
+      if (compiled_config.has(page_id, loc.reg)) {
+        data.push_back(compiled_config.get(page_id, loc.reg));
+        // pflib_log(debug) << "[DEBUG] Register 0x" << std::hex << reg
+        //<< ": byte=0x" << int(it->second);
+      } else {
+        // pflib_log(warn) << "[WARN] Missing register 0x" << std::hex <<
+        // reg
+        //<< " for parameter " << param_name;
+        n_missing_regs++;
+        data.push_back(0);  // assume 0 if missing
+      }
+    }
+
+    uint16_t first_reg = *reg_set.begin();
+
+    /*
+    // get the first_reg and last_reg that span all the registers in reg_set
+    // after accounting for how many bytes each occupies according to
+    register_byte_lut uint16_t first_reg = *reg_set.begin(); uint16_t
+    last_reg  = first_reg; for (uint16_t reg : reg_set) { auto it =
+    register_byte_lut.find(reg); if (it == register_byte_lut.end())
+    continue;  // skip if not found uint16_t reg_end = reg +
+    static_cast<uint16_t>(it->second - 1); if (reg_end > last_reg) last_reg
+    = reg_end; if (reg < first_reg) first_reg = reg;
+    }
+
+    for (uint16_t reg = first_reg; reg <= last_reg; ++reg) {
+      auto it = page_conf.find(reg);
+      if (it != page_conf.end()) {
+        data.push_back(it->second);
+        pflib_log(info) << "[DEBUG] Register 0x" << std::hex << reg
+                         << ": byte=0x" << int(it->second);
+      } else {
+        // pflib_log(warn) << "[WARN] Missing register 0x" << std::hex <<
+        // reg
+        //<< " for parameter " << param_name;
+        n_missing_regs++;
+        data.push_back(0);  // assume 0 if missing
+      }
+    }
+    */
+
+    // combine into a little endian integer
+    uint64_t value = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+      value |= (static_cast<uint64_t>(data[i]) << (8 * i));
+
+    pflib_log(debug) << "[DEBUG] data contents for parameter "
+                     << param_name << ":";
+    for (size_t i = 0; i < data.size(); ++i) {
+      pflib_log(debug) << "  data[" << i << "] = 0x" << std::hex
+                       << int(data[i]);
+    }
+    pflib_log(debug) << "value " << std::hex << value;
+    // keeps track of which bit in pval to place each field
+    size_t bit_cursor = 0;
+    for (const RegisterLocation& loc : spec.registers) {
+      size_t byte_offset = loc.reg - first_reg;
+      size_t bit_offset = 8 * byte_offset + loc.min_bit;
+      uint64_t field_value = (value >> bit_offset) & loc.mask;
+
+      pflib_log(debug)
+          << "[DEBUG] Extracting field from RegisterLocation: reg=0x"
+          << std::hex << loc.reg << ", min_bit=" << std::dec << loc.min_bit
+          << ", n_bits=" << loc.n_bits << ", mask=0x" << std::hex
+          << loc.mask << ", field_value=0x" << std::hex << field_value;
+
+      pval |= field_value << bit_cursor;
+      bit_cursor += loc.n_bits;
+    }
+
+    pflib_log(debug) << "[DEBUG] Parameter '" << param_name
+                     << "' final value = 0x" << std::hex << pval;
+
+  } else {
+    // non-little-endian logic
+    for (const RegisterLocation& location : spec.registers) {
+      uint8_t sub_val =
+          0;  // defaults ot zero if not careful and register not found
+      if (not compiled_config.has(page_id, location.reg)) {
+        n_missing_regs++;
+        if (be_careful) break;
+      } else {
+        // grab sub value of parameter in this register
+        sub_val = ((compiled_config.get(page_id, location.reg) >>
+                    location.min_bit) &
+                   location.mask);
+      }
+      pval += (sub_val << value_curr_min_bit);
+      value_curr_min_bit += location.n_bits;
+    }
+  }
+
+  if (n_missing_regs == spec.registers.size() or
+      (be_careful and n_missing_regs > 0)) {
+    // skip this parameter
+    if (be_careful) {
+      pflib_log(warn)
+          << "parameter " << param_name << " in page " << page_name
+          << " wasn't provided the necessary registers to be deduced";
+
+      std::ostringstream oss;
+      oss << "  Expected registers: ";
+      for (const auto& loc : spec.registers) {
+        oss << "0x" << std::hex << loc.reg << " ";
+      }
+      pflib_log(warn) << oss.str();
+
+      std::ostringstream present;
+      present << "  Registers provided in compiled_config[" << page_name
+              << "]: ";
+      for (int reg : compiled_config.registers(page_id)) {
+        present << "0x" << std::hex << reg << " ";
+      }
+      pflib_log(warn) << present.str();
+    }
+    return false;
+  }
+  pflib_log(debug) << "Parameter '" << param_name << "' final value = 0x"
+                   << std::hex << pval << " (" << std::dec << pval << ")";
+  return true;
+}
+
+std::map<std::string, std::map<std::string, uint64_t>> Compiler::decompile(
+    const RegisterImage& compiled_config, bool be_careful, bool little_endian) {
+  // without warnings, only parameters touched by the registers are returned
+  if (not be_careful) return decompile_partial(compiled_config, little_endian);
+
   std::map<std::string, std::map<std::string, uint64_t>> settings;
   for (const auto& page : parameter_lut_) {
     const std::string& page_name{page.first};
     const int& page_id{page.second.first};
     const auto& page_lut{page.second.second};
-    if (compiled_config.find(page_id) == compiled_config.end()) {
-      if (be_careful) {
-        pflib_log(warn) << "page " << page_name
-                        << " wasn't provided the necessary page " << page_id
-                        << " to be deduced";
-      }
+    if (not compiled_config.has_page(page_id)) {
+      pflib_log(warn) << "page " << page_name
+                      << " wasn't provided the necessary page " << page_id
+                      << " to be deduced";
       continue;
     }
-    const auto& page_conf = compiled_config.at(page_id);
 
     // loop over each parameter
     for (const auto& param : page_lut) {
-      const Parameter& spec{page_lut.at(param.first)};
       uint64_t pval{0};
-      std::size_t value_curr_min_bit = 0;
-      int n_missing_regs{0};
-
-      if (little_endian) {
-        // collect all relevant registers in a vector in descending order
-        std::vector<uint8_t> data;
-        std::set<uint16_t> reg_set;
-        for (const auto& loc : spec.registers) {
-          reg_set.insert(loc.reg);
-          auto it = page_conf.find(loc.reg);
-          if (it != page_conf.end()) {
-            data.push_back(it->second);
-            // pflib_log(debug) << "[DEBUG] Register 0x" << std::hex << reg
-            //<< ": byte=0x" << int(it->second);
-          } else {
-            // pflib_log(warn) << "[WARN] Missing register 0x" << std::hex <<
-            // reg
-            //<< " for parameter " << param.first;
-            n_missing_regs++;
-            data.push_back(0);  // assume 0 if missing
-          }
-        }
-
-        uint16_t first_reg = *reg_set.begin();
-
-        /*
-        // get the first_reg and last_reg that span all the registers in reg_set
-        // after accounting for how many bytes each occupies according to
-        register_byte_lut uint16_t first_reg = *reg_set.begin(); uint16_t
-        last_reg  = first_reg; for (uint16_t reg : reg_set) { auto it =
-        register_byte_lut.find(reg); if (it == register_byte_lut.end())
-        continue;  // skip if not found uint16_t reg_end = reg +
-        static_cast<uint16_t>(it->second - 1); if (reg_end > last_reg) last_reg
-        = reg_end; if (reg < first_reg) first_reg = reg;
-        }
-
-        for (uint16_t reg = first_reg; reg <= last_reg; ++reg) {
-          auto it = page_conf.find(reg);
-          if (it != page_conf.end()) {
-            data.push_back(it->second);
-            pflib_log(info) << "[DEBUG] Register 0x" << std::hex << reg
-                             << ": byte=0x" << int(it->second);
-          } else {
-            // pflib_log(warn) << "[WARN] Missing register 0x" << std::hex <<
-            // reg
-            //<< " for parameter " << param.first;
-            n_missing_regs++;
-            data.push_back(0);  // assume 0 if missing
-          }
-        }
-        */
-
-        // combine into a little endian integer
-        uint64_t value = 0;
-        for (size_t i = 0; i < data.size(); ++i)
-          value |= (static_cast<uint64_t>(data[i]) << (8 * i));
-
-        pflib_log(debug) << "[DEBUG] data contents for parameter "
-                         << param.first << ":";
-        for (size_t i = 0; i < data.size(); ++i) {
-          pflib_log(debug) << "  data[" << i << "] = 0x" << std::hex
-                           << int(data[i]);
-        }
-        pflib_log(debug) << "value " << std::hex << value;
-        // keeps track of which bit in pval to place each field
-        size_t bit_cursor = 0;
-        for (const RegisterLocation& loc : spec.registers) {
-          size_t byte_offset = loc.reg - first_reg;
-          size_t bit_offset = 8 * byte_offset + loc.min_bit;
-          uint64_t field_value = (value >> bit_offset) & loc.mask;
-
-          pflib_log(debug)
-              << "[DEBUG] Extracting field from RegisterLocation: reg=0x"
-              << std::hex << loc.reg << ", min_bit=" << std::dec << loc.min_bit
-              << ", n_bits=" << loc.n_bits << ", mask=0x" << std::hex
-              << loc.mask << ", field_value=0x" << std::hex << field_value;
-
-          pval |= field_value << bit_cursor;
-          bit_cursor += loc.n_bits;
-        }
-
-        pflib_log(debug) << "[DEBUG] Parameter '" << param.first
-                         << "' final value = 0x" << std::hex << pval;
-
-      } else {
-        // non-little-endian logic
-        for (const RegisterLocation& location : spec.registers) {
-          uint8_t sub_val =
-              0;  // defaults ot zero if not careful and register not found
-          if (page_conf.find(location.reg) == page_conf.end()) {
-            n_missing_regs++;
-            if (be_careful) break;
-          } else {
-            // grab sub value of parameter in this register
-            sub_val = ((page_conf.at(location.reg) >> location.min_bit) &
-                       location.mask);
-          }
-          pval += (sub_val << value_curr_min_bit);
-          value_curr_min_bit += location.n_bits;
-        }
+      if (decompile_parameter(page_name, page_id, param.first, param.second,
+                              compiled_config, be_careful, little_endian,
+                              pval)) {
+        settings[page_name][param.first] = pval;
       }
+    }
+  }
 
-      if (n_missing_regs == spec.registers.size() or
-          (be_careful and n_missing_regs > 0)) {
-        // skip this parameter
-        if (be_careful) {
-          pflib_log(warn)
-              << "parameter " << param.first << " in page " << page_name
-              << " wasn't provided the necessary registers to be deduced";
-
-          std::ostringstream oss;
-          oss << "  Expected registers: ";
-          for (const auto& loc : spec.registers) {
-            oss << "0x" << std::hex << loc.reg << " ";
-          }
-          pflib_log(warn) << oss.str();
+  return settings;
+}
 
-          std::ostringstream present;
-          present << "  Registers provided in compiled_config[" << page_name
-                  << "]: ";
-          for (const auto& kv : page_conf) {
-            present << "0x" << std::hex << kv.first << " ";
-          }
-          pflib_log(warn) << present.str();
-        }
-      } else {
-        settings[page_name][param.first] = pval;
-        pflib_log(debug) << "Parameter '" << param.first << "' final value = 0x"
-                         << std::hex << pval << " (" << std::dec << pval << ")";
-      }
+std::vector<Compiler::ParameterRef> Compiler::touched_parameters(
+    const RegisterImage& registers) const {
+  const auto& inverse{index_->inverse()};
+  // collect the parameters touched by any of the provided registers once
+  std::vector<ParameterRef> touched;
+  for (const RegisterImage::Run& run : registers.runs()) {
+    for (int reg{run.reg}; reg < run.reg + run.n; reg++) {
+      auto it = inverse.find(Index::key(run.page, reg));
+      if (it == inverse.end()) continue;
+      touched.insert(touched.end(), it->second.begin(), it->second.end());
     }
   }
+  std::sort(touched.begin(), touched.end());
+  touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+  return touched;
+}
 
+std::map<std::string, std::map<std::string, uint64_t>>
+Compiler::decompile_partial(const RegisterImage& compiled_config,
+                            bool little_endian) {
+  std::map<std::string, std::map<std::string, uint64_t>> settings;
+  for (const auto& [i_page, param] : touched_parameters(compiled_config)) {
+    const PageEntry& page{page_entry(i_page)};
+    uint64_t pval{0};
+    if (decompile_parameter(page.first, page.second.first, param->first,
+                            param->second, compiled_config, false,
+                            little_endian, pval)) {
+      settings[page.first][param->first] = pval;
+    }
+  }
   return settings;
 }
 
+std::vector<ParameterDiff> Compiler::diff(const RegisterImage& a,
+                                          const RegisterImage& b,
+                                          bool little_endian) {
+  // registers that differ or are only in one of the images
+  RegisterImage changed{a.diff(b)};
+  for (const RegisterImage::Run& run : b.diff(a).runs()) {
+    for (int i{0}; i < run.n; i++) {
+      changed.set(run.page, run.reg + i, run.values[i]);
+    }
+  }
+
+  std::vector<ParameterDiff> diffs;
+  for (const auto& [i_page, param] : touched_parameters(changed)) {
+    const PageEntry& page{page_entry(i_page)};
+    ParameterDiff d{page.first, param->first, 0, 0, false, false};
+    d.in_a = decompile_parameter(page.first, page.second.first, param->first,
+                                 param->second, a, false, little_endian, d.a);
+    d.in_b = decompile_parameter(page.first, page.second.first, param->first,
+                                 param->second, b, false, little_endian, d.b);
+    // the changed registers may only differ in bits of other parameters
+    if (d.in_a != d.in_b or d.a != d.b) diffs.push_back(d);
+  }
+  std::sort(diffs.begin(), diffs.end(),
+            [](const ParameterDiff& lhs, const ParameterDiff& rhs) {
+              return std::tie(lhs.page, lhs.param) <
+                     std::tie(rhs.page, rhs.param);
+            });
+  return diffs;
+}
+
 std::map<int, std::map<int, uint8_t>> Compiler::getRegisters(
     const std::string& page) {
   std::string PAGE{upper_cp(page)};
-  auto page_it{parameter_lut_.find(PAGE)};
-  if (page_it == parameter_lut_.end()) {
+  int i_page = page_index(PAGE);
+  if (i_page < 0) {
     PFEXCEPTION_RAISE("BadPage", "Input page " + page +
                                      " is not present in the look up table.");
   }
   std::map<int, std::map<int, uint8_t>> registers;
-  for (const auto& param : page_it->second.second) {
+  for (const auto& param : page_entry(i_page).second.second) {
     compile(PAGE, param.first, 0, registers);
   }
 
@@ -418,14 +796,60 @@ void Compiler::extract(
 
 std::map<int, std::map<int, uint8_t>> Compiler::compile(
     const std::vector<std::string>& setting_files, bool prepend_defaults) {
+  return compile_image(setting_files, prepend_defaults).to_map();
+}
+
+RegisterImage Compiler::compile_image(
+    const std::vector<std::string>& setting_files, bool prepend_defaults) {
   std::map<std::string, std::map<std::string, uint64_t>> settings;
   // if we prepend the defaults, put all settings and their defaults
   // into the settings map before extraction
   if (prepend_defaults) {
     settings = defaults();
   }
-  extract(setting_files, settings);
-  return compile(settings);
+
+  CompileCache* cache = CompileCache::global();
+  if (cache == nullptr) {
+    extract(setting_files, settings);
+    return compile_image(settings);
+  }
+
+  /**
+   * With a cache, we read the files once so that the key and the
+   * compiled image are guaranteed to come from the same contents.
+   */
+  std::vector<std::string> contents;
+  for (const auto& setting_file : setting_files) {
+    std::ifstream f{setting_file};
+    if (not f.is_open()) {
+      PFEXCEPTION_RAISE("BadFile", "Unable to load file " + setting_file);
+    }
+    contents.emplace_back(std::istreambuf_iterator<char>(f),
+                          std::istreambuf_iterator<char>());
+  }
+  uint64_t key = CompileCache::key(type_, register_map_version(),
+                                   prepend_defaults, contents);
+  RegisterImage image;
+  if (cache->load(key, page_sizes(), image)) return image;
+
+  for (std::size_t i{0}; i < contents.size(); i++) {
+    YAML::Node setting_yaml;
+    try {
+      setting_yaml = YAML::Load(contents[i]);
+    } catch (const YAML::ParserException& e) {
+      PFEXCEPTION_RAISE("BadFile", "Unable to parse file " + setting_files[i] +
+                                       ": " + e.what());
+    }
+    if (setting_yaml.IsSequence()) {
+      for (std::size_t j{0}; j < setting_yaml.size(); j++)
+        extract(setting_yaml[j], settings);
+    } else {
+      extract(setting_yaml, settings);
+    }
+  }
+  image = compile_image(settings);
+  cache->store(key, image);
+  return image;
 }
 
 std::map<int, std::map<int, uint8_t>> Compiler::compile(
@@ -436,16 +860,6 @@ std::map<int, std::map<int, uint8_t>> Compiler::compile(
 void Compiler::extract(
     YAML::Node params,
     std::map<std::string, std::map<std::string, uint64_t>>& settings) {
-  // deduce list of page names for search
-  //    only do this once per program run
-  // static std::vector<std::string> page_names;
-  // Commented this out for now .. otherwise if we run the econd and roc tests
-  // at the same time it will fail.. FIX by separating them
-  std::vector<std::string> page_names;
-  if (page_names.empty()) {
-    for (auto& page : parameter_lut_) page_names.push_back(page.first);
-  }
-
   if (params.IsNull()) {
     // skip null nodes (probably comments)
     return;
@@ -455,6 +869,7 @@ void Compiler::extract(
     PFEXCEPTION_RAISE("BadFormat", "The YAML node provided is not a map.");
   }
 
+  std::vector<std::pair<std::string, uint64_t>> page_values;
   for (const auto& page_pair : params) {
     std::string page_name = page_pair.first.as<std::string>();
     YAML::Node page_settings = page_pair.second;
@@ -463,67 +878,53 @@ void Compiler::extract(
                                          " is not a map.");
     }
 
-    // apply these settings only to pages the input name
-    std::vector<std::string> matching_pages;
-    // determine matching function depending on format of input page
+    // apply these settings only to pages matching the input name
     //  if input page contains glob character '*', then match prefix,
     //  otherwise match entire word
-    if (page_name.find('*') == std::string::npos) {
-      std::string PAGE_NAME = upper_cp(page_name);
-      std::copy_if(page_names.begin(), page_names.end(),
-                   std::back_inserter(matching_pages),
-                   [&](const std::string& page) { return PAGE_NAME == page; });
-    } else {
-      // pflib_log(debug)
-      //<< "[DEBUG] Searching for wildcard match. Page_Name: '" << page_name <<
-      //"'";
-      page_name = page_name.substr(0, page_name.find('*'));
-      std::copy_if(page_names.begin(), page_names.end(),
-                   std::back_inserter(matching_pages),
-                   [&](const std::string& page) {
-                     return strncasecmp(page.c_str(), page_name.c_str(),
-                                        page_name.size()) == 0;
-                   });
-    }
-
+    std::vector<int> matching_pages{match_pages(page_name)};
     if (matching_pages.empty()) {
+      page_name = page_name.substr(0, page_name.find('*'));
       PFEXCEPTION_RAISE("NotFound",
                         "The page " + page_name +
                             " does not match any pages in the look up table.");
     }
 
-    for (const auto& page : matching_pages) {
-      for (const auto& param : page_settings) {
-        std::string sval;
-        if (param.second.IsScalar()) {
+    // parse the values once and then copy them to each matching page
+    page_values.clear();
+    for (const auto& param : page_settings) {
+      std::string sval;
+      if (param.second.IsScalar()) {
+        try {
+          // try to parse as string first
+          sval = param.second.as<std::string>();
+        } catch (const YAML::TypedBadConversion<std::string>&) {
           try {
-            // try to parse as string first
-            sval = param.second.as<std::string>();
-          } catch (const YAML::TypedBadConversion<std::string>&) {
-            try {
-              // fallback: parse as int and convert to string
-              int ival = param.second.as<int>();
-              sval = std::to_string(ival);
-            } catch (const YAML::TypedBadConversion<int>&) {
-              PFEXCEPTION_RAISE("BadFormat", "Value for parameter " +
-                                                 param.first.as<std::string>() +
-                                                 " is neither string nor int.");
-            }
+            // fallback: parse as int and convert to string
+            int ival = param.second.as<int>();
+            sval = std::to_string(ival);
+          } catch (const YAML::TypedBadConversion<int>&) {
+            PFEXCEPTION_RAISE("BadFormat", "Value for parameter " +
+                                               param.first.as<std::string>() +
+                                               " is neither string nor int.");
           }
-        } else {
-          PFEXCEPTION_RAISE("BadFormat", "Non-scalar value for parameter " +
-                                             param.first.as<std::string>());
         }
+      } else {
+        PFEXCEPTION_RAISE("BadFormat", "Non-scalar value for parameter " +
+                                           param.first.as<std::string>());
+      }
 
-        if (sval.empty()) {
-          PFEXCEPTION_RAISE("BadFormat", "Non-existent value for parameter " +
-                                             param.first.as<std::string>());
-        }
-        std::string param_name = upper_cp(param.first.as<std::string>());
-        settings[page][param_name] =
-            std::stoull(sval, nullptr, 0);  // base 0 allows hex
-        // settings[page][param_name] = utility::str_to_int(sval);
+      if (sval.empty()) {
+        PFEXCEPTION_RAISE("BadFormat", "Non-existent value for parameter " +
+                                           param.first.as<std::string>());
       }
+      page_values.emplace_back(
+          upper_cp(param.first.as<std::string>()),
+          std::stoull(sval, nullptr, 0));  // base 0 allows hex
+    }
+
+    for (int i_page : matching_pages) {
+      auto& page{settings[page_entry(i_page).first]};
+      for (const auto& [param_name, val] : page_values) page[param_name] = val;
     }
   }
 }
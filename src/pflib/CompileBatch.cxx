@@ -0,0 +1,118 @@
+#include "pflib/CompileBatch.h"
+
+#include <yaml-cpp/yaml.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+
+#include "pflib/Exception.h"
+#include "pflib/utility/thread_pool.h"
+
+namespace pflib {
+namespace batch {
+
+std::vector<Job> read_manifest(const std::string& manifest,
+                               const std::string& chip,
+                               const std::string& flag_key, bool flag,
+                               bool single_input) {
+  YAML::Node root;
+  try {
+    root = YAML::LoadFile(manifest);
+  } catch (const YAML::Exception& e) {
+    PFEXCEPTION_RAISE("BadFile", "Unable to load manifest " + manifest + ": " +
+                                     e.what());
+  }
+  if (not root.IsSequence()) {
+    PFEXCEPTION_RAISE("BadFormat",
+                      "Manifest " + manifest + " is not a list of jobs.");
+  }
+  std::filesystem::path dir{std::filesystem::path(manifest).parent_path()};
+  auto resolve = [&dir](const std::string& p) {
+    std::filesystem::path fp{p};
+    return fp.is_absolute() ? p : (dir / fp).string();
+  };
+  const std::string inputs_key{single_input ? "input" : "inputs"};
+  std::vector<Job> jobs;
+  for (std::size_t i{0}; i < root.size(); i++) {
+    const YAML::Node& node{root[i]};
+    if (not node.IsMap() or not node[inputs_key] or not node["output"]) {
+      PFEXCEPTION_RAISE("BadFormat",
+                        "Job " + std::to_string(i) + " in " + manifest +
+                            (single_input ? " needs an 'input'"
+                                          : " needs 'inputs'") +
+                            " and an 'output'.");
+    }
+    Job job;
+    job.chip = node["chip"] ? node["chip"].as<std::string>() : chip;
+    job.flag = node[flag_key] ? node[flag_key].as<bool>() : flag;
+    if (not single_input and node[inputs_key].IsSequence()) {
+      for (const auto& input : node[inputs_key]) {
+        job.inputs.push_back(resolve(input.as<std::string>()));
+      }
+    } else {
+      job.inputs.push_back(resolve(node[inputs_key].as<std::string>()));
+    }
+    if (job.inputs.empty()) {
+      PFEXCEPTION_RAISE("BadFormat", "Job " + std::to_string(i) + " in " +
+                                         manifest + " has no inputs.");
+    }
+    job.output = resolve(node["output"].as<std::string>());
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+int run_batch(const std::vector<Job>& jobs, int n_threads,
+              const std::string& what, Task task) {
+  auto the_log_{logging::get("batch")};
+  auto start = std::chrono::steady_clock::now();
+
+  std::map<std::string, Compiler> compilers;
+  for (const Job& job : jobs) {
+    if (compilers.find(job.chip) == compilers.end()) {
+      compilers.emplace(job.chip, Compiler::get(job.chip));
+    }
+  }
+
+  std::vector<std::future<void>> results;
+  {
+    utility::ThreadPool pool(n_threads);
+    for (const Job& job : jobs) {
+      results.push_back(pool.submit([&]() {
+        std::ofstream f{job.output};
+        if (not f.is_open()) {
+          PFEXCEPTION_RAISE("BadFile",
+                            "Unable to open output file " + job.output);
+        }
+        task(job, compilers.at(job.chip), f);
+      }));
+    }
+  }
+
+  int n_failed{0};
+  for (std::size_t i{0}; i < jobs.size(); i++) {
+    try {
+      results[i].get();
+    } catch (const Exception& e) {
+      pflib_log(error) << jobs[i].output << " : [" << e.name() << "] "
+                       << e.message();
+      n_failed++;
+    } catch (const std::exception& e) {
+      pflib_log(error) << jobs[i].output << " : " << e.what();
+      n_failed++;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  pflib_log(info) << what << " " << jobs.size() - n_failed << " of "
+                  << jobs.size() << " jobs (" << compilers.size()
+                  << " chip types) in "
+                  << std::chrono::duration<double>(end - start).count()
+                  << " s";
+  return n_failed;
+}
+
+}  // namespace batch
+}  // namespace pflib
@@ -0,0 +1,295 @@
+#include "pflib/CompileCache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "pflib/Exception.h"
+
+namespace pflib {
+
+/// entries are named by their key with this extension
+static const std::string EXTENSION{".pfcc"};
+/// first bytes of every entry
+static const char MAGIC[4] = {'P', 'F', 'C', 'C'};
+/// entries are written to a temporary file with this after their name
+static const std::string TMP_INFIX{".tmp."};
+/// temporary files older than this are left over from a failed store
+static constexpr std::chrono::minutes STALE_TMP_AGE{10};
+/// bump if the layout of the entries changes
+static constexpr uint32_t FORMAT_VERSION{2};
+
+/**
+ * Layout of an entry, all numbers in native byte order
+ *
+ * - MAGIC
+ * - FORMAT_VERSION (uint32)
+ * - key (uint64)
+ * - checksum (uint64), CompileCache::hash of the rest of the entry
+ * - number of runs (uint32)
+ * - for each run: page (int32), register (int32), number of registers
+ *   (int32), and then the register values (one byte each)
+ */
+template <typename T>
+static void put(std::string& buffer, T value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool take(std::string_view& buffer, T& value) {
+  if (buffer.size() < sizeof(T)) return false;
+  std::memcpy(&value, buffer.data(), sizeof(T));
+  buffer.remove_prefix(sizeof(T));
+  return true;
+}
+
+static std::mutex global_mutex;
+static std::unique_ptr<CompileCache> global_cache;
+static bool global_configured{false};
+
+CompileCache::CompileCache(const std::string& directory,
+                           std::uintmax_t max_bytes)
+    : directory_{directory}, max_bytes_{max_bytes} {
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec or not std::filesystem::is_directory(directory_)) {
+    PFEXCEPTION_RAISE("BadDir", "Unable to create compile cache directory " +
+                                    directory_ + ": " + ec.message());
+  }
+}
+
+CompileCache* CompileCache::global() {
+  std::lock_guard<std::mutex> l{global_mutex};
+  if (not global_configured) {
+    global_configured = true;
+    const char* dir = std::getenv("PFLIB_COMPILE_CACHE");
+    if (dir != nullptr and dir[0] != '\0') {
+      try {
+        global_cache = std::make_unique<CompileCache>(dir);
+      } catch (const Exception& e) {
+        // caching is only an optimization, continue without it
+        auto the_log_{logging::get("compile_cache")};
+        pflib_log(warn) << e.message();
+      }
+    }
+  }
+  return global_cache.get();
+}
+
+void CompileCache::enable(const std::string& directory,
+                          std::uintmax_t max_bytes) {
+  auto cache = std::make_unique<CompileCache>(directory, max_bytes);
+  std::lock_guard<std::mutex> l{global_mutex};
+  global_configured = true;
+  global_cache = std::move(cache);
+}
+
+void CompileCache::disable() {
+  std::lock_guard<std::mutex> l{global_mutex};
+  global_configured = true;
+  global_cache.reset();
+}
+
+uint64_t CompileCache::hash(std::string_view data, uint64_t h) {
+  for (unsigned char c : data) {
+    h ^= c;
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+uint64_t CompileCache::key(const std::string& type, uint64_t map_version,
+                           bool prepend_defaults,
+                           const std::vector<std::string>& contents) {
+  // include the lengths so that moving bytes between pieces
+  // changes the key
+  auto piece = [](uint64_t h, std::string_view data) {
+    uint64_t n = data.size();
+    h = hash(std::string_view(reinterpret_cast<const char*>(&n), sizeof(n)),
+             h);
+    return hash(data, h);
+  };
+  uint64_t h = piece(hash({}), type);
+  h = hash(std::string_view(reinterpret_cast<const char*>(&map_version),
+                            sizeof(map_version)),
+           h);
+  h = hash(prepend_defaults ? "1" : "0", h);
+  for (const std::string& content : contents) h = piece(h, content);
+  return h;
+}
+
+std::string CompileCache::path(uint64_t key) const {
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+  return (std::filesystem::path(directory_) / (name + EXTENSION)).string();
+}
+
+bool CompileCache::load(uint64_t key, const std::map<int, int>& page_sizes,
+                        RegisterImage& image) {
+  std::string p{path(key)};
+  std::ifstream f{p, std::ios::binary};
+  if (not f.is_open()) {
+    n_misses_++;
+    return false;
+  }
+  std::string contents{std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>()};
+  f.close();
+
+  std::string_view buffer{contents};
+  char magic[sizeof(MAGIC)];
+  uint32_t format_version{0}, n_runs{0};
+  uint64_t stored_key{0}, checksum{0};
+  bool ok = take(buffer, magic) and
+            std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 and
+            take(buffer, format_version) and
+            format_version == FORMAT_VERSION and take(buffer, stored_key) and
+            stored_key == key and take(buffer, checksum) and
+            hash(buffer) == checksum and take(buffer, n_runs);
+  RegisterImage loaded;
+  for (uint32_t i{0}; ok and i < n_runs; i++) {
+    int32_t page{0}, reg{0}, n{0};
+    ok = take(buffer, page) and take(buffer, reg) and take(buffer, n) and
+         reg >= 0 and n > 0 and buffer.size() >= std::size_t(n);
+    if (not ok) break;
+    // the run has to fit on a page of the register map
+    auto page_size = page_sizes.find(page);
+    ok = page_size != page_sizes.end() and reg < page_size->second and
+         n <= page_size->second - reg;
+    if (not ok) break;
+    loaded.reserve(page, reg + n);
+    for (int32_t j{0}; j < n; j++) loaded.set(page, reg + j, buffer[j]);
+    buffer.remove_prefix(n);
+  }
+  if (not ok or not buffer.empty()) {
+    pflib_log(warn) << "Removing unreadable compile cache entry " << p;
+    std::error_code ec;
+    std::filesystem::remove(p, ec);
+    n_misses_++;
+    return false;
+  }
+
+  // mark as recently used so it is evicted last
+  std::error_code ec;
+  std::filesystem::last_write_time(
+      p, std::filesystem::file_time_type::clock::now(), ec);
+  n_hits_++;
+  image = std::move(loaded);
+  return true;
+}
+
+void CompileCache::store(uint64_t key, const RegisterImage& image) {
+  auto runs = image.runs();
+  std::string payload;
+  put(payload, uint32_t(runs.size()));
+  for (const RegisterImage::Run& run : runs) {
+    put(payload, int32_t(run.page));
+    put(payload, int32_t(run.reg));
+    put(payload, int32_t(run.n));
+    payload.append(reinterpret_cast<const char*>(run.values), run.n);
+  }
+  std::string buffer;
+  buffer.append(MAGIC, sizeof(MAGIC));
+  put(buffer, FORMAT_VERSION);
+  put(buffer, key);
+  put(buffer, hash(payload));
+  buffer += payload;
+
+  // write to a temporary file and then move it into place so that
+  // other processes never see a partially written entry
+  std::string p{path(key)};
+  std::stringstream tmp;
+  tmp << p << TMP_INFIX << getpid() << "."
+      << std::hash<std::thread::id>{}(std::this_thread::get_id());
+  {
+    std::ofstream f{tmp.str(), std::ios::binary | std::ios::trunc};
+    if (not f.is_open() or not f.write(buffer.data(), buffer.size())) {
+      pflib_log(warn) << "Unable to write compile cache entry " << tmp.str();
+      return;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp.str(), p, ec);
+  if (ec) {
+    pflib_log(warn) << "Unable to write compile cache entry " << p << ": "
+                    << ec.message();
+    std::filesystem::remove(tmp.str(), ec);
+    return;
+  }
+  evict();
+}
+
+void CompileCache::clear() {
+  std::lock_guard<std::mutex> l{evict_mutex_};
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory_, ec)) {
+    if (entry.path().extension() == EXTENSION) {
+      std::filesystem::remove(entry.path(), ec);
+    }
+  }
+}
+
+std::uintmax_t CompileCache::disk_usage() const {
+  std::uintmax_t total{0};
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory_, ec)) {
+    if (entry.path().extension() == EXTENSION) {
+      total += entry.file_size(ec);
+    }
+  }
+  return total;
+}
+
+void CompileCache::evict() {
+  std::lock_guard<std::mutex> l{evict_mutex_};
+  struct Entry {
+    std::filesystem::path path;
+    std::filesystem::file_time_type time;
+    std::uintmax_t size;
+  };
+  std::vector<Entry> entries;
+  std::uintmax_t total{0};
+  std::error_code ec;
+  auto stale = std::filesystem::file_time_type::clock::now() - STALE_TMP_AGE;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory_, ec)) {
+    std::string name{entry.path().filename().string()};
+    if (name.find(EXTENSION + TMP_INFIX) != std::string::npos) {
+      auto time = entry.last_write_time(ec);
+      if (not ec and time < stale and std::filesystem::remove(entry, ec)) {
+        pflib_log(debug) << "removed stale " << entry.path().string();
+      }
+      continue;
+    }
+    if (entry.path().extension() != EXTENSION) continue;
+    Entry e{entry.path(), entry.last_write_time(ec), entry.file_size(ec)};
+    if (ec) continue;
+    total += e.size;
+    entries.push_back(e);
+  }
+  if (total <= max_bytes_) return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& lhs, const Entry& rhs) {
+              return lhs.time < rhs.time;
+            });
+  for (const Entry& e : entries) {
+    if (total <= max_bytes_) break;
+    if (std::filesystem::remove(e.path, ec)) {
+      pflib_log(debug) << "evicted " << e.path.string();
+      total -= e.size;
+    }
+  }
+}
+
+}  // namespace pflib
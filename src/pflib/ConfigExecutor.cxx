@@ -0,0 +1,82 @@
+#include "pflib/ConfigExecutor.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "pflib/utility/thread_pool.h"
+
+namespace pflib {
+
+ConfigExecutor::ConfigExecutor(int n_threads) : n_threads_{n_threads} {}
+
+void ConfigExecutor::add(const I2C& bus, const std::string& name,
+                         std::function<void()> task) {
+  const void* key = bus.bus_key();
+  auto it = std::find_if(buses_.begin(), buses_.end(),
+                         [key](const auto& b) { return b.first == key; });
+  if (it == buses_.end()) {
+    buses_.emplace_back(key, std::vector<Task>{});
+    it = buses_.end() - 1;
+  }
+  it->second.push_back(Task{name, std::move(task)});
+}
+
+int ConfigExecutor::ntasks() const {
+  int n{0};
+  for (const auto& [key, tasks] : buses_) n += tasks.size();
+  return n;
+}
+
+void ConfigExecutor::run() {
+  if (buses_.empty()) return;
+
+  int n_threads = n_threads_ < 1 ? nbuses() : std::min(n_threads_, nbuses());
+  pflib_log(debug) << "running " << ntasks() << " tasks on " << nbuses()
+                   << " buses with " << n_threads << " threads";
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::string> failures;
+  {
+    utility::ThreadPool pool(n_threads);
+    std::vector<std::future<void>> results;
+    results.reserve(buses_.size());
+    for (auto& bus : buses_) {
+      std::vector<Task>& tasks{bus.second};
+      results.push_back(pool.submit([&tasks]() {
+        for (Task& task : tasks) {
+          try {
+            task.job();
+          } catch (const Exception& e) {
+            throw Exception(e.name(), task.name + ": " + e.message(),
+                            e.module(), e.line(), e.function());
+          } catch (const std::exception& e) {
+            PFEXCEPTION_RAISE("ConfigFail", task.name + ": " + e.what());
+          }
+        }
+      }));
+    }
+    for (auto& result : results) {
+      try {
+        result.get();
+      } catch (const Exception& e) {
+        pflib_log(error) << "[" << e.name() << "] " << e.message();
+        failures.push_back(e.message());
+      }
+    }
+  }
+  buses_.clear();
+
+  pflib_log(debug) << "configuration took "
+                   << std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count()
+                   << "ms";
+
+  if (not failures.empty()) {
+    std::string msg{std::to_string(failures.size()) + " bus(es) failed:"};
+    for (const auto& f : failures) msg += "\n  " + f;
+    PFEXCEPTION_RAISE("ConfigFail", msg);
+  }
+}
+
+}  // namespace pflib
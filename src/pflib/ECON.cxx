@@ -2,6 +2,7 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -115,28 +116,50 @@ bool ECON::isRunMode() {
   return getPUSMRunValue() == 1 && getPUSMStateValue() == 8;
 }
 
+void ECON::setVerifyPolicy(VerifyPolicy policy, int verify_every) {
+  if (policy == VerifyPolicy::Sampled && verify_every < 1) {
+    PFEXCEPTION_RAISE("BadVerify", "Sampled verification needs a positive " +
+                                       std::string("sampling interval"));
+  }
+  verify_policy_ = policy;
+  verify_every_ = verify_every;
+  n_writes_ = 0;
+}
+
+void ECON::setMaxBurst(int nbytes) {
+  if (nbytes < 1) {
+    PFEXCEPTION_RAISE("BadBurst",
+                      "Invalid maximum burst " + std::to_string(nbytes));
+  }
+  max_burst_ = nbytes;
+}
+
+int ECON::readBurst() const {
+  return std::min(max_burst_, i2c_->max_transfer_bytes());
+}
+
+int ECON::writeBurst() const {
+  // the two address bytes are part of the transfer
+  return std::max(1, std::min(max_burst_, i2c_->max_transfer_bytes() - 2));
+}
+
 std::vector<uint8_t> ECON::getValues(int reg_addr, int nbytes) {
   if (nbytes < 1) {
     pflib_log(error) << "Invalid nbytes = " << nbytes;
     return {};
   }
 
-  std::vector<uint8_t> waddr;
-  waddr.push_back(static_cast<uint8_t>((reg_addr >> 8) & 0xFF));
-  waddr.push_back(static_cast<uint8_t>(reg_addr & 0xFF));
-  std::vector<uint8_t> data =
-      i2c_->general_write_read(econ_base_, waddr, nbytes);
-
-  /*
-  std::cout << "ECON::getValues(" << packing::hex(reg_addr)
-            << ", " << nbytes << ") -> [";
-  for (size_t i = 0; i < data.size(); ++i) {
-    if (i > 0) std::cout << " ";
-    std::cout << std::hex << std::setw(2) << std::setfill('0')
-              << static_cast<int>(data[i]);
+  std::vector<uint8_t> data;
+  data.reserve(nbytes);
+  const int burst = readBurst();
+  for (int offset = 0; offset < nbytes; offset += burst) {
+    int addr = reg_addr + offset;
+    std::vector<uint8_t> waddr = {static_cast<uint8_t>((addr >> 8) & 0xFF),
+                                  static_cast<uint8_t>(addr & 0xFF)};
+    std::vector<uint8_t> chunk = i2c_->general_write_read(
+        econ_base_, waddr, std::min(burst, nbytes - offset));
+    data.insert(data.end(), chunk.begin(), chunk.end());
   }
-  std::cout << "]\n";
-   */
 
   return data;
 }
@@ -176,14 +199,37 @@ void ECON::setValues(int reg_addr, const std::vector<uint8_t>& values) {
   pflib_log(error) << oss.str();
   */
 
-  // write buffer
+  const int burst = writeBurst();
+  for (size_t offset = 0; offset < values.size(); offset += burst) {
+    writeBurstValues(reg_addr + offset, values.data() + offset,
+                     std::min(size_t(burst), values.size() - offset));
+  }
+
+  bool verify = (verify_policy_ == VerifyPolicy::Always);
+  if (verify_policy_ == VerifyPolicy::Sampled) {
+    verify = (n_writes_ % verify_every_ == 0);
+  }
+  n_writes_++;
+  if (!verify) return;
+
+  std::vector<uint8_t> readback = getValues(reg_addr, values.size());
+  for (size_t i = 0; i < values.size() && i < readback.size(); i++) {
+    if (readback[i] != values[i]) {
+      n_verify_mismatch_++;
+      uint32_t reg = reg_addr + i;
+      pflib_log(warn) << "register " << packing::hex(reg) << " reads back "
+                      << int(readback[i]) << " instead of " << int(values[i]);
+    }
+  }
+}
+
+void ECON::writeBurstValues(int reg_addr, const uint8_t* values, int n) {
   std::vector<uint8_t> wbuf;
+  wbuf.reserve(n + 2);
   wbuf.push_back(static_cast<uint8_t>((reg_addr >> 8) & 0xFF));
   wbuf.push_back(static_cast<uint8_t>(reg_addr & 0xFF));
-  wbuf.insert(wbuf.end(), values.begin(), values.end());
-
-  // perform write
-  i2c_->general_write_read(econ_base_, wbuf, values.size());
+  wbuf.insert(wbuf.end(), values, values + n);
+  i2c_->general_write_read(econ_base_, wbuf);
 }
 
 void ECON::setRegisters(
@@ -243,29 +289,32 @@ std::map<int, std::map<int, uint8_t>> ECON::getRegisters(
 
   std::map<int, uint8_t> all_regs;
 
-  if (selected.empty()) {
-    // if no specific registers are requested, read all registers
-    // printf("[DEBUG] Selected map is empty — reading all registers.\n");
-    for (const auto& [reg_addr, nbytes] : econ_reg_nbytes_lut_) {
-      std::vector<uint8_t> values = getValues(reg_addr, nbytes);
-      for (int i = 0; i < values.size(); ++i) {
-        // printf("Read [0x%04x] = 0x%02x\n", reg_addr + i, values[i]);
-        all_regs[reg_addr + i] = values[i];
-      }
+  /**
+   * Gather the byte ranges [start, end) of the requested LUT entries and
+   * merge touching or overlapping ranges so that each is read with as
+   * few bursts as possible.
+   */
+  const std::map<int, uint8_t>* reg_map =
+      selected.empty() ? nullptr : &selected.at(page_id);
+  std::vector<std::pair<int, int>> ranges;
+  for (const auto& [reg_addr, nbytes] : econ_reg_nbytes_lut_) {
+    if (reg_map && reg_map->find(reg_addr) == reg_map->end()) continue;
+    int start = reg_addr, end = reg_addr + int(nbytes);
+    if (!ranges.empty() && start <= ranges.back().second) {
+      ranges.back().second = std::max(ranges.back().second, end);
+    } else {
+      ranges.emplace_back(start, end);
     }
-  } else {
-    // only read the registers in selected[0]
-    const auto& reg_map = selected.at(page_id);
-    for (const auto& [reg_addr, nbytes] : econ_reg_nbytes_lut_) {
-      if (reg_map.find(reg_addr) != reg_map.end()) {
-        std::vector<uint8_t> values = getValues(reg_addr, nbytes);
-        for (int i = 0; i < (int)values.size(); ++i) {
-          // printf("Read [0x%04x] = 0x%02x\n", reg_addr + i, values[i]);
-          all_regs[reg_addr + i] = values[i];
-        }
-      }
+  }
+
+  for (const auto& [start, end] : ranges) {
+    std::vector<uint8_t> values = getValues(start, end - start);
+    for (int i = 0; i < int(values.size()); ++i) {
+      all_regs[start + i] = values[i];
     }
   }
+  pflib_log(trace) << "read " << all_regs.size() << " registers in "
+                   << ranges.size() << " ranges";
 
   for (const auto& [reg, val] : all_regs) {
     chip_reg[page_id][reg] = val;
@@ -2,13 +2,41 @@
 
 #include <stdio.h>
 
-#include <span>
+#include <algorithm>
 
+#include "pflib/Exception.h"
 #include "pflib/utility/crc.h"
 
 namespace pflib {
 
-ECOND_Formatter::ECOND_Formatter() {}
+/// two header words, every eRx with two words and all channels, CRC
+static const int MAX_PACKET_WORDS =
+    2 + ECOND_Formatter::MAX_ERX * (2 + ECOND_Formatter::N_CHANNELS) + 1;
+
+/// T bit of the event header, packet truncated for buffer overflow
+static const uint32_t HEADER_TRUNCATED = (1 << 6);
+
+/// index of a channel (0-35 or -1 for calib) in the eRx sub-packet
+static int subpacket_index(int ielink, int ichannel) {
+  if (ielink < 0 or ielink >= ECOND_Formatter::MAX_ERX or ichannel < -1 or
+      ichannel > 35) {
+    PFEXCEPTION_RAISE("BadChannel",
+                      "No channel " + std::to_string(ichannel) + " on eRx " +
+                          std::to_string(ielink) + " of the ECON-D.");
+  }
+  if (ichannel < 0) return 18;
+  return ichannel < 18 ? ichannel : ichannel + 1;
+}
+
+ECOND_Formatter::ECOND_Formatter()
+    : disable_ZS_{false},
+      suppress_toa_{true},
+      suppress_tot_busy_{false},
+      n_etx_{6},
+      buffer_words_{0} {
+  packet_.reserve(MAX_PACKET_WORDS);
+  set_zs(ChannelZS());
+}
 
 void ECOND_Formatter::startEvent(int bx, int l1a, int orbit) {
   packet_.clear();
@@ -20,17 +48,31 @@ void ECOND_Formatter::startEvent(int bx, int l1a, int orbit) {
 };
 
 void ECOND_Formatter::add_elink_packet(int ielink,
-                                       const std::vector<uint32_t>& src) {
-  // format the elink's data
-  std::vector<uint32_t> subpacket = format_elink(ielink, src);
-  // copy in the formatted data
-  packet_.insert(packet_.end(), subpacket.begin(), subpacket.end());
+                                       std::span<const uint32_t> src) {
+  if (ielink < 0 or ielink >= MAX_ERX) {
+    PFEXCEPTION_RAISE("BadLink", "No eRx " + std::to_string(ielink) +
+                                     " on the ECON-D.");
+  }
+  // format the elink's data directly into the packet
+  format_elink(ielink, src);
   // update the length
   packet_[0] =
       (packet_[0] & 0xFF803FFFu) | (((packet_.size() - 2 + 1) & 0x1FF) << 14);
 }
 
 void ECOND_Formatter::finishEvent() {
+  // the buffer model decides if the payload fits
+  stats_.n_events++;
+  stats_.words_in += packet_.size() + 1;
+  if (buffer_words_ > 0 and
+      stats_.occupancy + int(packet_.size()) + 1 > buffer_words_) {
+    stats_.n_truncated++;
+    packet_.resize(2);
+    packet_[0] = (packet_[0] & 0xFF803FFFu) | (1 << 14) | HEADER_TRUNCATED;
+  }
+  stats_.occupancy += packet_.size() + 1;
+  stats_.max_occupancy = std::max(stats_.max_occupancy, stats_.occupancy);
+
   // event header 8-bit CRC
   // uses 8 leading zeros and zeroed Hamming so it is independent from Hamming
   // first header word:
@@ -46,44 +88,40 @@ void ECOND_Formatter::finishEvent() {
       utility::crc32(std::span(packet_.begin() + 2, packet_.end())));
 }
 
-std::vector<uint32_t> ECOND_Formatter::format_elink(
-    int ielink, const std::vector<uint32_t>& src) {
-  std::vector<uint32_t> dest;
-  int n_readout = 0;
+void ECOND_Formatter::format_elink(int ielink, std::span<const uint32_t> src) {
   // check for right number of words, correct header, etc
   if (src.size() != 40 || ((src[0] >> 28) & 0xF) != 0xF) {
     //      if (src.size()!=40 || ((src[0]>>28)&0xF)!=0xF || (((src[0]&0xF)!=0x5
     //      && (src[0]&0xF)!=0x2))) {
     printf("Invalid contents\n");
-    return dest;
+    return;
   }
-  dest.push_back(0);
-  dest.push_back(0);
+  const std::size_t start = packet_.size();
+  packet_.push_back(0);
+  packet_.push_back(0);
 
   // stat bits (assuming happy for now)
-  dest[0] |= (0x7u << 29);
+  packet_[start] |= (0x7u << 29);
   // hamming bits
-  dest[0] |= (src[0] & 0x70) << (26 - 4);
+  packet_[start] |= (src[0] & 0x70) << (26 - 4);
   // common mode
-  dest[0] |= (src[1] & 0xFFFFF) << 5;
+  packet_[start] |= (src[1] & 0xFFFFF) << 5;
+  int cm = (((src[1] >> 10) & 0x3FF) + (src[1] & 0x3FF)) / 2;
 
   uint32_t building_word = 0;
   int space_left = 32;  // bits in the word
+  bool any_passed = false;
 
   for (int iw = 0; iw < 37; iw++) {
     uint32_t word = src[2 + iw];
-    int ic = iw;
-    if (ic == 18)
-      ic = -1;
-    else if (ic > 18)
-      ic -= 1;
-    int code = zs_process(ielink, ic, word);
+    int code = zs_process(ielink, iw, word, cm);
     if (code >= 0) {
+      any_passed = true;
       // set the channel map bit
       if (iw >= 32)
-        dest[0] |= (1 << (iw - 32));
+        packet_[start] |= (1 << (iw - 32));
       else
-        dest[1] |= (1 << iw);
+        packet_[start + 1] |= (1 << iw);
 
       uint32_t insert_value;
       int insert_len = 32;
@@ -91,7 +129,7 @@ std::vector<uint32_t> ECOND_Formatter::format_elink(
         insert_value = (0b000 << 20) | ((word >> 10) & 0xFFFFF);
         insert_len = 24;
       } else if (code == 0b0001) {  // ADC-1 and TOA ZS
-        insert_value = (0b0001 << 12) | ((word >> 10) & 0xFFC);
+        insert_value = (0b0001 << 12) | (((word >> 10) & 0x3FF) << 2);
         insert_len = 16;
       } else if (code == 0b0010) {  // TcTp=01, TOA ZS
         insert_value = (0b0010 << 20) | ((word >> 10) & 0xFFFFF);
@@ -116,7 +154,7 @@ std::vector<uint32_t> ECOND_Formatter::format_elink(
         else if ((insert_len - space_left) == 24)
           insert_value &= 0xFFFFFF;
         insert_len -= space_left;
-        dest.push_back(building_word);
+        packet_.push_back(building_word);
         building_word = 0;
         space_left = 32;
       }
@@ -127,25 +165,71 @@ std::vector<uint32_t> ECOND_Formatter::format_elink(
     }
   }
   if (space_left != 32) {
-    dest.push_back(building_word);
+    packet_.push_back(building_word);
   }
 
-  return dest;
+  if (not any_passed) {
+    // F=1: a single header word without channel map, E=0: nothing passed ZS
+    packet_.resize(start + 1);
+    packet_[start] |= (1 << 25);
+  }
 }
-int ECOND_Formatter::zs_process(int ielink, int ic, uint32_t word) {
-  // eventually, implement detailed code to carry out different classes of ZS
-  // with provided parameters.  For now, we just look at the tc/tp code
+
+int ECOND_Formatter::zs_process(int ielink, int iw, uint32_t word, int cm) {
   int tctp = (word >> 30) & 0x3;
   if (tctp == 0b11) return 0b1100;  // is TOT
   if (tctp == 0b10) return 0b1000;  // is strange
-  if (tctp == 0b01) return 0b0010;  // is invalid due to ongoing TOT
+  if (tctp == 0b01) {               // is invalid due to ongoing TOT
+    return suppress_tot_busy_ ? -1 : 0b0010;
+  }
   /// at this point, we have tctp=0, so we can apply zs algorithms
   if (disable_ZS_) return 0b0100;
-  // TOA zs...
-  bool no_toa = ((word & 0x3FF) == 0);
-  if (no_toa) return 0b0000;
-  return 4;  // assume we just read out everything for now, but easy to add TOA
-             // zs logic
+  const ChannelZS& zs{zs_[ielink][iw]};
+  int cm_shift = (zs.kappa * cm) / 64;
+  int adc = (word >> 10) & 0x3FF;
+  int adc_tm1 = (word >> 20) & 0x3FF;
+  if (not zs.mask and adc < zs.lambda + cm_shift) return -1;
+  bool keep_m1 = zs.mask_m1 or adc_tm1 >= zs.beta + cm_shift;
+  bool keep_toa = (word & 0x3FF) != 0 or not suppress_toa_;
+  if (keep_m1) return keep_toa ? 0b0100 : 0b0000;
+  return keep_toa ? 0b0011 : 0b0001;
+}
+
+void ECOND_Formatter::set_zs(int ielink, int ichannel, const ChannelZS& zs) {
+  zs_[ielink][subpacket_index(ielink, ichannel)] = zs;
+}
+
+void ECOND_Formatter::set_zs(const ChannelZS& zs) {
+  for (auto& erx : zs_) erx.fill(zs);
 }
 
+const ECOND_Formatter::ChannelZS& ECOND_Formatter::get_zs(int ielink,
+                                                          int ichannel) const {
+  return zs_[ielink][subpacket_index(ielink, ichannel)];
+}
+
+void ECOND_Formatter::setup_buffer(int n_etx, int buffer_words) {
+  if (n_etx < 1 or n_etx > 6) {
+    PFEXCEPTION_RAISE("BadConfig", "The ECON-D has 1 to 6 eTx, not " +
+                                       std::to_string(n_etx));
+  }
+  n_etx_ = n_etx;
+  buffer_words_ = std::max(buffer_words, 0);
+}
+
+void ECOND_Formatter::advance(uint64_t n_bx) {
+  stats_.n_bx += n_bx;
+  uint64_t capacity = n_bx * n_etx_;
+  uint64_t sent = std::min<uint64_t>(capacity, stats_.occupancy);
+  stats_.occupancy -= sent;
+  stats_.words_out += sent;
+}
+
+double ECOND_Formatter::link_utilization() const {
+  if (stats_.n_bx == 0) return 0.;
+  return double(stats_.words_out) / (stats_.n_bx * n_etx_);
+}
+
+void ECOND_Formatter::reset_buffer() { stats_ = BufferStats(); }
+
 }  // namespace pflib
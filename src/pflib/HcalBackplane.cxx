@@ -76,6 +76,11 @@ void HcalBackplane::init(lpGBT& daq_lpgbt, lpGBT& trig_lpgbt,
                     << " and then re-open pftool.";
   }
 
+  // the muxes on the trigger lpGBT may have been reset along with it,
+  // so program the buses and muxes again on the first access
+  daq_lpgbt.invalidate_i2c_bus_state();
+  trig_lpgbt.invalidate_i2c_bus_state();
+
   // next, create the Hcal I2C objects
   auto econ_i2c = std::make_shared<pflib::lpgbt::I2C>(daq_lpgbt, I2C_BUS_ECONS);
   econ_i2c->set_bus_speed(1000);
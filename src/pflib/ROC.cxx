@@ -2,6 +2,7 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -11,25 +12,60 @@
 
 namespace pflib {
 
+/**
+ * In-memory copy of the registers on the chip
+ *
+ * Only pages that the compiler knows about are stored,
+ * so any page missing from the image is read from the chip.
+ */
+struct ROC::Shadow {
+  /// is the shadow in use?
+  bool enabled{false};
+  /// compare against the chip on every read
+  bool verify{false};
+  /// page -> register -> value
+  std::map<int, std::map<int, uint8_t>> image;
+};
+
 ROC::ROC(std::shared_ptr<I2C> i2c, uint8_t roc_base_addr,
          const std::string& type_version)
     : i2c_{i2c},
       roc_base_{roc_base_addr},
       type_version_{type_version},
-      compiler_{Compiler::get(type_version)} {
+      compiler_{Compiler::get(type_version)},
+      shadow_{std::make_shared<Shadow>()} {
   pflib_log(debug) << "base addr " << packing::hex(roc_base_);
 }
 
 const std::string& ROC::type() const { return type_version_; }
 
 std::vector<uint8_t> ROC::readPage(int ipage, int len) {
-  i2c_->set_bus_speed(1400);
+  auto page_it = shadow_->image.find(ipage);
+  if (not shadow_->enabled or page_it == shadow_->image.end()) {
+    return getValuesFromChip(ipage, 0, len);
+  }
 
-  // printf("i2c base address %#x\n", roc_base_);
   std::vector<uint8_t> retval;
   retval.reserve(len);
   for (int i = 0; i < len; i++) {
-    retval.push_back(getValue(ipage, i));
+    auto reg_it = page_it->second.find(i);
+    if (reg_it == page_it->second.end()) {
+      // registers the shadow does not hold are only known by the chip
+      return getValuesFromChip(ipage, 0, len);
+    }
+    retval.push_back(reg_it->second);
+  }
+  if (shadow_->verify) {
+    std::vector<uint8_t> on_chip = getValuesFromChip(ipage, 0, len);
+    for (int i = 0; i < len; i++) {
+      if (on_chip[i] != retval[i]) {
+        pflib_log(warn) << "shadow mismatch on page " << ipage << " register "
+                        << i << ": shadow " << int(retval[i]) << " chip "
+                        << int(on_chip[i]);
+        page_it->second[i] = on_chip[i];
+      }
+    }
+    return on_chip;
   }
   return retval;
 }
@@ -38,6 +74,29 @@ std::vector<uint8_t> ROC::readPage(int ipage, int len) {
 static const int max_tries = 5;
 
 uint8_t ROC::getValue(int ipage, int offset) {
+  if (shadow_->enabled) {
+    auto page_it = shadow_->image.find(ipage);
+    if (page_it != shadow_->image.end()) {
+      auto reg_it = page_it->second.find(offset);
+      if (reg_it != page_it->second.end()) {
+        if (not shadow_->verify) {
+          return reg_it->second;
+        }
+        uint8_t on_chip = getValueFromChip(ipage, offset);
+        if (on_chip != reg_it->second) {
+          pflib_log(warn) << "shadow mismatch on page " << ipage
+                          << " register " << offset << ": shadow "
+                          << int(reg_it->second) << " chip " << int(on_chip);
+          reg_it->second = on_chip;
+        }
+        return on_chip;
+      }
+    }
+  }
+  return getValueFromChip(ipage, offset);
+}
+
+uint8_t ROC::getValueFromChip(int ipage, int offset) {
   i2c_->set_bus_speed(1400);
 
   // set the address
@@ -61,6 +120,89 @@ uint8_t ROC::getValue(int ipage, int offset) {
                                    std::to_string(max_tries) + " attempts");
 }
 
+/// I2C sub-address of the data register that increments the pointer
+static const int REG_DATA_AUTOINCREMENT = 3;
+
+std::vector<uint8_t> ROC::getValuesFromChip(int ipage, int offset, int n) {
+  i2c_->set_bus_speed(1400);
+  const int chunk = std::max(1, i2c_->max_transfer_bytes());
+
+  uint16_t fulladdr = (ipage << 5) | offset;
+  pflib_log(debug) << "ROC::getValuesFromChip(" << ipage << ", " << offset
+                   << ", " << n << ") -> full addr " << fulladdr;
+
+  for (int i_try{0}; i_try < max_tries; i_try++) {
+    try {
+      std::vector<uint8_t> retval;
+      retval.reserve(n);
+      i2c_->write_byte(roc_base_ + 0, fulladdr & 0xFF);
+      i2c_->write_byte(roc_base_ + 1, (fulladdr >> 8) & 0xFF);
+      while (int(retval.size()) < n) {
+        int len = std::min(chunk, n - int(retval.size()));
+        std::vector<uint8_t> data = i2c_->general_write_read(
+            roc_base_ + REG_DATA_AUTOINCREMENT, {}, len);
+        retval.insert(retval.end(), data.begin(), data.end());
+      }
+      return retval;
+    } catch (const pflib::Exception& e) {
+      pflib_log(debug) << "I2C Attempt " << i_try << " on addr " << fulladdr
+                       << " failed with [" << e.name() << "]: " << e.message();
+    }
+  }
+
+  PFEXCEPTION_RAISE("I2CFail", "Failed to read " + std::to_string(n) +
+                                   " registers after " +
+                                   std::to_string(max_tries) + " attempts");
+}
+
+void ROC::setValuesOnChip(int page, int offset,
+                          const std::vector<uint8_t>& values) {
+  i2c_->set_bus_speed(1400);
+  const int chunk = std::max(1, i2c_->max_transfer_bytes());
+
+  uint16_t fulladdr = (page << 5) | offset;
+
+  for (int i_try{0}; i_try < max_tries; i_try++) {
+    try {
+      i2c_->write_byte(roc_base_ + 0, fulladdr & 0xFF);
+      i2c_->write_byte(roc_base_ + 1, (fulladdr >> 8) & 0xFF);
+      for (auto it = values.begin(); it != values.end();) {
+        auto end = it + std::min<std::ptrdiff_t>(chunk, values.end() - it);
+        i2c_->general_write_read(roc_base_ + REG_DATA_AUTOINCREMENT,
+                                 std::vector<uint8_t>(it, end));
+        it = end;
+      }
+      return;
+    } catch (const pflib::Exception& e) {
+      pflib_log(debug) << "I2C Attempt " << i_try << " on addr " << fulladdr
+                       << " failed with [" << e.name() << "]: " << e.message();
+    }
+  }
+
+  PFEXCEPTION_RAISE("I2CFail", "Failed to write " +
+                                   std::to_string(values.size()) +
+                                   " registers after " +
+                                   std::to_string(max_tries) + " attempts");
+}
+
+void ROC::setValues(int page, int offset, const std::vector<uint8_t>& values) {
+  if (values.size() == 1) {
+    setValue(page, offset, values[0]);
+    return;
+  }
+  setValuesOnChip(page, offset, values);
+  if (shadow_->enabled) {
+    int fulladdr = (page << 5) | offset;
+    for (uint8_t value : values) {
+      auto page_it = shadow_->image.find(fulladdr >> 5);
+      if (page_it != shadow_->image.end()) {
+        page_it->second[fulladdr & 0x1F] = value;
+      }
+      fulladdr++;
+    }
+  }
+}
+
 std::vector<std::string> ROC::getDirectAccessParameters() {
   std::vector<std::string> names;
   names.reserve(pflib::DIRECT_ACCESS_PARAMETER_LUT.size());
@@ -140,6 +282,58 @@ bool ROC::isRunMode() {
 }
 
 void ROC::setValue(int page, int offset, uint8_t value) {
+  setValueOnChip(page, offset, value);
+  if (shadow_->enabled) {
+    auto page_it = shadow_->image.find(page);
+    if (page_it != shadow_->image.end()) {
+      page_it->second[offset] = value;
+    }
+  }
+}
+
+void ROC::enableShadow(bool verify) {
+  shadow_->verify = verify;
+  if (shadow_->enabled) return;
+  shadow_->image.clear();
+  // fill from the chip before turning on so the reads go to the chip
+  for (int page : compiler_.get_known_pages()) {
+    std::vector<uint8_t> v = getValuesFromChip(page, 0, N_REGISTERS_PER_PAGE);
+    auto& page_image = shadow_->image[page];
+    for (int reg{0}; reg < N_REGISTERS_PER_PAGE; reg++) {
+      page_image[reg] = v[reg];
+    }
+  }
+  shadow_->enabled = true;
+}
+
+void ROC::disableShadow() {
+  shadow_->enabled = false;
+  shadow_->verify = false;
+  shadow_->image.clear();
+}
+
+bool ROC::hasShadow() const { return shadow_->enabled; }
+
+bool ROC::shadowVerify() const { return shadow_->verify; }
+
+int ROC::refresh() {
+  if (not shadow_->enabled) return 0;
+  int n_changed{0};
+  for (auto& [page, page_image] : shadow_->image) {
+    std::vector<uint8_t> v = getValuesFromChip(page, 0, N_REGISTERS_PER_PAGE);
+    for (auto& [reg, val] : page_image) {
+      if (v[reg] != val) {
+        n_changed++;
+        val = v[reg];
+      }
+    }
+  }
+  pflib_log(debug) << "shadow refresh found " << n_changed
+                   << " registers changed on chip";
+  return n_changed;
+}
+
+void ROC::setValueOnChip(int page, int offset, uint8_t value) {
   i2c_->set_bus_speed(1400);
   uint16_t fulladdr = (page << 5) | offset;
 
@@ -161,11 +355,84 @@ void ROC::setValue(int page, int offset, uint8_t value) {
 }
 
 void ROC::setRegisters(const std::map<int, std::map<int, uint8_t>>& registers) {
+  /**
+   * Registers with consecutive full addresses are grouped into runs
+   * so that each run only needs the register pointer set once.
+   */
+  int run_start{-1};
+  std::vector<uint8_t> run;
+  auto write_run = [&]() {
+    if (run.empty()) return;
+    this->setValues(run_start >> 5, run_start & 0x1F, run);
+    run.clear();
+  };
   for (auto& page : registers) {
     for (auto& reg : page.second) {
-      this->setValue(page.first, reg.first, reg.second);
+      int fulladdr = (page.first << 5) | reg.first;
+      if (run.empty() or fulladdr != run_start + int(run.size())) {
+        write_run();
+        run_start = fulladdr;
+      }
+      run.push_back(reg.second);
+    }
+  }
+  write_run();
+}
+
+int ROC::setChangedRegisters(
+    const std::map<int, std::map<int, uint8_t>>& registers,
+    const std::map<int, std::map<int, uint8_t>>& current) {
+  std::map<int, std::map<int, uint8_t>> changed;
+  int n_skipped{0};
+  for (auto& [page, regs] : registers) {
+    auto current_page = current.find(page);
+    for (auto& [reg, value] : regs) {
+      if (current_page != current.end()) {
+        auto current_reg = current_page->second.find(reg);
+        if (current_reg != current_page->second.end() and
+            current_reg->second == value) {
+          n_skipped++;
+          continue;
+        }
+      }
+      changed[page][reg] = value;
     }
   }
+  setRegisters(changed);
+  pflib_log(debug) << "skipped " << n_skipped
+                   << " register writes that were already on the chip";
+  return n_skipped;
+}
+
+int ROC::setChangedRegisters(
+    const std::map<int, std::map<int, uint8_t>>& registers) {
+  return setChangedRegisters(registers, getRegisters(registers));
+}
+
+int ROC::applyImage(const RegisterImage& values, const RegisterImage& mask) {
+  std::map<int, std::map<int, uint8_t>> target, current;
+  for (int page : values.pages()) {
+    std::vector<int> regs{values.registers(page)};
+    bool partial = std::any_of(regs.begin(), regs.end(), [&](int reg) {
+      return mask.get(page, reg) != 0xFF;
+    });
+    bool shadowed = shadow_->enabled and shadow_->image.count(page) > 0;
+    std::map<int, uint8_t>& page_target{target[page]};
+    if (not partial and not shadowed) {
+      // every bit is set by the image, no need to know what is on the chip
+      for (int reg : regs) page_target[reg] = values.get(page, reg);
+      continue;
+    }
+    std::vector<uint8_t> on_chip = readPage(page, N_REGISTERS_PER_PAGE);
+    std::map<int, uint8_t>& page_current{current[page]};
+    for (int reg : regs) {
+      uint8_t m = mask.get(page, reg);
+      uint8_t now = on_chip.at(reg);
+      page_current[reg] = now;
+      page_target[reg] = (now & ~m) | (values.get(page, reg) & m);
+    }
+  }
+  return setChangedRegisters(target, current);
 }
 
 std::map<int, std::map<int, uint8_t>> ROC::getRegisters(
@@ -251,22 +518,49 @@ std::map<int, std::map<int, uint8_t>> ROC::applyParameters(
   auto ret_val = chip_reg;
   /**
    * 3. compile this parameter onto those register values
-   *    we can use the lower-level compile here because the
-   *    compile in step 1 checks that all of the page and param
-   *    names are correct
+   */
+  compileOnto(parameters, chip_reg);
+  /**
+   * 4. put the values that changed onto the chip
+   */
+  this->setChangedRegisters(chip_reg, ret_val);
+  return ret_val;
+}
+
+std::map<int, std::map<int, uint8_t>> ROC::applyParameters(
+    const std::vector<std::pair<ParameterHandle, uint64_t>>& parameters) {
+  // same steps as the named version without any name lookups
+  std::map<int, std::map<int, uint8_t>> touched_registers;
+  for (const auto& [handle, val] : parameters) {
+    handle.encode(val, touched_registers);
+  }
+  auto chip_reg{getRegisters(touched_registers)};
+  auto ret_val = chip_reg;
+  for (const auto& [handle, val] : parameters) handle.encode(val, chip_reg);
+  this->setChangedRegisters(chip_reg, ret_val);
+  return ret_val;
+}
+
+ParameterHandle ROC::resolve(const std::string& page,
+                             const std::string& param) {
+  return compiler_.resolve(page, param);
+}
+
+void ROC::compileOnto(
+    const std::map<std::string, std::map<std::string, uint64_t>>& parameters,
+    std::map<int, std::map<int, uint8_t>>& registers) {
+  /**
+   * we can use the lower-level compile here because callers
+   * have already compiled the full parameter mapping which
+   * checks that all of the page and param names are correct
    */
   for (auto& page : parameters) {
     std::string page_name = upper_cp(page.first);
     for (auto& param : page.second) {
       compiler_.compile(page_name, upper_cp(param.first), param.second,
-                        chip_reg);
+                        registers);
     }
   }
-  /**
-   * 4. put these updated values onto the chip
-   */
-  this->setRegisters(chip_reg);
-  return ret_val;
 }
 
 void ROC::loadParameters(const std::string& file_path, bool prepend_defaults) {
@@ -278,7 +572,12 @@ void ROC::loadParameters(const std::string& file_path, bool prepend_defaults) {
      * to setting the registers.
      */
     auto settings = compiler_.compile(file_path, true);
-    setRegisters(settings);
+    if (hasShadow()) {
+      // the shadow knows what is on the chip without any reads
+      setChangedRegisters(settings);
+    } else {
+      setRegisters(settings);
+    }
   } else {
     /**
      * If we don't prepend the defaults, then we use the other applyParameters
@@ -351,17 +650,35 @@ ROC::TestParameters::TestParameters(
     ROC& roc, std::map<std::string, std::map<std::string, uint64_t>> new_params)
     : roc_{roc} {
   previous_registers_ = roc_.applyParameters(new_params);
+  applied_registers_ = previous_registers_;
+  roc_.compileOnto(new_params, applied_registers_);
+}
+
+ROC::TestParameters::TestParameters(
+    ROC& roc,
+    const std::vector<std::pair<ParameterHandle, uint64_t>>& new_params)
+    : roc_{roc} {
+  previous_registers_ = roc_.applyParameters(new_params);
+  applied_registers_ = previous_registers_;
+  for (const auto& [handle, val] : new_params) {
+    handle.encode(val, applied_registers_);
+  }
 }
 
 ROC::TestParameters::~TestParameters() {
-  roc_.setRegisters(previous_registers_);
+  roc_.setChangedRegisters(previous_registers_, applied_registers_);
 }
 
 ROC::TestParameters::Builder::Builder(ROC& roc) : parameters_{}, roc_{roc} {}
 
 ROC::TestParameters::Builder& ROC::TestParameters::Builder::add(
     const std::string& page, const std::string& param, const uint64_t& val) {
-  parameters_[page][param] = val;
+  return add(roc_.resolve(page, param), val);
+}
+
+ROC::TestParameters::Builder& ROC::TestParameters::Builder::add(
+    const ParameterHandle& handle, const uint64_t& val) {
+  parameters_.emplace_back(handle, val);
   return *this;
 }
 
@@ -0,0 +1,222 @@
+#include "pflib/RegisterImage.h"
+
+#include <algorithm>
+#include <bit>
+#include <string>
+
+#include "pflib/Exception.h"
+
+namespace pflib {
+
+/// registers are tracked in blocks of 64 to match the bitset words
+static constexpr int BLOCK = 64;
+
+static inline bool test(const std::vector<uint64_t>& bits, int i) {
+  return (bits[i / BLOCK] >> (i % BLOCK)) & 1;
+}
+
+static inline void mark(std::vector<uint64_t>& bits, int i) {
+  bits[i / BLOCK] |= (uint64_t(1) << (i % BLOCK));
+}
+
+RegisterImage::RegisterImage(
+    const std::map<int, std::map<int, uint8_t>>& registers) {
+  for (const auto& [page_id, regs] : registers) {
+    if (regs.empty()) {
+      reserve(page_id, 0);
+      continue;
+    }
+    reserve(page_id, regs.rbegin()->first + 1);
+    for (const auto& [reg, value] : regs) set(page_id, reg, value);
+  }
+}
+
+std::map<int, std::map<int, uint8_t>> RegisterImage::to_map() const {
+  std::map<int, std::map<int, uint8_t>> registers;
+  for (const Page& p : pages_) {
+    auto& page_map = registers[p.id];
+    for (int reg{0}; reg < int(p.values.size()); reg++) {
+      if (test(p.valid, reg)) {
+        page_map.emplace_hint(page_map.end(), reg, p.values[reg]);
+      }
+    }
+  }
+  return registers;
+}
+
+void RegisterImage::reserve(int page_id, int n_registers) {
+  page(page_id, std::max(n_registers, 1) - 1);
+}
+
+const RegisterImage::Page* RegisterImage::find(int page) const {
+  auto it = std::lower_bound(
+      pages_.begin(), pages_.end(), page,
+      [](const Page& p, int id) { return p.id < id; });
+  if (it == pages_.end() or it->id != page) return nullptr;
+  return &(*it);
+}
+
+RegisterImage::Page& RegisterImage::page(int id, int reg) {
+  if (reg < 0) {
+    PFEXCEPTION_RAISE("BadRegister",
+                      "Negative register number " + std::to_string(reg));
+  }
+  auto it = std::lower_bound(
+      pages_.begin(), pages_.end(), id,
+      [](const Page& p, int page_id) { return p.id < page_id; });
+  if (it == pages_.end() or it->id != id) {
+    it = pages_.insert(it, Page{id, {}, {}, {}});
+  }
+  if (reg >= int(it->values.size())) {
+    int n_blocks = reg / BLOCK + 1;
+    it->values.resize(n_blocks * BLOCK, 0);
+    it->valid.resize(n_blocks, 0);
+    it->dirty.resize(n_blocks, 0);
+  }
+  return *it;
+}
+
+bool RegisterImage::has_page(int page) const { return find(page) != nullptr; }
+
+bool RegisterImage::has(int page, int reg) const {
+  const Page* p = find(page);
+  return p and reg >= 0 and reg < int(p->values.size()) and test(p->valid, reg);
+}
+
+bool RegisterImage::is_dirty(int page, int reg) const {
+  const Page* p = find(page);
+  return p and reg >= 0 and reg < int(p->values.size()) and test(p->dirty, reg);
+}
+
+uint8_t RegisterImage::get(int page, int reg) const {
+  const Page* p = find(page);
+  if (not p or reg < 0 or reg >= int(p->values.size())) return 0;
+  return p->values[reg];
+}
+
+void RegisterImage::set(int page_id, int reg, uint8_t value) {
+  Page& p = page(page_id, reg);
+  if (not test(p.valid, reg) or p.values[reg] != value) {
+    mark(p.valid, reg);
+    mark(p.dirty, reg);
+    p.values[reg] = value;
+  }
+}
+
+void RegisterImage::set_bits(int page_id, int reg, uint8_t mask,
+                             uint8_t bits) {
+  Page& p = page(page_id, reg);
+  uint8_t value = test(p.valid, reg) ? p.values[reg] : 0;
+  value = (value & ~mask) | (bits & mask);
+  if (not test(p.valid, reg) or p.values[reg] != value) {
+    mark(p.valid, reg);
+    mark(p.dirty, reg);
+    p.values[reg] = value;
+  }
+}
+
+std::vector<int> RegisterImage::pages() const {
+  std::vector<int> ids;
+  ids.reserve(pages_.size());
+  for (const Page& p : pages_) ids.push_back(p.id);
+  return ids;
+}
+
+std::vector<int> RegisterImage::registers(int page) const {
+  std::vector<int> regs;
+  const Page* p = find(page);
+  if (not p) return regs;
+  for (int reg{0}; reg < int(p->values.size()); reg++) {
+    if (test(p->valid, reg)) regs.push_back(reg);
+  }
+  return regs;
+}
+
+std::size_t RegisterImage::size() const {
+  std::size_t n{0};
+  for (const Page& p : pages_) {
+    for (uint64_t word : p.valid) n += std::popcount(word);
+  }
+  return n;
+}
+
+void RegisterImage::clear() { pages_.clear(); }
+
+void RegisterImage::clear_dirty() {
+  for (Page& p : pages_) std::fill(p.dirty.begin(), p.dirty.end(), 0);
+}
+
+std::vector<RegisterImage::Run> RegisterImage::runs(
+    std::vector<uint64_t> Page::*bits) const {
+  std::vector<Run> retval;
+  for (const Page& p : pages_) {
+    const std::vector<uint64_t>& words = p.*bits;
+    int start{-1};
+    for (int iw{0}; iw < int(words.size()); iw++) {
+      uint64_t word = words[iw];
+      // skip over whole words quickly
+      if (start < 0 and word == 0) continue;
+      if (start >= 0 and word == ~uint64_t(0)) continue;
+      for (int ib{0}; ib < BLOCK; ib++) {
+        int reg = iw * BLOCK + ib;
+        bool set = (word >> ib) & 1;
+        if (set and start < 0) {
+          start = reg;
+        } else if (not set and start >= 0) {
+          retval.push_back(Run{p.id, start, reg - start, &p.values[start]});
+          start = -1;
+        }
+      }
+    }
+    if (start >= 0) {
+      int end = int(p.values.size());
+      retval.push_back(Run{p.id, start, end - start, &p.values[start]});
+    }
+  }
+  return retval;
+}
+
+std::vector<RegisterImage::Run> RegisterImage::runs() const {
+  return runs(&Page::valid);
+}
+
+std::vector<RegisterImage::Run> RegisterImage::dirty_runs() const {
+  return runs(&Page::dirty);
+}
+
+void RegisterImage::merge(const RegisterImage& other) {
+  if (&other == this) return;
+  for (const Run& run : other.runs()) {
+    reserve(run.page, run.reg + run.n);
+    for (int i{0}; i < run.n; i++) set(run.page, run.reg + i, run.values[i]);
+  }
+}
+
+RegisterImage RegisterImage::diff(const RegisterImage& other) const {
+  RegisterImage changes;
+  for (const Run& run : other.runs()) {
+    for (int i{0}; i < run.n; i++) {
+      int reg = run.reg + i;
+      if (not has(run.page, reg) or get(run.page, reg) != run.values[i]) {
+        changes.set(run.page, reg, run.values[i]);
+      }
+    }
+  }
+  return changes;
+}
+
+bool RegisterImage::operator==(const RegisterImage& other) const {
+  if (size() != other.size()) return false;
+  for (const Run& run : runs()) {
+    for (int i{0}; i < run.n; i++) {
+      int reg = run.reg + i;
+      if (not other.has(run.page, reg) or
+          other.get(run.page, reg) != run.values[i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace pflib
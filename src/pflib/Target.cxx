@@ -1,5 +1,9 @@
 #include "pflib/Target.h"
 
+#include <atomic>
+
+#include "pflib/ConfigExecutor.h"
+
 namespace pflib {
 
 std::vector<std::string> Target::i2c_bus_names() {
@@ -32,4 +36,107 @@ OptoLink& Target::get_opto_link(const std::string& name) const {
   return *(it->second);
 }
 
+void Target::applyParameters(
+    const std::map<int, ParameterMap>& roc_parameters,
+    const std::map<int, ParameterMap>& econ_parameters, int n_threads) {
+  ConfigExecutor exec(n_threads);
+  for (const auto& [id, parameters] : roc_parameters) {
+    ROC& r{roc(id)};
+    exec.add(r.i2c(), "ROC " + std::to_string(id),
+             [&r, &parameters]() { r.applyParameters(parameters); });
+  }
+  for (const auto& [id, parameters] : econ_parameters) {
+    ECON& e{econ(id)};
+    exec.add(e.i2c(), "ECON " + std::to_string(id),
+             [&e, &parameters]() { e.applyParameters(parameters); });
+  }
+  exec.run();
+}
+
+void Target::loadParameters(const std::map<int, std::string>& roc_files,
+                            const std::map<int, std::string>& econ_files,
+                            bool prepend_defaults, int n_threads) {
+  ConfigExecutor exec(n_threads);
+  for (const auto& [id, file] : roc_files) {
+    ROC& r{roc(id)};
+    exec.add(r.i2c(), "ROC " + std::to_string(id) + " from " + file,
+             [&r, &file, prepend_defaults]() {
+               r.loadParameters(file, prepend_defaults);
+             });
+  }
+  for (const auto& [id, file] : econ_files) {
+    ECON& e{econ(id)};
+    exec.add(e.i2c(), "ECON " + std::to_string(id) + " from " + file,
+             [&e, &file, prepend_defaults]() {
+               e.loadParameters(file, prepend_defaults);
+             });
+  }
+  exec.run();
+}
+
+/// register values and the bits of them to apply
+struct CompiledImage {
+  RegisterImage values;
+  RegisterImage mask;
+};
+
+/**
+ * Apply a compiled image to each of the ROCs, compiling it only
+ * once for each ROC type
+ */
+static int broadcast(Target& tgt, const std::vector<int>& roc_ids,
+                     int n_threads,
+                     const std::function<void(Compiler&, CompiledImage&)>& f) {
+  std::map<std::string, CompiledImage> images;
+  std::atomic<int> n_skipped{0};
+  ConfigExecutor exec(n_threads);
+  for (int id : roc_ids.empty() ? tgt.roc_ids() : roc_ids) {
+    ROC& r{tgt.roc(id)};
+    auto image_it = images.find(r.type());
+    if (image_it == images.end()) {
+      Compiler c{Compiler::get(r.type())};
+      image_it = images.emplace(r.type(), CompiledImage{}).first;
+      f(c, image_it->second);
+    }
+    const CompiledImage& image{image_it->second};
+    exec.add(r.i2c(), "ROC " + std::to_string(id), [&r, &image, &n_skipped]() {
+      n_skipped += r.applyImage(image.values, image.mask);
+    });
+  }
+  exec.run();
+  return n_skipped;
+}
+
+int Target::broadcastParameters(const ParameterMap& parameters,
+                                const std::vector<int>& roc_ids,
+                                int n_threads) {
+  return broadcast(*this, roc_ids, n_threads,
+                   [&](Compiler& c, CompiledImage& image) {
+                     image.values = c.compile_image(parameters, image.mask);
+                   });
+}
+
+int Target::broadcastParameters(const std::string& file_path,
+                                bool prepend_defaults,
+                                const std::vector<int>& roc_ids,
+                                int n_threads) {
+  return broadcast(
+      *this, roc_ids, n_threads, [&](Compiler& c, CompiledImage& image) {
+        if (not prepend_defaults) {
+          ParameterMap parameters;
+          c.extract(std::vector<std::string>{file_path}, parameters);
+          image.values = c.compile_image(parameters, image.mask);
+          return;
+        }
+        // the defaults set every bit of every register
+        image.values = c.compile_image(std::vector<std::string>{file_path},
+                                       prepend_defaults);
+        for (const RegisterImage::Run& run : image.values.runs()) {
+          for (int i{0}; i < run.n; i++) {
+            image.mask.set(run.page, run.reg + i, 0xFF);
+          }
+        }
+      });
+}
+
 }  // namespace pflib
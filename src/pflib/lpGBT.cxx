@@ -17,82 +17,125 @@ void lpGBT_ConfigTransport::write_regs(uint16_t reg,
   for (size_t i = 0; i < value.size(); i++) write_reg(i + reg, value[i]);
 }
 
-lpGBT::lpGBT(lpGBT_ConfigTransport& transport)
-    : tport_{transport}, gpio_{*this} {}
+void lpGBT_ConfigTransport::queue_write(uint16_t reg,
+                                        const std::vector<uint8_t>& values) {
+  if (values.empty()) return;
+  if (!queue_.empty() && !queue_.back().read &&
+      queue_.back().reg + queue_.back().n == reg) {
+    Transaction& last{queue_.back()};
+    last.values.insert(last.values.end(), values.begin(), values.end());
+    last.n += values.size();
+    return;
+  }
+  queue_.push_back(Transaction{false, reg, int(values.size()), values});
+}
 
-void lpGBT::write(const RegisterValueVector& regvalues) {
-  std::vector<uint8_t> tosend;
-  static const uint16_t UNDEF_ADDR = 0xFFFF;
-  uint16_t base_addr = UNDEF_ADDR;
-
-  // slightly complex, to allow batching of writes to optimize I/O usage
-
-  for (size_t ptr = 0; ptr < regvalues.size(); ptr++) {
-    if (ptr + 1 < regvalues.size() &&
-        regvalues[ptr + 1].first ==
-            regvalues[ptr].first +
-                1) {  // we will start or continue to build a sequence...
-      if (base_addr == UNDEF_ADDR)
-        base_addr = regvalues[ptr].first;  // start a new sequence
-      tosend.push_back(regvalues[ptr].second);
-    } else if (base_addr !=
-               UNDEF_ADDR) {  // this means the current value must be in
-                              // sequence, even though the next one isn't
-      tosend.push_back(regvalues[ptr].second);
-      tport_.write_regs(base_addr, tosend);
-      tosend.clear();
-      base_addr = UNDEF_ADDR;
-    } else {  // we are a one-off
-      tport_.write_reg(regvalues[ptr].first, regvalues[ptr].second);
+void lpGBT_ConfigTransport::queue_read(uint16_t reg, int n) {
+  if (n <= 0) return;
+  if (!queue_.empty() && queue_.back().read &&
+      queue_.back().reg + queue_.back().n == reg) {
+    queue_.back().n += n;
+    return;
+  }
+  queue_.push_back(Transaction{true, reg, n, {}});
+}
+
+std::vector<uint8_t> lpGBT_ConfigTransport::flush() {
+  std::vector<Transaction> todo;
+  todo.swap(queue_);
+  std::vector<uint8_t> retval;
+  for (const Transaction& t : todo) {
+    if (t.read) {
+      std::vector<uint8_t> values = read_regs(t.reg, t.n);
+      retval.insert(retval.end(), values.begin(), values.end());
+    } else if (t.n == 1) {
+      write_reg(t.reg, t.values[0]);
+    } else {
+      write_regs(t.reg, t.values);
     }
   }
+  return retval;
 }
 
-lpGBT::RegisterValueVector lpGBT::read(const std::vector<uint16_t>& registers) {
-  RegisterValueVector retval;
+lpGBT::lpGBT(lpGBT_ConfigTransport& transport)
+    : tport_{transport}, gpio_{*this}, shadow_enabled_{false} {
+  for (auto& state : i2c_bus_state_) {
+    state = std::make_shared<::pflib::I2C::BusState>();
+  }
+  for (auto& bus : i2c_) bus = {0, 0, 0};
+}
 
-  static const uint16_t UNDEF_ADDR = 0xFFFF;
-  uint16_t base_addr = UNDEF_ADDR;
-  int n = -1;
+void lpGBT::write(uint16_t reg, uint8_t value) {
+  tport_.write_reg(reg, value);
+  if (shadow_enabled_ && is_shadowed(reg)) shadow_[reg] = value;
+}
 
-  // slightly complex, to allow batching of reads to optimize I/O usage
+uint8_t lpGBT::read(uint16_t reg) {
+  if (shadow_enabled_ && is_shadowed(reg)) return shadow_[reg];
+  return tport_.read_reg(reg);
+}
 
-  for (size_t ptr = 0; ptr < registers.size(); ptr++) {
-    if (ptr + 1 < registers.size() &&
-        registers[ptr + 1] ==
-            registers[ptr] +
-                1) {  // we will start or continue to build a sequence...
-      if (base_addr == UNDEF_ADDR) {
-        base_addr = registers[ptr];  // start a new sequence
-        n = 0;
-      }
-      n++;
-    } else if (base_addr !=
-               UNDEF_ADDR) {  // this means the current register must be in
-                              // sequence, even though the next one isn't
-      n++;
-      std::vector<uint8_t> values = tport_.read_regs(base_addr, n);
-      for (int i = 0; i < n; i++)
-        retval.push_back(RegisterValue(base_addr + i, values[i]));
-      base_addr = UNDEF_ADDR;
-    } else {  // we are a one-off
-      retval.push_back(
-          RegisterValue(registers[ptr], tport_.read_reg(registers[ptr])));
+std::vector<uint8_t> lpGBT::read(uint16_t reg, int len) {
+  bool local = shadow_enabled_;
+  for (int i = 0; i < len && local; i++) local = is_shadowed(reg + i);
+  if (local) {
+    return std::vector<uint8_t>(shadow_.begin() + reg,
+                                shadow_.begin() + reg + len);
+  }
+  std::vector<uint8_t> values = tport_.read_regs(reg, len);
+  if (shadow_enabled_) {
+    for (int i = 0; i < len; i++) {
+      if (is_shadowed(reg + i)) shadow_[reg + i] = values[i];
+    }
+  }
+  return values;
+}
+
+void lpGBT::write(uint16_t reg, const std::vector<uint8_t>& values) {
+  tport_.write_regs(reg, values);
+  if (!shadow_enabled_) return;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (is_shadowed(reg + i)) shadow_[reg + i] = values[i];
+  }
+}
+
+void lpGBT::write(const RegisterValueVector& regvalues) {
+  // the transport queue merges consecutive registers for us
+  for (const auto& [reg, value] : regvalues) tport_.queue_write(reg, value);
+  tport_.flush();
+  if (!shadow_enabled_) return;
+  for (const auto& [reg, value] : regvalues) {
+    if (is_shadowed(reg)) shadow_[reg] = value;
+  }
+}
+
+lpGBT::RegisterValueVector lpGBT::read(const std::vector<uint16_t>& registers) {
+  for (uint16_t reg : registers) {
+    if (!(shadow_enabled_ && is_shadowed(reg))) tport_.queue_read(reg);
+  }
+  std::vector<uint8_t> values = tport_.flush();
+  RegisterValueVector retval;
+  auto from_chip = values.begin();
+  for (uint16_t reg : registers) {
+    if (shadow_enabled_ && is_shadowed(reg)) {
+      retval.push_back(RegisterValue(reg, shadow_[reg]));
+    } else {
+      retval.push_back(RegisterValue(reg, *from_chip++));
     }
   }
   return retval;
 }
 
 void lpGBT::bit_set(uint16_t reg, int ibit) {
-  uint8_t cval = tport_.read_reg(reg);
+  uint8_t cval = read(reg);
   cval |= (1 << (ibit % 8));
-  tport_.write_reg(reg, cval);
+  write(reg, cval);
 }
 void lpGBT::bit_clr(uint16_t reg, int ibit) {
-  uint8_t cval = tport_.read_reg(reg);
+  uint8_t cval = read(reg);
   cval |= (1 << (ibit % 8));
   cval ^= (1 << (ibit % 8));
-  tport_.write_reg(reg, cval);
+  write(reg, cval);
 }
 
 /// Register constants here are all correct for V1 and V2 lpGBTs
@@ -219,7 +262,7 @@ bool lpGBT::gpio_get(int ibit) {
   }
   if (ibit == 3) ibit = 15;  // yes this is strange
   uint16_t reg = (ibit < 8) ? (REG_PIOINL) : (REG_PIOINH);
-  uint8_t value = tport_.read_reg(reg);
+  uint8_t value = read(reg);
   return (value & (1 << (ibit & 8)));
 }
 
@@ -227,11 +270,11 @@ void lpGBT::gpio_set(uint16_t values) {
   std::vector<uint8_t> vals;
   vals.push_back(uint8_t(values >> 8) | ((values & 0x8) << 4));
   vals.push_back(uint8_t(values & 0xFF));
-  tport_.write_regs(REG_PIOOUTH, vals);
+  write(REG_PIOOUTH, vals);
 }
 
 uint16_t lpGBT::gpio_get() {
-  std::vector<uint8_t> vals = tport_.read_regs(REG_PIOINH, 2);
+  std::vector<uint8_t> vals = read(REG_PIOINH, 2);
   uint16_t val = uint16_t(vals[1]) | ((uint16_t(vals[0])) << 8);
   val = (val & 0xFF7) | (val & 0x8000) >> (12);
   return val;
@@ -298,8 +341,8 @@ uint16_t lpGBT::adc_resistance_read(int ipos, int current, int gain) {
   static constexpr int CURDAC_ENABLE = 6;  // bit 6
 
   bit_set(REG_DAC_CONFIG_H, CURDAC_ENABLE);
-  tport_.write_reg(REG_CURDAC_VALUE, current & (0xff));
-  tport_.write_reg(REG_CURDAC_CHN, (1 << ipos));
+  write(REG_CURDAC_VALUE, current & (0xff));
+  write(REG_CURDAC_CHN, (1 << ipos));
 
   uint16_t value = adc_read(ipos, 15, gain);
 
@@ -316,7 +359,7 @@ uint16_t lpGBT::adc_read(int ipos, int ineg, int gain) {
   static constexpr uint8_t M_VREF_ENABLE = uint8_t(1) << 7;
 
   if (ipos >= 10 && ipos <= 13) {  // must enable the ADCMON
-    tport_.write_reg(REG_ADCMON, 0x1F);
+    write(REG_ADCMON, 0x1F);
   }
   // work out the gain value
   int gval = 0;
@@ -325,28 +368,27 @@ uint16_t lpGBT::adc_read(int ipos, int ineg, int gain) {
   if (gain == 32) gval = 3;
 
   // set up the multiplexers
-  tport_.write_reg(REG_ADC_SELECT, (ipos << 4) | (ineg));
+  write(REG_ADC_SELECT, (ipos << 4) | (ineg));
   // enable the ADC and set the gain
-  tport_.write_reg(REG_ADC_CONFIG, M_ADC_CONFIG_ENABLE | gval);
+  write(REG_ADC_CONFIG, M_ADC_CONFIG_ENABLE | gval);
   // enable vref
-  tport_.write_reg(REG_VREFCNTR, M_VREF_ENABLE);
+  write(REG_VREFCNTR, M_VREF_ENABLE);
   usleep(1000);
   // start conversion
-  tport_.write_reg(REG_ADC_CONFIG,
-                   M_ADC_CONFIG_CONVERT | M_ADC_CONFIG_ENABLE | gval);
+  write(REG_ADC_CONFIG, M_ADC_CONFIG_CONVERT | M_ADC_CONFIG_ENABLE | gval);
 
   // wait and check if done
-  while (!(tport_.read_reg(REG_ADC_STATUS_H) & M_ADC_STATUS_H_DONE))
+  while (!(read(REG_ADC_STATUS_H) & M_ADC_STATUS_H_DONE))
     usleep(1000);
 
-  uint16_t adc_value = ((tport_.read_reg(REG_ADC_STATUS_H) & 0x3) << 8) |
-                       tport_.read_reg(REG_ADC_STATUS_L);
+  uint16_t adc_value = ((read(REG_ADC_STATUS_H) & 0x3) << 8) |
+                       read(REG_ADC_STATUS_L);
 
   // shut things down
-  tport_.write_reg(REG_ADC_CONFIG, M_ADC_CONFIG_ENABLE | gain);
+  write(REG_ADC_CONFIG, M_ADC_CONFIG_ENABLE | gain);
 
-  if (ipos >= 10 && ipos <= 13) tport_.write_reg(REG_ADCMON, 0);
-  tport_.write_reg(REG_VREFCNTR, 0);
+  if (ipos >= 10 && ipos <= 13) write(REG_ADCMON, 0);
+  write(REG_VREFCNTR, 0);
 
   return adc_value;
 }
@@ -447,12 +489,11 @@ void lpGBT::setup_erx(int irx, int align, int alignphase, int speed,
   if (irx >= 3) irx++;  // irx=3 is EDIN4, 4->5, 5->6
 
   // enable first channel, set speed and alignment strategy
-  tport_.write_reg(REG_EPRX0CONTROL + irx,
-                   0x10 | ((speed & 0x3) << 2) | (align & 0x3));
+  write(REG_EPRX0CONTROL + irx, 0x10 | ((speed & 0x3) << 2) | (align & 0x3));
   //
-  tport_.write_reg(REG_EPRX00CHNCNTR + irx * 4,
-                   ((alignphase & 0xF) << 4) | ((invert) ? (0x8) : (0)) |
-                       ((acbias) ? (0x4) : (0)) | ((term) ? (0x2) : (0)));
+  write(REG_EPRX00CHNCNTR + irx * 4,
+        ((alignphase & 0xF) << 4) | ((invert) ? (0x8) : (0)) |
+            ((acbias) ? (0x4) : (0)) | ((term) ? (0x2) : (0)));
 }
 
 void lpGBT::check_prbs_errors_erx(int group, int channel, bool lpgbt_only,
@@ -474,25 +515,25 @@ void lpGBT::check_prbs_errors_erx(int group, int channel, bool lpgbt_only,
   ctrl_byte |= (1 << (4 + channel));           // Enable given channel
   ctrl_byte |= ((data_rate_code & 0x3) << 2);  // Set data rate
   ctrl_byte |= (1 & 0x3);                      // Hard code for Initial Training
-  tport_.write_reg(ctrl_reg, ctrl_byte);
-  printf(" EPRX0CONTROL: %d\n", tport_.read_reg(ctrl_reg));
+  write(ctrl_reg, ctrl_byte);
+  printf(" EPRX0CONTROL: %d\n", read(ctrl_reg));
 
   // Optional: Enable internal PRBS signal (only for group 0 right now)
   if (lpgbt_only) {
-    tport_.write_reg(REG_EPRXPRBS0, (1 << channel));
+    write(REG_EPRXPRBS0, (1 << channel));
   }
 
   // Train channel
-  tport_.write_reg(REG_EPRXTRAINBASE, (1 << channel));
+  write(REG_EPRXTRAINBASE, (1 << channel));
   usleep(100000);
-  tport_.write_reg(REG_EPRXTRAINBASE, 0x00);
+  write(REG_EPRXTRAINBASE, 0x00);
 
   // Wait for channel lock? Maybe not needed?
   struct timeval start, now;
   uint8_t state = 0;
   gettimeofday(&start, nullptr);
   while (true) {
-    uint8_t reg = tport_.read_reg(REG_EPRXLOCKEDBASE + group);
+    uint8_t reg = read(REG_EPRXLOCKEDBASE + group);
     state = reg & 0x3;
 
     gettimeofday(&now, nullptr);
@@ -507,41 +548,41 @@ void lpGBT::check_prbs_errors_erx(int group, int channel, bool lpgbt_only,
   }
 
   // Configure data source for prbs7
-  tport_.write_reg(REG_ULDATASOURCE1, (0 & 0x7) << 0);
-  printf(" ULDATASOURCE1: %d\n", tport_.read_reg(REG_ULDATASOURCE1));
+  write(REG_ULDATASOURCE1, (0 & 0x7) << 0);
+  printf(" ULDATASOURCE1: %d\n", read(REG_ULDATASOURCE1));
 
   // Have BERT monitor channel
   uint8_t group_code = 1 + group;  // 0 disables checker
   uint8_t prbs_code = 6;  // Hard code UL_PRBS7_DR3_CHN0 from Table 14.6 in v1
   uint8_t bert_source_byte = ((group_code & 0xF) << 4) | (prbs_code & 0xF);
-  tport_.write_reg(REG_BERTSOURCE, bert_source_byte);
-  printf(" BERTSOURCE: %d\n", tport_.read_reg(REG_BERTSOURCE));
+  write(REG_BERTSOURCE, bert_source_byte);
+  printf(" BERTSOURCE: %d\n", read(REG_BERTSOURCE));
 
   // Reset BERT
-  tport_.write_reg(REG_BERTCONFIG, 0x00);
+  write(REG_BERTCONFIG, 0x00);
   usleep(1000);
 
   // Start BERT
-  tport_.write_reg(REG_BERTCONFIG, (bert_time_code << 4) | 0x1);
-  printf(" BERTCONFIG: %d\n", tport_.read_reg(REG_BERTCONFIG));
+  write(REG_BERTCONFIG, (bert_time_code << 4) | 0x1);
+  printf(" BERTCONFIG: %d\n", read(REG_BERTCONFIG));
 
   // Wait for BERT to finish
-  while (!(tport_.read_reg(REG_BERTSTATUS) & (1 << 0))) {
+  while (!(read(REG_BERTSTATUS) & (1 << 0))) {
     usleep(1000);
   }
 
-  printf(" BERTSTATUS: %d\n", tport_.read_reg(REG_BERTSTATUS));
+  printf(" BERTSTATUS: %d\n", read(REG_BERTSTATUS));
   // Check PRBS error flag
-  if (tport_.read_reg(REG_BERTSTATUS) & (1 << 2)) {
-    tport_.write_reg(REG_BERTCONFIG, 0x00);
+  if (read(REG_BERTSTATUS) & (1 << 2)) {
+    write(REG_BERTCONFIG, 0x00);
     printf("\n BERT error flag set");
   }
 
-  uint8_t b0 = tport_.read_reg(0x1d6);  // BERTRESULT0 (7:0)
-  uint8_t b1 = tport_.read_reg(0x1d5);  // BERTRESULT1 (15:8)
-  uint8_t b2 = tport_.read_reg(0x1d4);  // BERTRESULT2 (23:16)
-  uint8_t b3 = tport_.read_reg(0x1d3);  // BERTRESULT3 (31:24)
-  uint8_t b4 = tport_.read_reg(0x1d2);  // BERTRESULT4 (39:32)
+  uint8_t b0 = read(0x1d6);  // BERTRESULT0 (7:0)
+  uint8_t b1 = read(0x1d5);  // BERTRESULT1 (15:8)
+  uint8_t b2 = read(0x1d4);  // BERTRESULT2 (23:16)
+  uint8_t b3 = read(0x1d3);  // BERTRESULT3 (31:24)
+  uint8_t b4 = read(0x1d2);  // BERTRESULT4 (39:32)
 
   printf(" BERTRESULT0: %u (%02X)\n", b0, b0);
   printf(" BERTRESULT1: %u (%02X)\n", b1, b1);
@@ -554,7 +595,7 @@ void lpGBT::check_prbs_errors_erx(int group, int channel, bool lpgbt_only,
                     ((uint64_t)b4 << 32);
 
   // Stop BERT
-  tport_.write_reg(REG_BERTCONFIG, 0x00);
+  write(REG_BERTCONFIG, 0x00);
 
   // Calculate BER
   uint64_t clocks = 1ULL << (bert_time_code * 2 + 5);
@@ -574,9 +615,9 @@ void lpGBT::check_prbs_errors_erx(int group, int channel, bool lpgbt_only,
          (unsigned long long)bits_checked);
 
   // Turn off lpgbt prbs if left on
-  tport_.write_reg(REG_EPRXPRBS0, 0x00);
+  write(REG_EPRXPRBS0, 0x00);
   // Ensure normal data source before leaving
-  tport_.write_reg(REG_ULDATASOURCE1, (0 & 0x7) << 0);
+  write(REG_ULDATASOURCE1, (0 & 0x7) << 0);
 }
 
 void lpGBT::setup_etx(int itx, bool enable, bool invert, int drive, int pe_mode,
@@ -587,8 +628,8 @@ void lpGBT::setup_etx(int itx, bool enable, bool invert, int drive, int pe_mode,
                                          0x21, 0x30, 0x31};
 
   // always set up the data rate
-  tport_.write_reg(REG_EPTXDATARATE, 0xFF);  // all links at 320 MBps
-  tport_.write_reg(REG_EPTXCONTROL, 0x0F);   // enable mirroring
+  write({{REG_EPTXDATARATE, 0xFF},   // all links at 320 MBps
+         {REG_EPTXCONTROL, 0x0F}});  // enable mirroring
   int iport = (MAP_ETX[itx] >> 4);
   int ipin = (MAP_ETX[itx] & 0xF);
 
@@ -600,11 +641,11 @@ void lpGBT::setup_etx(int itx, bool enable, bool invert, int drive, int pe_mode,
   }
 
   uint16_t reg = REG_EPTX00ChnCntr + iport * 4 + ipin;
-  tport_.write_reg(
-      reg, ((pe_strength & 0x7) << 5) | ((pe_mode & 0x3) << 3) | (drive & 0x7));
+  write(reg,
+        ((pe_strength & 0x7) << 5) | ((pe_mode & 0x3) << 3) | (drive & 0x7));
 
   reg = REG_EPTX01_00ChnCntr + iport * 2 + ipin / 2;
-  uint8_t val = tport_.read_reg(reg);
+  uint8_t val = read(reg);
   if (ipin % 1) {
     val = val & 0x0F;
     if (invert) val |= 0x80;
@@ -614,21 +655,21 @@ void lpGBT::setup_etx(int itx, bool enable, bool invert, int drive, int pe_mode,
     if (invert) val |= 0x08;
     val |= (pe_width & 0x7);
   }
-  tport_.write_reg(reg, val);
+  write(reg, val);
 }
 
 void lpGBT::setup_ec(bool invert_tx, int drive, bool fixed, int alignphase,
                      bool invert_rx, bool term, bool acbias, bool pullup) {
   // enable enable, pick fixed or not
-  tport_.write_reg(REG_EPRX0CONTROL + 7, 0x10 | (fixed ? (1) : (0)));
+  write(REG_EPRX0CONTROL + 7, 0x10 | (fixed ? (1) : (0)));
   // phase, invert, bias, term, pullup
-  tport_.write_reg(REG_EPRX00CHNCNTR + 7 * 4,
-                   ((alignphase & 0x7) << 4) | ((invert_rx) ? (0x8) : (0)) |
-                       ((acbias) ? (0x4) : (0)) | ((term) ? (0x2) : (0)) |
-                       ((pullup) ? (0x1) : (0)));
+  write(REG_EPRX00CHNCNTR + 7 * 4,
+        ((alignphase & 0x7) << 4) | ((invert_rx) ? (0x8) : (0)) |
+            ((acbias) ? (0x4) : (0)) | ((term) ? (0x2) : (0)) |
+            ((pullup) ? (0x1) : (0)));
   // TX side
-  tport_.write_reg(REG_EPTXECCHNCNTR,
-                   ((drive & 0x7) << 5) | ((invert_tx) ? (0x4) : (0)) | 0x1);
+  write(REG_EPTXECCHNCNTR,
+        ((drive & 0x7) << 5) | ((invert_tx) ? (0x4) : (0)) | 0x1);
 }
 
 void lpGBT::setup_eclk(int ieclk, int rate, bool polarity, int strength) {
@@ -677,6 +718,8 @@ void lpGBT::setup_i2c(int ibus, int speed_khz, bool scl_drive, bool strong_scl,
   if (strong_scl) val |= 0x20;
   if (strong_sda) val |= 0x08;
   write(REG_I2CM0CONFIG + ibus * 7, val);
+  i2c_bus_state_[ibus]->speed = -1;
+  i2c_bus_state_[ibus]->mux.clear();
 
   i2c_[ibus].ctl_reg = 0;
   if (scl_drive) i2c_[ibus].ctl_reg |= 0x80;
@@ -685,6 +728,19 @@ void lpGBT::setup_i2c(int ibus, int speed_khz, bool scl_drive, bool strong_scl,
   if (speed_khz > 500 && speed_khz < 2000) i2c_[ibus].ctl_reg |= 0x03;
 }
 
+std::shared_ptr<::pflib::I2C::BusState> lpGBT::i2c_bus_state(int ibus) {
+  if (ibus < 0 || ibus > 2) return std::make_shared<::pflib::I2C::BusState>();
+  return i2c_bus_state_[ibus];
+}
+
+void lpGBT::invalidate_i2c_bus_state() {
+  // clear in place, the bus objects hold on to these states
+  for (auto& state : i2c_bus_state_) {
+    state->speed = -1;
+    state->mux.clear();
+  }
+}
+
 static constexpr uint8_t CMD_I2C_WRITE_CR = 0;
 static constexpr uint8_t CMD_I2C_1BYTE_WRITE = 2;
 static constexpr uint8_t CMD_I2C_1BYTE_READ = 3;
@@ -695,74 +751,133 @@ static constexpr uint8_t CMD_I2C_W_MULTI_4BYTE3 = 11;
 static constexpr uint8_t CMD_I2C_WRITE_MULTI = 0xC;
 static constexpr uint8_t CMD_I2C_READ_MULTI = 0xD;
 
+/** Expected duration of an I2C transaction on a master in microseconds
+
+    Each byte (including the address byte) takes nine clock cycles
+    (eight bits and the acknowledge) and we add two for the start
+    and stop conditions.
+*/
+static int i2c_expected_us(uint8_t ctl_reg, int nbytes) {
+  static const int khz[] = {100, 200, 400, 1000};
+  int bits = 9 * (1 + nbytes) + 2;
+  return (bits * 1000) / khz[ctl_reg & 0x3] + 1;
+}
+
+/// first wait between status polls after the expected completion time
+static constexpr int I2C_POLL_START_US = 10;
+/// longest wait between status polls
+static constexpr int I2C_POLL_MAX_US = 1000;
+/// give up on a transaction after this long
+static constexpr int I2C_TIMEOUT_US = 1000000;
+
+void lpGBT::i2c_launch(int ibus, uint8_t i2c_addr, uint8_t ctl_reg,
+                       uint8_t cmd, const std::vector<uint8_t>& data,
+                       int nbytes) {
+  const uint16_t base = ibus * REG_I2C_WSTRIDE;
+  // ADDRESS, DATA0-3 and CMD are consecutive registers, so we set the
+  // address and the control register in a single burst
+  tport_.write_regs(REG_I2CM0ADDRESS + base,
+                    {i2c_addr, ctl_reg, 0, 0, 0, CMD_I2C_WRITE_CR});
+  // and then stage the data four bytes at a time along with the command
+  // copying them into the master's buffer
+  for (size_t i = 0; i < data.size(); i += 4) {
+    std::vector<uint8_t> block(5, 0);
+    for (size_t j = 0; j < 4 && i + j < data.size(); j++) {
+      block[j] = data[i + j];
+    }
+    block[4] = (cmd == CMD_I2C_1BYTE_WRITE) ? (CMD_I2C_1BYTE_WRITE)
+                                            : (CMD_I2C_W_MULTI_4BYTE0 + i / 4);
+    tport_.write_regs(REG_I2CM0DATA0 + base, block);
+  }
+  if (cmd != CMD_I2C_1BYTE_WRITE) write(REG_I2CM0CMD + base, cmd);
+  i2c_[ibus].pending_bytes = nbytes;
+}
+
 void lpGBT::start_i2c_read(int ibus, uint8_t i2c_addr, int len) {
-  if (ibus < 0 || ibus > 2 || len < 0 || len > 16) return;
+  if (ibus < 0 || ibus > 2 || len < 0) return;
+  if (len > 16) {
+    PFEXCEPTION_RAISE("I2CTooLong",
+                      "lpGBT I2C masters can read at most 16 bytes at once, " +
+                          std::to_string(len) + " requested");
+  }
   i2c_[ibus].read_len = len;
-  write(REG_I2CM0ADDRESS + ibus * REG_I2C_WSTRIDE, i2c_addr);
   if (len == 1) {
-    write(REG_I2CM0DATA0 + ibus * REG_I2C_WSTRIDE, i2c_[ibus].ctl_reg);
-    write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_WRITE_CR);
-    write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_1BYTE_READ);
+    i2c_launch(ibus, i2c_addr, i2c_[ibus].ctl_reg, CMD_I2C_1BYTE_READ, {}, 1);
   } else {
-    write(REG_I2CM0DATA0 + ibus * REG_I2C_WSTRIDE,
-          i2c_[ibus].ctl_reg | (len << 2));
-    write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_WRITE_CR);
-    write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_READ_MULTI);
+    i2c_launch(ibus, i2c_addr, i2c_[ibus].ctl_reg | (len << 2),
+               CMD_I2C_READ_MULTI, {}, len);
   }
 }
 
 void lpGBT::i2c_write(int ibus, uint8_t i2c_addr, uint8_t value) {
   if (ibus < 0 || ibus > 2) return;
-  write(REG_I2CM0ADDRESS + ibus * REG_I2C_WSTRIDE, i2c_addr);
-  write(REG_I2CM0DATA0 + ibus * REG_I2C_WSTRIDE, i2c_[ibus].ctl_reg);
-  write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_WRITE_CR);
-  write(REG_I2CM0DATA0 + ibus * REG_I2C_WSTRIDE, value);
-  write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_1BYTE_WRITE);
+  i2c_launch(ibus, i2c_addr, i2c_[ibus].ctl_reg, CMD_I2C_1BYTE_WRITE, {value},
+             1);
 }
 
 void lpGBT::i2c_write(int ibus, uint8_t i2c_addr,
                       const std::vector<uint8_t>& values) {
-  if (ibus < 0 || ibus > 2 || values.size() > 16) return;
-  write(REG_I2CM0ADDRESS + ibus * REG_I2C_WSTRIDE, i2c_addr);
-  write(REG_I2CM0DATA0 + ibus * REG_I2C_WSTRIDE,
-        i2c_[ibus].ctl_reg | (values.size() << 2));
-  write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_WRITE_CR);
-  // copying all the data into the core...
-  for (size_t i = 0; i < values.size(); i++) {
-    write(REG_I2CM0DATA0 + (i % 4) + ibus * REG_I2C_WSTRIDE, values[i]);
-    // every 4 bytes or on the last byte
-    if ((i % 4) == 3 || (i + 1) == values.size())
-      write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE,
-            CMD_I2C_W_MULTI_4BYTE0 + (i / 4));
+  if (ibus < 0 || ibus > 2) return;
+  if (values.size() > 16) {
+    PFEXCEPTION_RAISE("I2CTooLong",
+                      "lpGBT I2C masters can write at most 16 bytes at once, " +
+                          std::to_string(values.size()) + " requested");
   }
-  // launch the write
-  write(REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE, CMD_I2C_WRITE_MULTI);
+  i2c_launch(ibus, i2c_addr, i2c_[ibus].ctl_reg | (values.size() << 2),
+             CMD_I2C_WRITE_MULTI, values, values.size());
 }
 
-bool lpGBT::i2c_transaction_check(int ibus, bool wait) {
+/// check the status register of a master, throwing on errors
+static bool i2c_status_success(uint8_t val) {
   static constexpr uint8_t NOCLK = 0x80;
   static constexpr uint8_t NOACK = 0x40;
   static constexpr uint8_t LEVELE = 0x08;
   static constexpr uint8_t SUCCESS = 0x04;
+  if (val & NOCLK) {
+    PFEXCEPTION_RAISE("I2CErrorNoCLK", "No clock on I2C controller");
+  }
+  if (val & NOACK) {
+    PFEXCEPTION_RAISE("I2CErrorNoACK", "No acknowledge from I2C target");
+  }
+  if (val & LEVELE) {
+    PFEXCEPTION_RAISE("I2CErrorSDALow", "SDA Line Low on Start");
+  }
+  return (val & SUCCESS);
+}
 
-  if (ibus < 0 || ibus > 2) return false;
-  do {
-    uint8_t val = read(REG_I2CM0STATUS + ibus * REG_I2C_RSTRIDE);
-    if (val & NOCLK) {
-      PFEXCEPTION_RAISE("I2CErrorNoCLK", "No clock on I2C controller");
-    }
-    if (val & NOACK) {
-      PFEXCEPTION_RAISE("I2CErrorNoACK", "No acknowledge from I2C target");
-    }
-    if (val & LEVELE) {
-      PFEXCEPTION_RAISE("I2CErrorSDALow", "SDA Line Low on Start");
-    }
-    if (val & SUCCESS) {
-      return true;
+std::vector<uint8_t> lpGBT::i2c_wait(int ibus, int n_after_status) {
+  const uint16_t status_reg = REG_I2CM0STATUS + ibus * REG_I2C_RSTRIDE;
+  /**
+   * We first sleep for the time the transaction is expected to take
+   * on the bus and only then start polling, doubling the wait between
+   * polls so that slow targets (e.g. clock stretching) don't flood the
+   * configuration transport.
+   */
+  int waited = i2c_expected_us(i2c_[ibus].ctl_reg, i2c_[ibus].pending_bytes);
+  usleep(waited);
+  int backoff = I2C_POLL_START_US;
+  while (true) {
+    std::vector<uint8_t> regs = read(status_reg, 1 + n_after_status);
+    if (i2c_status_success(regs[0])) return regs;
+    if (waited > I2C_TIMEOUT_US) {
+      PFEXCEPTION_RAISE("I2CTimeout",
+                        "I2C transaction on master " + std::to_string(ibus) +
+                            " did not finish after " +
+                            std::to_string(waited) + "us");
     }
-    usleep(100);
-  } while (wait);
-  return false;
+    usleep(backoff);
+    waited += backoff;
+    backoff = std::min(2 * backoff, I2C_POLL_MAX_US);
+  }
+}
+
+bool lpGBT::i2c_transaction_check(int ibus, bool wait) {
+  if (ibus < 0 || ibus > 2) return false;
+  if (wait) {
+    i2c_wait(ibus, 0);
+    return true;
+  }
+  return i2c_status_success(read(REG_I2CM0STATUS + ibus * REG_I2C_RSTRIDE));
 }
 
 std::vector<uint8_t> lpGBT::i2c_read_data(int ibus) {
@@ -780,7 +895,126 @@ std::vector<uint8_t> lpGBT::i2c_read_data(int ibus) {
   return retval;
 }
 
-void lpGBT::finalize_setup() { write(REG_POWERUP2, 0x4 | 0x2); }
+std::vector<uint8_t> lpGBT::i2c_transaction(int ibus, uint8_t i2c_addr,
+                                            const std::vector<uint8_t>& wdata,
+                                            int nread) {
+  std::vector<uint8_t> retval;
+  if (ibus < 0 || ibus > 2) return retval;
+  if (wdata.size() == 1) {
+    i2c_write(ibus, i2c_addr, wdata[0]);
+    i2c_wait(ibus, 0);
+  } else if (not wdata.empty()) {
+    i2c_write(ibus, i2c_addr, wdata);
+    i2c_wait(ibus, 0);
+  }
+  if (nread > 0) {
+    start_i2c_read(ibus, i2c_addr, nread);
+    /**
+     * the read data registers follow the status register so we
+     * retrieve them in the same poll that sees the success
+     *  STATUS, TRANSCNT, READBYTE, READ0, ..., READ15
+     */
+    const int offset_readbyte = REG_I2CM0READBYTE - REG_I2CM0STATUS;
+    const int offset_read15 = REG_I2CM0READ15 - REG_I2CM0STATUS;
+    if (nread == 1) {
+      std::vector<uint8_t> regs = i2c_wait(ibus, offset_readbyte);
+      retval.push_back(regs[offset_readbyte]);
+    } else {
+      std::vector<uint8_t> regs = i2c_wait(ibus, offset_read15);
+      // stored backwards ending at READ15
+      for (int i = 0; i < nread; i++) {
+        retval.push_back(regs[offset_read15 - i]);
+      }
+    }
+  }
+  return retval;
+}
+
+void lpGBT::finalize_setup() {
+  write(REG_POWERUP2, 0x4 | 0x2);
+  // a (re-)configured chip has to have its I2C masters programmed again
+  invalidate_i2c_bus_state();
+}
+
+/// registers from here on are read-only status registers
+static constexpr uint16_t REG_FIRST_READ_ONLY = 0x140;
+
+bool lpGBT::is_shadowed(uint16_t reg) {
+  if (reg >= REG_FIRST_READ_ONLY) return false;
+  // writing these launches I2C transactions
+  if (reg >= REG_I2CM0CONFIG && reg <= REG_I2CM0CMD + 2 * REG_I2C_WSTRIDE)
+    return false;
+  // eFuse programming and ADC control
+  if (reg >= REG_FUSECONTROL && reg <= REG_ADC_CONFIG) return false;
+  return true;
+}
+
+void lpGBT::enable_shadow() {
+  shadow_ = tport_.read_regs(0, SHADOW_SIZE);
+  shadow_enabled_ = true;
+}
+
+void lpGBT::disable_shadow() {
+  shadow_enabled_ = false;
+  shadow_.clear();
+}
+
+int lpGBT::refresh_shadow() {
+  if (!shadow_enabled_) {
+    enable_shadow();
+    return 0;
+  }
+  std::vector<uint8_t> chip = tport_.read_regs(0, SHADOW_SIZE);
+  int n_changed = 0;
+  for (uint16_t reg = 0; reg < SHADOW_SIZE; reg++) {
+    if (is_shadowed(reg) && chip[reg] != shadow_[reg]) n_changed++;
+  }
+  shadow_.swap(chip);
+  // the chip may have been reset, so the I2C masters may be as well
+  invalidate_i2c_bus_state();
+  return n_changed;
+}
+
+lpGBT::RegisterValueVector lpGBT::snapshot() {
+  std::vector<uint16_t> registers;
+  for (uint16_t reg = 0; reg < SHADOW_SIZE; reg++) {
+    if (is_shadowed(reg)) registers.push_back(reg);
+  }
+  return read(registers);
+}
+
+lpGBT::RegisterValueVector lpGBT::diff(const RegisterValueVector& snapshot) {
+  std::vector<uint16_t> registers;
+  RegisterValueVector wanted;
+  for (const auto& rv : snapshot) {
+    if (!is_shadowed(rv.first)) continue;
+    registers.push_back(rv.first);
+    wanted.push_back(rv);
+  }
+  RegisterValueVector current = read(registers);
+  RegisterValueVector retval;
+  for (size_t i = 0; i < wanted.size(); i++) {
+    if (current[i].second != wanted[i].second) retval.push_back(wanted[i]);
+  }
+  return retval;
+}
+
+int lpGBT::restore(const RegisterValueVector& snapshot) {
+  RegisterValueVector changes = diff(snapshot);
+  std::sort(changes.begin(), changes.end());
+  /**
+   * The PLL/DLL configuration-done bits tell the power-up state machine
+   * to continue, so they go last after everything else is in place.
+   */
+  auto powerup = std::find_if(
+      changes.begin(), changes.end(),
+      [](const RegisterValue& rv) { return rv.first == REG_POWERUP2; });
+  if (powerup != changes.end()) {
+    std::rotate(powerup, powerup + 1, changes.end());
+  }
+  write(changes);
+  return changes.size();
+}
 
 int lpGBT::status() { return read(REG_POWERUP_STATUS); }
 
@@ -2,130 +2,196 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
-#ifndef I2C_SLAVE
-#define I2C_SLAVE 0x0703
-#endif
+
+#include <algorithm>
 namespace pflib {
 
+namespace {
+/// the bus device file itself
+class FileDevice : public lpGBT_ConfigTransport_I2C::Device {
+ public:
+  FileDevice(const std::string& bus_dev) {
+    handle_ = open(bus_dev.c_str(), O_RDWR);
+    if (handle_ < 0) {
+      char msg[1000];
+      snprintf(msg, 1000, "Error %s (%d) opening I2C device file %s",
+               strerror(errno), errno, bus_dev.c_str());
+      PFEXCEPTION_RAISE("I2CException", msg);
+    }
+  }
+  virtual ~FileDevice() {
+    if (handle_ > 0) close(handle_);
+  }
+  virtual int ioctl(unsigned long request, void* arg) {
+    return ::ioctl(handle_, request, arg);
+  }
+  virtual ssize_t read(void* buf, size_t n) { return ::read(handle_, buf, n); }
+  virtual ssize_t write(const void* buf, size_t n) {
+    return ::write(handle_, buf, n);
+  }
+
+ private:
+  int handle_;
+};
+}  // namespace
+
 lpGBT_ConfigTransport_I2C::lpGBT_ConfigTransport_I2C(
-    uint8_t i2c_addr, const std::string& bus_dev) {
-  handle_ = open(bus_dev.c_str(), O_RDWR);
-  ioctl(handle_, I2C_SLAVE, i2c_addr);
-  if (handle_ < 0) {
+    uint8_t i2c_addr, const std::string& bus_dev)
+    : lpGBT_ConfigTransport_I2C(i2c_addr,
+                                std::make_shared<FileDevice>(bus_dev)) {}
+
+lpGBT_ConfigTransport_I2C::lpGBT_ConfigTransport_I2C(
+    uint8_t i2c_addr, std::shared_ptr<Device> dev)
+    : i2c_addr_{i2c_addr}, dev_{dev}, chunk_{DEFAULT_CHUNK} {
+  // the raw read/write calls go to this address
+  void* addr = reinterpret_cast<void*>(uintptr_t(i2c_addr));
+  if (dev_->ioctl(I2C_SLAVE, addr) < 0) {
     char msg[1000];
-    snprintf(msg, 1000, "Error %s (%d) opening I2C device file %s",
-             strerror(errno), errno, bus_dev.c_str());
+    snprintf(msg, 1000, "Error %s (%d) selecting I2C address 0x%02x",
+             strerror(errno), errno, i2c_addr);
     PFEXCEPTION_RAISE("I2CException", msg);
   }
 }
-lpGBT_ConfigTransport_I2C::~lpGBT_ConfigTransport_I2C() {
-  if (handle_ > 0) close(handle_);
+
+void lpGBT_ConfigTransport_I2C::set_chunk_size(int n) {
+  if (n < 1 || n > MAX_CHUNK) {
+    PFEXCEPTION_RAISE("I2CException",
+                      "Chunk size " + std::to_string(n) +
+                          " is outside of 1 to " + std::to_string(MAX_CHUNK));
+  }
+  chunk_ = n;
 }
 
 void lpGBT_ConfigTransport_I2C::write_raw(uint8_t a) {
-  if (write(handle_, &a, 1) < 0) {
+  if (dev_->write(&a, 1) < 0) {
     printf("Error on raw write %s\n", strerror(errno));
   }
 }
 void lpGBT_ConfigTransport_I2C::write_raw(uint8_t a, uint8_t b) {
   uint8_t buf[2] = {a, b};
-  if (write(handle_, buf, 2) < 0) {
+  if (dev_->write(buf, 2) < 0) {
     printf("Error on raw write %s\n", strerror(errno));
   }
 }
 void lpGBT_ConfigTransport_I2C::write_raw(uint8_t a, uint8_t b, uint8_t c) {
   uint8_t buf[3] = {a, b, c};
-  if (write(handle_, buf, 3) < 0) {
+  if (dev_->write(buf, 3) < 0) {
     printf("Error on raw write %s\n", strerror(errno));
   }
 }
 void lpGBT_ConfigTransport_I2C::write_raw(const std::vector<uint8_t>& a) {
-  write(handle_, &(a[0]), a.size());
+  if (a.empty()) return;
+  if (dev_->write(a.data(), a.size()) < 0) {
+    printf("Error on raw write %s\n", strerror(errno));
+  }
 }
 
 uint8_t lpGBT_ConfigTransport_I2C::read_raw() {
-  uint8_t buf;
-  if (read(handle_, &buf, 1) < 0) {
+  uint8_t buf{0};
+  if (dev_->read(&buf, 1) < 0) {
     printf("Error on raw read %s\n", strerror(errno));
   }
   return buf;
 }
 
 std::vector<uint8_t> lpGBT_ConfigTransport_I2C::read_raw(int n) {
-  uint8_t buf[120];
-  read(handle_, buf, n);
-  std::vector<uint8_t> b;
-  for (int i = 0; i < n; i++) b.push_back(buf[i]);
+  std::vector<uint8_t> b(std::max(n, 0), 0);
+  read_raw(b.data(), b.size(), n);
   return b;
 }
 
-uint8_t lpGBT_ConfigTransport_I2C::read_reg(uint16_t reg) {
-  uint8_t data[2] = {uint8_t(reg & 0xFF), uint8_t((reg >> 8) & 0xFF)};
-  // write the register address, then read
-  if (write(handle_, data, 2) < 0 || read(handle_, data, 1) < 0) {
-    char msg[100];
-    snprintf(msg, 100, "Read from lpGBT register 0x%03x failed", reg);
-    PFEXCEPTION_RAISE("I2CException", msg);
+void lpGBT_ConfigTransport_I2C::read_raw(uint8_t* buf, size_t size, int n) {
+  if (n < 0 || size_t(n) > size) {
+    PFEXCEPTION_RAISE("I2CException",
+                      "Raw read of " + std::to_string(n) +
+                          " bytes into a buffer of " + std::to_string(size));
+  }
+  if (n == 0) return;
+  if (dev_->read(buf, n) < 0) {
+    printf("Error on raw read %s\n", strerror(errno));
   }
-  return data[0];
+}
+
+uint8_t lpGBT_ConfigTransport_I2C::read_reg(uint16_t reg) {
+  uint8_t value;
+  read_regs(reg, 1, &value, 1);
+  return value;
 }
 
 void lpGBT_ConfigTransport_I2C::write_reg(uint16_t reg, uint8_t val) {
-  uint8_t data[3] = {uint8_t(reg & 0xFF), uint8_t((reg >> 8) & 0xFF), val};
-  if (write(handle_, data, 3) < 0) {
-    char msg[100];
-    snprintf(msg, 100, "Write 0x%02x to lpGBT register 0x%03x failed", val,
-             reg);
-    PFEXCEPTION_RAISE("I2CException", msg);
-  }
+  write_regs(reg, &val, 1);
 }
 
 void lpGBT_ConfigTransport_I2C::write_regs(uint16_t reg,
                                            const std::vector<uint8_t>& value) {
-  uint8_t buffer[10];
-  size_t ptr = 0;
-  int n = 0;
-  while (ptr < value.size()) {
-    buffer[0] = uint8_t((reg + ptr) & 0xFF);
-    buffer[1] = uint8_t(((reg + ptr) >> 8) & 0xFF);
-    n = 0;
-    for (size_t i = 0; i < 8 && ptr + i < value.size();
-         i++) {  // limit to eight bytes
-      buffer[2 + i] = value[ptr + i];
-      n++;
-    }
-    if (write(handle_, buffer, n + 2) < 0) {
+  write_regs(reg, value.data(), value.size());
+}
+
+std::vector<uint8_t> lpGBT_ConfigTransport_I2C::read_regs(uint16_t reg, int n) {
+  std::vector<uint8_t> retval(std::max(n, 0), 0);
+  read_regs(reg, n, retval.data(), retval.size());
+  return retval;
+}
+
+void lpGBT_ConfigTransport_I2C::read_regs(uint16_t reg, int n, uint8_t* buf,
+                                          size_t size) {
+  if (n < 0 || size_t(n) > size) {
+    PFEXCEPTION_RAISE("I2CException",
+                      "Read of " + std::to_string(n) +
+                          " registers into a buffer of " +
+                          std::to_string(size));
+  }
+  for (int ptr = 0; ptr < n; ptr += chunk_) {
+    uint16_t addr = reg + ptr;
+    uint8_t abuf[2] = {uint8_t(addr & 0xFF), uint8_t((addr >> 8) & 0xFF)};
+    // write the register address, then read with a repeated start
+    struct i2c_msg msgs[2];
+    msgs[0].addr = i2c_addr_;
+    msgs[0].flags = 0;
+    msgs[0].len = 2;
+    msgs[0].buf = abuf;
+    msgs[1].addr = i2c_addr_;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = std::min(chunk_, n - ptr);
+    msgs[1].buf = buf + ptr;
+    struct i2c_rdwr_ioctl_data rdwr;
+    rdwr.msgs = msgs;
+    rdwr.nmsgs = 2;
+    if (dev_->ioctl(I2C_RDWR, &rdwr) < 0) {
       char msg[100];
-      snprintf(msg, 100, "Write to lpGBT register 0x%03x failed", reg);
+      snprintf(msg, 100, "Read from lpGBT register 0x%03x failed", addr);
       PFEXCEPTION_RAISE("I2CException", msg);
     }
-    ptr += n;
   }
 }
 
-std::vector<uint8_t> lpGBT_ConfigTransport_I2C::read_regs(uint16_t reg, int n) {
-  std::vector<uint8_t> retval;
-  uint8_t buffer[10];
-  int ptr = 0;
-  int ni = 0;
-  while (int(ptr) < n) {
-    buffer[0] = uint8_t((reg + ptr) & 0xFF);
-    buffer[1] = uint8_t(((reg + ptr) >> 8) & 0xFF);
-    ni = (n > ptr + 8) ? (8) : (n - ptr);
-
-    if (write(handle_, buffer, 2) < 0 || read(handle_, buffer, ni) < 0) {
+void lpGBT_ConfigTransport_I2C::write_regs(uint16_t reg, const uint8_t* values,
+                                           size_t n) {
+  for (size_t ptr = 0; ptr < n; ptr += chunk_) {
+    uint16_t addr = reg + ptr;
+    size_t len = std::min(size_t(chunk_), n - ptr);
+    wbuf_[0] = uint8_t(addr & 0xFF);
+    wbuf_[1] = uint8_t((addr >> 8) & 0xFF);
+    std::copy(values + ptr, values + ptr + len, wbuf_.begin() + 2);
+    struct i2c_msg wmsg;
+    wmsg.addr = i2c_addr_;
+    wmsg.flags = 0;
+    wmsg.len = 2 + len;
+    wmsg.buf = wbuf_.data();
+    struct i2c_rdwr_ioctl_data rdwr;
+    rdwr.msgs = &wmsg;
+    rdwr.nmsgs = 1;
+    if (dev_->ioctl(I2C_RDWR, &rdwr) < 0) {
       char msg[100];
-      snprintf(msg, 100, "Read from lpGBT register 0x%03x failed", reg);
+      snprintf(msg, 100, "Write to lpGBT register 0x%03x failed", addr);
       PFEXCEPTION_RAISE("I2CException", msg);
     }
-
-    for (int i = 0; i < ni; i++) retval.push_back(buffer[i]);
-    ptr += ni;
   }
-  return retval;
 }
 
 }  // namespace pflib
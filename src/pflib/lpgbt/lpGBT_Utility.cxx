@@ -2,6 +2,10 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <fstream>
 
 #include "pflib/lpgbt/lpGBT_Registers.h"
 #include "pflib/utility/str_to_int.h"
@@ -113,5 +117,73 @@ void applylpGBTCSV(const std::string& filename, lpGBT& lpgbt) {
   }
 }
 
+static bool is_yaml(const std::string& filename) {
+  auto ext = filename.rfind('.');
+  if (ext == std::string::npos) return false;
+  std::string e = filename.substr(ext);
+  return (e == ".yaml" || e == ".yml");
+}
+
+void saveRegisterSnapshot(const std::string& filename,
+                          const lpGBT::RegisterValueVector& snapshot) {
+  std::ofstream f{filename, std::ios::binary};
+  if (!f.is_open()) {
+    PFEXCEPTION_RAISE("FileOpenException",
+                      "Unable to open snapshot file '" + filename + "'");
+  }
+  if (is_yaml(filename)) {
+    YAML::Emitter out;
+    out << YAML::Hex << YAML::BeginMap;
+    for (const auto& [reg, value] : snapshot) {
+      out << YAML::Key << reg << YAML::Value << int(value);
+    }
+    out << YAML::EndMap;
+    f << out.c_str() << '\n';
+  } else {
+    std::vector<char> image(lpGBT::SHADOW_SIZE, 0);
+    for (const auto& [reg, value] : snapshot) {
+      if (reg < lpGBT::SHADOW_SIZE) image[reg] = value;
+    }
+    f.write(image.data(), image.size());
+  }
+}
+
+lpGBT::RegisterValueVector loadRegisterSnapshot(const std::string& filename) {
+  lpGBT::RegisterValueVector retval;
+  if (is_yaml(filename)) {
+    YAML::Node doc;
+    try {
+      doc = YAML::LoadFile(filename);
+    } catch (const YAML::Exception& e) {
+      PFEXCEPTION_RAISE("BadFile", "Unable to load snapshot '" + filename +
+                                       "': " + e.what());
+    }
+    for (const auto& entry : doc) {
+      retval.push_back(
+          std::make_pair(uint16_t(utility::str_to_int(entry.first.Scalar())),
+                         uint8_t(utility::str_to_int(entry.second.Scalar()))));
+    }
+    std::sort(retval.begin(), retval.end());
+    return retval;
+  }
+  std::ifstream f{filename, std::ios::binary};
+  if (!f.is_open()) {
+    PFEXCEPTION_RAISE("FileOpenException",
+                      "Unable to open snapshot file '" + filename + "'");
+  }
+  std::vector<char> image(lpGBT::SHADOW_SIZE, 0);
+  f.read(image.data(), image.size());
+  if (f.gcount() != lpGBT::SHADOW_SIZE) {
+    PFEXCEPTION_RAISE("BadFile", "Snapshot '" + filename +
+                                     "' is not a full lpGBT register image");
+  }
+  for (uint16_t reg = 0; reg < lpGBT::SHADOW_SIZE; reg++) {
+    if (lpGBT::is_shadowed(reg)) {
+      retval.push_back(std::make_pair(reg, uint8_t(image[reg])));
+    }
+  }
+  return retval;
+}
+
 }  // namespace lpgbt
 }  // namespace pflib
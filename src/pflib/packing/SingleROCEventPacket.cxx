@@ -25,7 +25,7 @@ void SingleROCEventPacket::from(std::span<uint32_t> data) {
     pflib_log(trace) << hex(word) << " link lengths ";
   }
 
-  std::size_t link_start_offset{1 + 3};
+  std::size_t link_start_offset{N_LENGTH_WORDS};
   for (std::size_t i_link{0}; i_link < 6; i_link++) {
     auto link_len = link_lengths[i_link];
     pflib_log(trace) << "link " << i_link << " length " << link_len;
@@ -41,7 +41,7 @@ void SingleROCEventPacket::from(std::span<uint32_t> data) {
 Reader& SingleROCEventPacket::read(Reader& r) {
   uint32_t prev_word{0}, word{0};
   pflib_log(trace) << "header scan...";
-  while (prev_word != 0x11888811 or word != 0xbeef2025) {
+  while (prev_word != HEADER_0 or word != HEADER_1) {
     prev_word = word;
     if (!(r >> word)) break;
     pflib_log(trace) << hex(word);
@@ -71,7 +71,7 @@ Reader& SingleROCEventPacket::read(Reader& r) {
   from(link_data);
 
   pflib_log(trace) << "trailer scan...";
-  while (prev_word != 0xd07e2025 or word != 0x12345678) {
+  while (prev_word != TRAILER_0 or word != TRAILER_1) {
     prev_word = word;
     if (!(r >> word)) break;
     pflib_log(trace) << hex(word);
@@ -136,4 +136,35 @@ uint32_t SingleROCEventPacket::trigsum(int i_link, int i_sum, int i_bx) const {
   return trigger_links[i_link].linearized_sum(i_sum, i_bx);
 }
 
+void write_simpleroc(
+    int n_links, const std::function<std::vector<uint32_t>(int)>& link_data,
+    std::vector<uint32_t>& buffer) {
+  buffer.push_back(SingleROCEventPacket::HEADER_0);
+  buffer.push_back(SingleROCEventPacket::HEADER_1);
+
+  // total length and link lengths, filled in as the links are added
+  std::size_t i_len = buffer.size();
+  buffer.push_back(0);
+  for (int i = 0; i < (n_links + 1) / 2; i++) buffer.push_back(0);
+  std::size_t len_total = buffer.size() - i_len;
+
+  for (int i = 0; i < n_links; i++) {
+    std::vector<uint32_t> data = link_data(i);
+    if (i >= 2) {  // trigger links
+      uint32_t theader = 0x30000000 | ((i - 2)) | (data.size() << 8);
+      data.insert(data.begin(), theader);
+    }
+    std::size_t len = data.size();
+    len_total += len;
+    buffer.insert(buffer.end(), data.begin(), data.end());
+    if (i % 2)
+      buffer[i_len + 1 + i / 2] |= (len << 16);
+    else
+      buffer[i_len + 1 + i / 2] |= (len);
+  }
+  buffer[i_len] |= len_total;
+  buffer.push_back(SingleROCEventPacket::TRAILER_0);
+  buffer.push_back(SingleROCEventPacket::TRAILER_1);
+}
+
 }  // namespace pflib::packing
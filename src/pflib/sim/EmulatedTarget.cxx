@@ -0,0 +1,285 @@
+#include "pflib/sim/EmulatedTarget.h"
+
+#include <algorithm>
+
+#include "pflib/packing/SingleROCEventPacket.h"
+
+namespace pflib {
+namespace sim {
+
+RecordingFastControl::RecordingFastControl()
+    : bx_{0},
+      orbit_{0},
+      n_l1a_{0},
+      charge_to_l1a_{20},
+      led_to_l1a_{18} {
+  resetCounters();
+}
+
+std::map<std::string, uint32_t> RecordingFastControl::getCmdCounters() {
+  return counters_;
+}
+
+void RecordingFastControl::resetCounters() {
+  for (const char* name :
+       {"L1A", "L1A_NZS", "ORBIT_SYNC", "ORBIT_COUNT_RESET", "CALIB_INT",
+        "CALIB_EXT", "CHIPSYNC", "ECR", "EBR", "LINKRESET_ROCT",
+        "LINKRESET_ROCD", "LINKRESET_ECONT", "LINKRESET_ECOND"}) {
+    counters_[name] = 0;
+  }
+}
+
+void RecordingFastControl::send(const std::string& name, int n_bx) {
+  counters_[name]++;
+  history_.push_back({name, bx_, orbit_});
+  bx_ += n_bx;
+  while (bx_ >= BX_PER_ORBIT) {
+    bx_ -= BX_PER_ORBIT;
+    orbit_++;
+    counters_["ORBIT_SYNC"]++;
+  }
+}
+
+void RecordingFastControl::l1a(int bx_since_charge) {
+  int bx{bx_}, orbit{orbit_}, event{n_l1a_++};
+  send("L1A");
+  if (trigger_) trigger_(bx, event, orbit, bx_since_charge);
+}
+
+void RecordingFastControl::pulse(const std::string& name, int pulse_to_l1a) {
+  send(name, std::max(pulse_to_l1a, 1));
+  for (int i{0}; i < l1a_per_ror_; i++) {
+    l1a(std::max(pulse_to_l1a, 1) + i);
+  }
+}
+
+void RecordingFastControl::sendL1A() { l1a(-1); }
+
+void RecordingFastControl::linkreset_rocs() {
+  send("LINKRESET_ROCT");
+  send("LINKRESET_ROCD");
+}
+
+void RecordingFastControl::linkreset_econs() { send("LINKRESET_ECOND"); }
+
+void RecordingFastControl::bx_custom(int bx_addr, int bx_mask, int bx_new) {}
+
+void RecordingFastControl::bufferclear() { send("EBR"); }
+
+void RecordingFastControl::orbit_count_reset() {
+  send("ORBIT_COUNT_RESET");
+  orbit_ = 0;
+}
+
+void RecordingFastControl::chargepulse() { pulse("CALIB_INT", charge_to_l1a_); }
+
+void RecordingFastControl::ledpulse() { pulse("CALIB_EXT", led_to_l1a_); }
+
+void RecordingFastControl::clear_run() {
+  resetCounters();
+  bufferclear();
+  orbit_count_reset();
+  send("ECR");
+  n_l1a_ = 0;
+}
+
+EmulatedCapture::EmulatedCapture(int nlinks, int depth)
+    : Elinks(nlinks),
+      DAQ(nlinks),
+      depth_(depth),
+      dropped_{0},
+      bitslip_(nlinks, 0),
+      phase_(nlinks, 0),
+      l1a_delay_(nlinks, 0),
+      capture_width_(nlinks, 0) {
+  for (int ilink{0}; ilink < nlinks; ilink++) {
+    capture_width_[ilink] =
+        ilink % FrontEnd::N_LINKS < 2 ? FrontEnd::DAQ_FRAME_WORDS
+                                      : FrontEnd::TRIGGER_FRAME_WORDS;
+  }
+}
+
+bool EmulatedCapture::push(Capture&& capture) {
+  if (buffer_.size() >= depth_) {
+    dropped_++;
+    return false;
+  }
+  buffer_.push_back(std::move(capture));
+  return true;
+}
+
+std::vector<uint32_t> EmulatedCapture::spy(int ilink) {
+  // the emulated links are always idle and aligned
+  return {0xaccccccc};
+}
+
+void EmulatedCapture::setBitslip(int ilink, int bitslip) {
+  bitslip_.at(ilink) = bitslip;
+}
+
+void EmulatedCapture::reset() {
+  buffer_.clear();
+  dropped_ = 0;
+}
+
+int EmulatedCapture::getEventOccupancy() { return int(buffer_.size()); }
+
+void EmulatedCapture::setupLink(int ilink, int l1a_delay,
+                                int l1a_capture_width) {
+  l1a_delay_.at(ilink) = l1a_delay;
+  capture_width_.at(ilink) = l1a_capture_width;
+}
+
+void EmulatedCapture::getLinkSetup(int ilink, int& l1a_delay,
+                                   int& l1a_capture_width) {
+  l1a_delay = l1a_delay_.at(ilink);
+  l1a_capture_width = capture_width_.at(ilink);
+}
+
+void EmulatedCapture::bufferStatus(int ilink, bool& empty, bool& full) {
+  empty = buffer_.empty();
+  full = buffer_.size() >= depth_;
+}
+
+std::vector<uint32_t> EmulatedCapture::getLinkData(int ilink) {
+  if (buffer_.empty() or ilink < 0 or ilink >= DAQ::nlinks()) return {};
+  return buffer_.front()[ilink];
+}
+
+void EmulatedCapture::advanceLinkReadPtr() {
+  if (not buffer_.empty()) buffer_.pop_front();
+}
+
+EmulatedTarget::EmulatedTarget(int nrocs, const std::string& roc_type,
+                               uint64_t seed)
+    : roc_type_{roc_type},
+      fc_{std::make_shared<RecordingFastControl>()},
+      capture_{std::make_shared<EmulatedCapture>(FrontEnd::N_LINKS * nrocs)},
+      daqformat_{DaqFormat::SIMPLEROC},
+      l1a_{0} {
+  if (nrocs < 1) {
+    PFEXCEPTION_RAISE("BadConfig",
+                      "Emulated targets need at least one ROC, not " +
+                          std::to_string(nrocs));
+  }
+  // the models keep a reference to their chip, so no reallocation
+  front_ends_.reserve(nrocs);
+  for (int iroc{0}; iroc < nrocs; iroc++) {
+    auto chip = std::make_shared<HGCROC_I2C>(0x20);
+    rocs_.emplace_back(chip, 0x20, roc_type_);
+    front_ends_.emplace_back(*chip, roc_type_, seed + iroc);
+    chips_.push_back(chip);
+    i2c_["HGCROC_" + std::to_string(iroc)] = chip;
+    roc_to_erx_map_.emplace_back(2 * iroc, 2 * iroc + 1);
+  }
+  hardResetROCs();
+  fc_->set_trigger([this](int bx, int event, int orbit, int bx_since_charge) {
+    trigger(bx, event, orbit, bx_since_charge);
+  });
+}
+
+std::vector<int> EmulatedTarget::roc_ids() const {
+  std::vector<int> ids;
+  for (int iroc{0}; iroc < int(rocs_.size()); iroc++) ids.push_back(iroc);
+  return ids;
+}
+
+ROC& EmulatedTarget::roc(int which) {
+  if (not have_roc(which)) {
+    PFEXCEPTION_RAISE("InvalidROCid",
+                      "Requested ROC " + std::to_string(which) +
+                          " which is not in this emulated target.");
+  }
+  return rocs_[which];
+}
+
+void EmulatedTarget::hardResetROCs() {
+  auto c = Compiler::get(roc_type_);
+  RegisterImage defaults = c.compile_image(c.defaults());
+  for (std::size_t iroc{0}; iroc < chips_.size(); iroc++) {
+    for (int page : defaults.pages()) {
+      for (int reg : defaults.registers(page)) {
+        chips_[iroc]->poke(page, reg, defaults.get(page, reg));
+      }
+    }
+    rocs_[iroc].refresh();
+  }
+}
+
+void EmulatedTarget::trigger(int bx, int event, int orbit,
+                             int bx_since_charge) {
+  EmulatedCapture::Capture capture;
+  capture.reserve(capture_->DAQ::nlinks());
+  for (FrontEnd& fe : front_ends_) {
+    fe.readout(bx, event, orbit, bx_since_charge, frames_);
+    capture.insert(capture.end(), frames_.begin(), frames_.end());
+  }
+  capture_->push(std::move(capture));
+}
+
+void EmulatedTarget::setup_run(int irun, DaqFormat format, int contrib_id) {
+  daqformat_ = format;
+  l1a_ = 0;
+  daq().reset();
+  fc().clear_run();
+}
+
+std::vector<uint32_t> EmulatedTarget::read_event() {
+  std::vector<uint32_t> buffer;
+  if (not has_event()) return buffer;
+  switch (daqformat_) {
+    case DaqFormat::SIMPLEROC: {
+      // same layout as the Fiberless target, only the links of ROC 0
+      packing::write_simpleroc(
+          FrontEnd::N_LINKS, [this](int i) { return daq().getLinkData(i); },
+          buffer);
+      daq().advanceLinkReadPtr();
+    } break;
+    case DaqFormat::ECOND_NO_ZS:
+    case DaqFormat::ECOND_SW_HEADERS: {
+      formatter_.disable_zs(daqformat_ == DaqFormat::ECOND_NO_ZS);
+      for (int il1a = 0; il1a < daq().samples_per_ror(); il1a++) {
+        if (daq().getEventOccupancy() == 0) break;
+        // take the timing of the ECON-D packet from the first ROC
+        uint32_t roc_header = daq().getLinkData(0)[0];
+        formatter_.startEvent((roc_header >> 16) & 0xFFF,
+                              (roc_header >> 10) & 0x3F,
+                              (roc_header >> 7) & 0x7);
+        // only the DAQ links of each ROC go into the ECON-D
+        for (int iroc = 0; iroc < nrocs(); iroc++) {
+          for (int i = 0; i < 2; i++) {
+            formatter_.add_elink_packet(
+                2 * iroc + i, daq().getLinkData(FrontEnd::N_LINKS * iroc + i));
+          }
+        }
+        formatter_.finishEvent();
+
+        const auto& packet{formatter_.getPacket()};
+        uint32_t header = packet.size();
+        header |= (0x1 << 28);
+        header |= (daq().econid() & 0x3ff) << 18;
+        header |= (il1a & 0x1f) << 13;
+        if (il1a == daq().soi()) header |= (1 << 12);
+        buffer.push_back(header);
+        buffer.insert(buffer.end(), packet.begin(), packet.end());
+        daq().advanceLinkReadPtr();
+      }
+      l1a_ += daq().samples_per_ror();
+      // same trailer as DAQ::read_event_sw_headers
+      buffer.push_back((0x1 << 28) | (0x3ff << 18) | (31 << 13));
+    } break;
+    default: {
+      PFEXCEPTION_RAISE("NoImpl", "DaqFormat provided is not implemented");
+    }
+  }
+  return buffer;
+}
+
+}  // namespace sim
+
+Target* makeTargetEmulated(int nrocs, const std::string& roc_type,
+                           uint64_t seed) {
+  return new sim::EmulatedTarget(nrocs, roc_type, seed);
+}
+
+}  // namespace pflib
@@ -0,0 +1,236 @@
+#include "pflib/sim/EventGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "pflib/Exception.h"
+#include "pflib/packing/SingleROCEventPacket.h"
+#include "pflib/utility/crc.h"
+
+namespace pflib {
+namespace sim {
+
+/// number of BX in one orbit
+static constexpr int BX_PER_ORBIT = 3564;
+/// mean amplitude of a hit above the pedestal
+static constexpr double MEAN_AMPLITUDE = 200.;
+/// subsystem ID of the calorimeters in the readout request header
+static constexpr uint32_t SUBSYSTEM_ID = 5;
+
+/// clamp a measurement into the 10 bits we have
+static uint32_t ten_bits(double val) {
+  return uint32_t(std::clamp(std::lround(val), 0l, 1023l));
+}
+
+/// check that a value is within [low, high]
+template <typename T>
+static void check_range(const std::string& name, T val, T low, T high) {
+  if (val < low or val > high) {
+    PFEXCEPTION_RAISE("BadConfig", name + " of " + std::to_string(val) +
+                                       " is outside of [" +
+                                       std::to_string(low) + ", " +
+                                       std::to_string(high) + "].");
+  }
+}
+
+EventGenerator::EventGenerator(const Config& cfg)
+    : cfg_{cfg},
+      rng_{cfg.seed},
+      uniform_{0., 1.},
+      noise_{0., 2.},
+      amplitude_{1. / MEAN_AMPLITUDE},
+      bx_{0},
+      orbit_{0},
+      l1a_{0},
+      n_events_{0},
+      n_bx_{0} {
+  check_range("occupancy", cfg_.occupancy, 0., 1.);
+  // the largest sample index and ECON ID are reserved for the trailer
+  check_range("number of samples", cfg_.n_samples, 1, 31);
+  check_range("sample of interest", cfg_.i_soi, 0, cfg_.n_samples - 1);
+  check_range("number of eRx", cfg_.n_links, 1, ECOND_Formatter::MAX_ERX);
+  check_range("number of ECON-Ds", cfg_.n_econs, 1, 1023);
+  check_range("contributor ID", cfg_.contrib_id, 0, 255);
+  check_range("bad CRC rate", cfg_.bad_crc_rate, 0., 1.);
+  check_range("truncation rate", cfg_.truncation_rate, 0., 1.);
+  check_range("bad header rate", cfg_.bad_header_rate, 0., 1.);
+
+  if (cfg_.zero_suppression) {
+    ECOND_Formatter::ChannelZS zs;
+    zs.lambda = ZS_THRESHOLD;
+    zs.beta = ZS_THRESHOLD;
+    formatter_.set_zs(zs);
+  } else {
+    formatter_.disable_zs();
+  }
+  frames_.resize(std::max(cfg_.n_links, 2));
+  for (auto& frame : frames_) frame.reserve(packing::DAQLinkFrame::N_WORDS);
+}
+
+void EventGenerator::next(std::vector<uint32_t>& event) {
+  event.clear();
+  int first_bx = bx_, first_orbit = orbit_, first_l1a = l1a_;
+  uint64_t first_n_bx = n_bx_;
+  if (cfg_.format == Format::SIMPLEROC) {
+    for (int i_sample{0}; i_sample < cfg_.n_samples; i_sample++) {
+      l1a();
+      simpleroc(event);
+    }
+  } else {
+    for (int i_econ{0}; i_econ < cfg_.n_econs; i_econ++) {
+      // all ECON-Ds see the same L1As
+      bx_ = first_bx;
+      orbit_ = first_orbit;
+      l1a_ = first_l1a;
+      n_bx_ = first_n_bx;
+      if (cfg_.format == Format::ECOND) {
+        econd(i_econ, event);
+        continue;
+      }
+      /**
+       * rogue data file record: the size in bytes of the rest of the
+       * record, a header word with the channel (31:24), error (23:16)
+       * and flags (15:0), then the frame which starts with the LDMX
+       * readout request header
+       */
+      std::size_t i_record = event.size();
+      event.push_back(0);
+      event.push_back(0);
+      event.push_back((0xA5u << 24) | (cfg_.contrib_id << 16) |
+                      (SUBSYSTEM_ID << 8));
+      event.push_back(0);
+      event.push_back(n_bx_ & 0xFFFFFFFF);
+      event.push_back(n_bx_ >> 32);
+      econd(i_econ, event);
+      event[i_record] = 4 * (event.size() - i_record - 1);
+    }
+  }
+  // leave some BX before the next event
+  std::uniform_int_distribution<int> gap(1, 100);
+  int n_bx = gap(rng_);
+  bx_ += n_bx;
+  n_bx_ += n_bx;
+  orbit_ += bx_ / BX_PER_ORBIT;
+  bx_ %= BX_PER_ORBIT;
+  n_events_++;
+}
+
+void EventGenerator::l1a() {
+  // the samples of an event are on consecutive BX
+  bx_++;
+  n_bx_++;
+  if (bx_ >= BX_PER_ORBIT) {
+    bx_ = 0;
+    orbit_++;
+  }
+  l1a_++;
+}
+
+uint32_t EventGenerator::channel_word() {
+  uint32_t adc_tm1 = ten_bits(PEDESTAL + noise_(rng_));
+  double val = PEDESTAL + noise_(rng_);
+  uint32_t toa = 0;
+  if (uniform_(rng_) < cfg_.occupancy) {
+    val += amplitude_(rng_);
+    toa = 1 + uint32_t(uniform_(rng_) * 1022);
+    if (val > 1023) {
+      // TOT mode, Tc = Tp = 1
+      return (0b11u << 30) | (adc_tm1 << 20) | (ten_bits(val / 4) << 10) |
+             toa;
+    }
+  }
+  return (adc_tm1 << 20) | (ten_bits(val) << 10) | toa;
+}
+
+void EventGenerator::daq_link_frame(std::vector<uint32_t>& frame,
+                                    bool bad_header) {
+  frame.resize(packing::DAQLinkFrame::N_WORDS);
+  frame[0] = ((bad_header ? 0x0u : 0xFu) << 28) | ((bx_ & 0xFFF) << 16) |
+             ((l1a_ & 0x3F) << 10) | ((orbit_ & 0x7) << 7) | 0b0101;
+  frame[1] = (PEDESTAL << 10) | PEDESTAL;
+  for (int i_word{2}; i_word < packing::DAQLinkFrame::N_WORDS - 1; i_word++) {
+    frame[i_word] = channel_word();
+  }
+  frame.back() = utility::crc32(
+      std::span(frame.begin(), packing::DAQLinkFrame::N_WORDS - 1));
+}
+
+void EventGenerator::simpleroc(std::vector<uint32_t>& event) {
+  // one of the DAQ links gets the defects
+  int i_bad = uniform_(rng_) < 0.5 ? 0 : 1;
+  bool bad_header = chance(cfg_.bad_header_rate);
+  if (bad_header) injected_.bad_header++;
+  for (int i_link{0}; i_link < 2; i_link++) {
+    daq_link_frame(frames_[i_link], bad_header and i_link == i_bad);
+  }
+  if (chance(cfg_.bad_crc_rate)) {
+    injected_.bad_crc++;
+    frames_[i_bad].back() ^= (1u << int(uniform_(rng_) * 32));
+  }
+  if (chance(cfg_.truncation_rate)) {
+    injected_.truncated++;
+    frames_[i_bad].resize(
+        1 + int(uniform_(rng_) * (packing::DAQLinkFrame::N_WORDS - 1)));
+  }
+
+  packing::write_simpleroc(
+      6,
+      [this](int i_link) {
+        if (i_link < 2) return frames_[i_link];
+        // trigger links with zero sums
+        return std::vector<uint32_t>(4, 0xAu << 28);
+      },
+      event);
+}
+
+void EventGenerator::econd(int i_econ, std::vector<uint32_t>& event) {
+  for (int i_sample{0}; i_sample < cfg_.n_samples; i_sample++) {
+    l1a();
+    formatter_.startEvent(bx_, l1a_, orbit_);
+    for (int i_erx{0}; i_erx < cfg_.n_links; i_erx++) {
+      daq_link_frame(frames_[i_erx], false);
+      formatter_.add_elink_packet(i_erx, frames_[i_erx]);
+    }
+    // a buffer that cannot hold the event truncates it
+    bool truncate = chance(cfg_.truncation_rate);
+    if (truncate) injected_.truncated++;
+    formatter_.reset_buffer();
+    formatter_.setup_buffer(1, truncate ? 1 : 0);
+    formatter_.finishEvent();
+
+    const auto& packet{formatter_.getPacket()};
+    uint32_t header = packet.size();
+    header |= (0x1 << 28);
+    header |= (i_econ & 0x3ff) << 18;
+    header |= (i_sample & 0x1f) << 13;
+    if (i_sample == cfg_.i_soi) header |= (1 << 12);
+    event.push_back(header);
+    std::size_t i_packet = event.size();
+    event.insert(event.end(), packet.begin(), packet.end());
+
+    if (chance(cfg_.bad_header_rate)) {
+      // wrong marker with the 8-bit header CRC still matching
+      injected_.bad_header++;
+      event[i_packet] ^= (0xFFu << 24);
+      uint64_t header_crc_base = (event[i_packet] >> 6);
+      header_crc_base <<= 30;
+      header_crc_base |= (event[i_packet + 1] >> 8);
+      event[i_packet + 1] = (event[i_packet + 1] & 0xFFFFFF00u) |
+                            utility::econd_crc8(header_crc_base);
+    }
+    if (chance(cfg_.bad_crc_rate)) {
+      injected_.bad_crc++;
+      event.back() ^= (1u << int(uniform_(rng_) * 32));
+    }
+  }
+  // same trailer as DAQ::read_event_sw_headers
+  event.push_back((0x1 << 28) | (0x3ff << 18) | (31 << 13));
+}
+
+bool EventGenerator::chance(double rate) {
+  // don't draw when there are no defects so the data doesn't change
+  return rate > 0. and uniform_(rng_) < rate;
+}
+
+}  // namespace sim
+}  // namespace pflib
@@ -0,0 +1,209 @@
+#include "pflib/sim/FrontEnd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include "pflib/Exception.h"
+#include "pflib/utility/crc.h"
+
+namespace pflib {
+namespace sim {
+
+/// names of the per-channel parameters in the order of ChannelParameter
+static const char* CHANNEL_PARAMETERS[] = {
+    "TRIM_INV", "DACB", "SIGN_DAC", "HIGHRANGE", "LOWRANGE", "TRIM_TOA",
+    "TRIM_TOT"};
+/// names of the per-half parameters in the order of HalfParameter
+static const std::pair<const char*, const char*> HALF_PARAMETERS[] = {
+    {"REFERENCEVOLTAGE_", "INV_VREF"}, {"REFERENCEVOLTAGE_", "NOINV_VREF"},
+    {"REFERENCEVOLTAGE_", "TOA_VREF"}, {"REFERENCEVOLTAGE_", "TOT_VREF"},
+    {"REFERENCEVOLTAGE_", "CALIB"},    {"REFERENCEVOLTAGE_", "INTCTEST"},
+    {"DIGITALHALF_", "L1OFFSET"}};
+
+/// length of a bunch crossing
+static constexpr double BX_NS = 25.;
+/// shaping time of the pulse, it peaks this long after the charge
+static constexpr double SHAPING_NS = 25.;
+/**
+ * BX between the charge and the L1A beyond L1OFFSET for the peak to be
+ * in the sample, with the chip default L1OFFSET of 16 the peak is seen
+ * at a separation of 20 (see FastControlCMS_MMap::standard_setup)
+ */
+static constexpr int CHARGE_LATENCY_BX = 4;
+
+/// CR-RC pulse shape normalized to one at its peak
+static double shape(double t_ns) {
+  if (t_ns <= 0) return 0.;
+  double x = t_ns / SHAPING_NS;
+  return x * std::exp(1. - x);
+}
+
+/// clamp a measurement into the 10 bits we have
+static uint32_t ten_bits(double val) {
+  return uint32_t(std::clamp(std::lround(val), 0l, 1023l));
+}
+
+FrontEnd::FrontEnd(const HGCROC_I2C& chip, const std::string& type_version,
+                   uint64_t seed)
+    : chip_{chip},
+      revision_{-1},
+      l1offset_{0, 0},
+      phase_ns_{0.},
+      noise_{2.},
+      rng_{seed},
+      gauss_{0., 1.} {
+  Compiler compiler{Compiler::get(type_version)};
+  std::set<int> pages;
+  for (int i_ch{0}; i_ch < 74; i_ch++) {
+    std::string page = i_ch < 72 ? "CH_" + std::to_string(i_ch)
+                                  : "CALIB_" + std::to_string(i_ch - 72);
+    for (int i_param{0}; i_param < N_CHANNEL_PARAMETERS; i_param++) {
+      try {
+        channel_handles_[i_ch][i_param] =
+            compiler.resolve(page, CHANNEL_PARAMETERS[i_param]);
+      } catch (const Exception&) {
+        // only the SiPM ROCs have the bias DAC, an empty handle reads zero
+        if (i_param != DACB and i_param != SIGN_DAC) throw;
+        continue;
+      }
+      pages.insert(channel_handles_[i_ch][i_param].page());
+    }
+  }
+  for (int half{0}; half < 2; half++) {
+    for (int i_param{0}; i_param < N_HALF_PARAMETERS; i_param++) {
+      const auto& [page, param] = HALF_PARAMETERS[i_param];
+      half_handles_[half][i_param] =
+          compiler.resolve(page + std::to_string(half), param);
+      pages.insert(half_handles_[half][i_param].page());
+    }
+  }
+  phase_strobe_ = compiler.resolve("TOP", "PHASE_STROBE");
+  pages.insert(phase_strobe_.page());
+  pages_.assign(pages.begin(), pages.end());
+
+  // channel to channel variation that doesn't depend on the registers
+  std::uniform_real_distribution<double> spread(80., 120.);
+  for (Channel& ch : channels_) ch.offset = spread(rng_);
+}
+
+void FrontEnd::update() {
+  if (chip_.revision() == revision_) return;
+  revision_ = chip_.revision();
+
+  RegisterImage image;
+  for (int page : pages_) {
+    for (int reg{0}; reg < 32; reg++) {
+      image.set(page, reg, chip_.peek(page, reg));
+    }
+  }
+  auto half_param = [&](int half, HalfParameter p) {
+    return double(half_handles_[half][p].decode(image));
+  };
+  for (int i_ch{0}; i_ch < 74; i_ch++) {
+    int half = i_ch < 72 ? i_ch / 36 : i_ch - 72;
+    const auto& handles{channel_handles_[i_ch]};
+    auto param = [&](ChannelParameter p) {
+      return double(handles[p].decode(image));
+    };
+    Channel& ch{channels_[i_ch]};
+    ch.pedestal = ch.offset + param(TRIM_INV) +
+                  (param(SIGN_DAC) > 0 ? -1.5 : 1.5) * param(DACB) +
+                  0.5 * (half_param(half, INV_VREF) - 416.) -
+                  0.25 * (half_param(half, NOINV_VREF) - 832.);
+    double gain{0.};
+    if (half_param(half, INTCTEST) > 0) {
+      if (param(HIGHRANGE) > 0) {
+        gain = 1.;
+      } else if (param(LOWRANGE) > 0) {
+        gain = 0.1;
+      }
+    }
+    ch.amplitude = gain * half_param(half, CALIB);
+    ch.toa_threshold =
+        std::max(1., 2. * (half_param(half, TOA_VREF) - 112.) + 20. +
+                         0.5 * (31. - param(TRIM_TOA)));
+    ch.tot_threshold = 2. * half_param(half, TOT_VREF) - param(TRIM_TOT);
+  }
+  for (int half{0}; half < 2; half++) {
+    l1offset_[half] = int(half_param(half, L1OFFSET));
+  }
+  phase_ns_ = phase_strobe_.decode(image) * BX_NS / 16.;
+}
+
+double FrontEnd::pedestal(int channel) {
+  update();
+  return channels_.at(channel).pedestal;
+}
+
+uint32_t FrontEnd::sample(const Channel& ch, double t_ns) {
+  double adc =
+      ch.pedestal + ch.amplitude * shape(t_ns) + noise_ * gauss_(rng_);
+  double adc_prev = ch.pedestal + ch.amplitude * shape(t_ns - BX_NS) +
+                    noise_ * gauss_(rng_);
+
+  uint32_t toa{0};
+  if (ch.amplitude > ch.toa_threshold and t_ns > 0) {
+    // find the rising edge crossing, the pulse is monotonic until its peak
+    double lo{0.}, hi{SHAPING_NS};
+    for (int i{0}; i < 20; i++) {
+      double mid = 0.5 * (lo + hi);
+      if (ch.amplitude * shape(mid) > ch.toa_threshold) {
+        hi = mid;
+      } else {
+        lo = mid;
+      }
+    }
+    // only the BX holding the crossing measures it
+    double since_crossing = t_ns - hi;
+    if (since_crossing >= 0 and since_crossing < BX_NS) {
+      toa = std::clamp<uint32_t>(ten_bits(1024. * since_crossing / BX_NS), 1,
+                                 1023);
+    }
+  }
+
+  double peak = ch.pedestal + ch.amplitude;
+  if (ch.amplitude > 0 and peak > ch.tot_threshold and t_ns > 0 and
+      t_ns < 8 * BX_NS) {
+    uint32_t tot = std::max<uint32_t>(
+        ten_bits(0.5 * (peak - ch.tot_threshold)), 1);
+    return (0b11u << 30) | (ten_bits(adc_prev) << 20) | (tot << 10) | toa;
+  }
+  return (ten_bits(adc_prev) << 20) | (ten_bits(adc) << 10) | toa;
+}
+
+void FrontEnd::readout(int bx, int event, int orbit, int bx_since_charge,
+                       std::array<std::vector<uint32_t>, N_LINKS>& links) {
+  update();
+  for (int half{0}; half < 2; half++) {
+    double t_ns = -BX_NS;
+    if (bx_since_charge >= 0) {
+      // the pulse peaks on the sample when the delay matches the latency
+      t_ns = BX_NS * (bx_since_charge - l1offset_[half] - CHARGE_LATENCY_BX) +
+             SHAPING_NS - phase_ns_;
+    }
+
+    std::vector<uint32_t>& frame{links[half]};
+    frame.resize(DAQ_FRAME_WORDS);
+    frame[0] = (0xFu << 28) | ((bx & 0xFFF) << 16) | ((event & 0x3F) << 10) |
+               ((orbit & 0x7) << 7) | 0b0101;
+    double cm{0.};
+    for (int i_ch{0}; i_ch < 36; i_ch++) {
+      cm += channels_[36 * half + i_ch].pedestal;
+    }
+    uint32_t cm_adc = ten_bits(cm / 36);
+    frame[1] = (cm_adc << 10) | cm_adc;
+    for (int i_ch{0}; i_ch < 36; i_ch++) {
+      frame[2 + i_ch + (i_ch < 18 ? 0 : 1)] =
+          sample(channels_[36 * half + i_ch], t_ns);
+    }
+    frame[2 + 18] = sample(channels_[72 + half], t_ns);
+    frame[39] = utility::crc32(std::span(frame.begin(), 39));
+  }
+  for (int i_trig{0}; i_trig < 4; i_trig++) {
+    links[2 + i_trig].assign(TRIGGER_FRAME_WORDS, 0xAu << 28);
+  }
+}
+
+}  // namespace sim
+}  // namespace pflib
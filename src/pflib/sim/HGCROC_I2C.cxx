@@ -0,0 +1,163 @@
+#include "pflib/sim/HGCROC_I2C.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+namespace pflib {
+namespace sim {
+
+/// the pointer is two bytes wide
+static const int ADDRESS_SPACE = 1 << 16;
+
+HGCROC_I2C::HGCROC_I2C(uint8_t roc_base_addr, int max_transfer_bytes)
+    : roc_base_{roc_base_addr},
+      max_transfer_bytes_{max_transfer_bytes},
+      speed_{100},
+      pointer_{0},
+      memory_(ADDRESS_SPACE, 0),
+      direct_access_{0, 0, 0, 0},
+      n_transactions_{0},
+      n_bytes_written_{0},
+      n_bytes_read_{0},
+      bus_time_us_{0.},
+      latency_{0},
+      n_until_fail_{0},
+      n_fail_{0},
+      fail_every_{0},
+      n_injected_errors_{0},
+      revision_{0} {}
+
+void HGCROC_I2C::reset_transactions() {
+  n_transactions_ = 0;
+  n_bytes_written_ = 0;
+  n_bytes_read_ = 0;
+  bus_time_us_ = 0.;
+  n_injected_errors_ = 0;
+}
+
+void HGCROC_I2C::fail_after(int n_ok, int n_fail) {
+  n_until_fail_ = n_ok;
+  n_fail_ = n_fail;
+}
+
+void HGCROC_I2C::transaction(int n_bytes) {
+  n_transactions_++;
+  if (latency_.count() > 0) std::this_thread::sleep_for(latency_);
+  bool fail{false};
+  if (n_fail_ > 0) {
+    if (n_until_fail_ > 0) {
+      n_until_fail_--;
+    } else {
+      n_fail_--;
+      fail = true;
+    }
+  }
+  if (fail_every_ > 0 and n_transactions_ % fail_every_ == 0) fail = true;
+  // start and stop are about one clock cycle each
+  int n_cycles = 2 + 9 * (1 + (fail ? 0 : n_bytes));
+  bus_time_us_ += 1000. * n_cycles / std::max(speed_, 1);
+  if (fail) {
+    n_injected_errors_++;
+    PFEXCEPTION_RAISE("I2CErrorNoACK",
+                      "Injected failure of transaction " +
+                          std::to_string(n_transactions_));
+  }
+}
+
+int HGCROC_I2C::sub_address(uint8_t i2c_dev_addr) const {
+  int sub = int(i2c_dev_addr) - int(roc_base_);
+  if (sub < 0 or sub > 7) {
+    PFEXCEPTION_RAISE("I2CErrorNoACK", "No device at I2C address " +
+                                           std::to_string(i2c_dev_addr));
+  }
+  return sub;
+}
+
+void HGCROC_I2C::write_sub(int sub, uint8_t data) {
+  switch (sub) {
+    case 0:
+      pointer_ = (pointer_ & 0xFF00) | data;
+      break;
+    case 1:
+      pointer_ = (pointer_ & 0x00FF) | (uint16_t(data) << 8);
+      break;
+    case 2:
+      memory_[pointer_] = data;
+      revision_++;
+      break;
+    case 3:
+      memory_[pointer_++] = data;
+      revision_++;
+      break;
+    case 7:
+      // read only
+      break;
+    default:
+      direct_access_[sub - 4] = data;
+  }
+}
+
+uint8_t HGCROC_I2C::read_sub(int sub) {
+  switch (sub) {
+    case 0:
+      return pointer_ & 0xFF;
+    case 1:
+      return (pointer_ >> 8) & 0xFF;
+    case 2:
+      return memory_[pointer_];
+    case 3:
+      return memory_[pointer_++];
+    default:
+      return direct_access_[sub - 4];
+  }
+}
+
+void HGCROC_I2C::write_byte(uint8_t i2c_dev_addr, uint8_t data) {
+  int sub = sub_address(i2c_dev_addr);
+  transaction(1);
+  n_bytes_written_++;
+  write_sub(sub, data);
+}
+
+uint8_t HGCROC_I2C::read_byte(uint8_t i2c_dev_addr) {
+  int sub = sub_address(i2c_dev_addr);
+  transaction(1);
+  n_bytes_read_++;
+  return read_sub(sub);
+}
+
+std::vector<uint8_t> HGCROC_I2C::general_write_read(
+    uint8_t i2c_dev_addr, const std::vector<uint8_t>& wdata, int nread) {
+  int sub = sub_address(i2c_dev_addr);
+  if (int(wdata.size()) > max_transfer_bytes_ or nread > max_transfer_bytes_) {
+    PFEXCEPTION_RAISE("I2CError",
+                      "Transfer larger than " +
+                          std::to_string(max_transfer_bytes_) + " bytes");
+  }
+  if (not wdata.empty()) {
+    transaction(wdata.size());
+    n_bytes_written_ += wdata.size();
+    for (uint8_t byte : wdata) write_sub(sub, byte);
+  }
+  std::vector<uint8_t> rv;
+  if (nread > 0) {
+    transaction(nread);
+    n_bytes_read_ += nread;
+    rv.reserve(nread);
+    for (int i{0}; i < nread; i++) rv.push_back(read_sub(sub));
+  }
+  return rv;
+}
+
+uint8_t HGCROC_I2C::peek(int page, int offset) const {
+  return memory_[((page << 5) | offset) & 0xFFFF];
+}
+
+void HGCROC_I2C::poke(int page, int offset, uint8_t value) {
+  memory_[((page << 5) | offset) & 0xFFFF] = value;
+  revision_++;
+}
+
+}  // namespace sim
+}  // namespace pflib
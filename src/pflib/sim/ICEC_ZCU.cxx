@@ -0,0 +1,95 @@
+#include "pflib/sim/ICEC_ZCU.h"
+
+namespace pflib {
+namespace sim {
+
+static const int OFFSET_IC = 64;
+static const int OFFSET_EC = 66;
+static const uint32_t REG_ADDR_TX_DATA = 0;
+static const uint32_t REG_CTL_RESET_N_READ = 1;
+static const uint32_t MASK_N_READ = 0x000000FF;
+static const uint32_t MASK_RESET_RX = 0x01000000;
+static const uint32_t MASK_RESET_TX = 0x02000000;
+static const uint32_t MASK_START_WRITE = 0x04000000;
+static const uint32_t MASK_START_READ = 0x08000000;
+static const uint32_t MASK_TX_FIFO_LOAD = 0x10000000;
+static const uint32_t MASK_RX_FIFO_ADV = 0x20000000;
+static const uint32_t REG_STATUS_READ = 4;
+static const uint32_t MASK_RX_EMPTY = 0x00000100;
+static const uint32_t MASK_TX_EMPTY = 0x00000200;
+
+ICEC_ZCU::ICEC_ZCU(::pflib::lpGBT_ConfigTransport& lpgbt, bool isEC,
+                   uint8_t lpgbt_i2c_addr)
+    : lpgbt_{lpgbt},
+      offset_{isEC ? (OFFSET_EC) : (OFFSET_IC)},
+      offset_status_{isEC ? (OFFSET_EC - 1) : (OFFSET_IC)},
+      lpgbt_i2c_addr_{lpgbt_i2c_addr},
+      tx_data_{0},
+      reply_delay_{0},
+      reply_wait_{0},
+      n_frames_{0},
+      n_accesses_{0} {}
+
+uint32_t ICEC_ZCU::read(size_t i) {
+  n_accesses_++;
+  if (i != size_t(offset_status_ + REG_STATUS_READ)) return 0;
+  uint32_t val = 0;
+  if (tx_fifo_.empty()) val |= MASK_TX_EMPTY;
+  if (reply_wait_ > 0) {
+    reply_wait_--;
+    val |= MASK_RX_EMPTY;
+  } else if (rx_fifo_.empty()) {
+    val |= MASK_RX_EMPTY;
+  } else {
+    val |= rx_fifo_.front();
+  }
+  return val;
+}
+
+void ICEC_ZCU::write(size_t where, uint32_t what) {
+  n_accesses_++;
+  if (where == size_t(offset_ + REG_ADDR_TX_DATA)) {
+    tx_data_ = what;
+    return;
+  }
+  if (where != size_t(offset_ + REG_CTL_RESET_N_READ)) return;
+
+  if (what & MASK_RESET_RX) rx_fifo_.clear();
+  if (what & MASK_RESET_TX) tx_fifo_.clear();
+  if (what & MASK_TX_FIFO_LOAD) tx_fifo_.push_back(tx_data_);
+  if ((what & MASK_RX_FIFO_ADV) and not rx_fifo_.empty()) rx_fifo_.pop_front();
+  if (what & MASK_START_WRITE) {
+    n_frames_++;
+    if (not tx_fifo_.empty()) {
+      uint8_t i2c_addr = (tx_fifo_.front() >> 8) & 0xFF;
+      uint16_t reg = tx_fifo_.front() >> 16;
+      std::vector<uint8_t> values;
+      for (uint32_t word : tx_fifo_) values.push_back(word & 0xFF);
+      if (i2c_addr == lpgbt_i2c_addr_) lpgbt_.write_regs(reg, values);
+    }
+    tx_fifo_.clear();
+  }
+  if (what & MASK_START_READ) {
+    n_frames_++;
+    uint8_t i2c_addr = (tx_data_ >> 8) & 0xFF;
+    uint16_t reg = tx_data_ >> 16;
+    int n = what & MASK_N_READ;
+    if (i2c_addr != lpgbt_i2c_addr_) return;
+    std::vector<uint8_t> values = lpgbt_.read_regs(reg, n);
+    std::vector<uint8_t> reply = {uint8_t((i2c_addr << 1) | 1),
+                                  0,
+                                  uint8_t(n & 0xFF),
+                                  uint8_t(n >> 8),
+                                  uint8_t(reg & 0xFF),
+                                  uint8_t(reg >> 8)};
+    reply.insert(reply.end(), values.begin(), values.end());
+    uint8_t parity = 0;
+    for (uint8_t b : reply) parity ^= b;
+    reply.push_back(parity);
+    rx_fifo_.insert(rx_fifo_.end(), reply.begin(), reply.end());
+    reply_wait_ = reply_delay_;
+  }
+}
+
+}  // namespace sim
+}  // namespace pflib
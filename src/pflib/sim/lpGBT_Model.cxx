@@ -0,0 +1,151 @@
+#include "pflib/sim/lpGBT_Model.h"
+
+#include <string>
+
+namespace pflib {
+namespace sim {
+
+/// registers on the lpGBT are addressed with nine bits
+static const int ADDRESS_SPACE = 0x200;
+
+static constexpr uint16_t REG_I2CM0ADDRESS = 0x101;
+static constexpr uint16_t REG_I2CM0DATA0 = 0x102;
+static constexpr uint16_t REG_I2CM0CMD = 0x106;
+static constexpr uint16_t REG_I2CM0STATUS = 0x171;
+static constexpr uint16_t REG_I2CM0READBYTE = 0x173;
+static constexpr uint16_t REG_I2CM0READ15 = 0x183;
+static constexpr uint16_t REG_I2C_WSTRIDE = 7;
+static constexpr uint16_t REG_I2C_RSTRIDE = 21;
+
+static constexpr uint8_t CMD_I2C_WRITE_CR = 0;
+static constexpr uint8_t CMD_I2C_1BYTE_WRITE = 2;
+static constexpr uint8_t CMD_I2C_1BYTE_READ = 3;
+static constexpr uint8_t CMD_I2C_W_MULTI_4BYTE0 = 8;
+static constexpr uint8_t CMD_I2C_W_MULTI_4BYTE3 = 11;
+static constexpr uint8_t CMD_I2C_WRITE_MULTI = 0xC;
+static constexpr uint8_t CMD_I2C_READ_MULTI = 0xD;
+
+static constexpr uint8_t STATUS_NOACK = 0x40;
+static constexpr uint8_t STATUS_SUCCESS = 0x04;
+
+lpGBT_Model::lpGBT_Model()
+    : memory_(ADDRESS_SPACE, 0),
+      stretch_us_{0},
+      n_transactions_{0},
+      n_status_polls_{0} {}
+
+void lpGBT_Model::attach(int ibus, std::shared_ptr<::pflib::I2C> device) {
+  masters_.at(ibus).device = device;
+}
+
+uint8_t lpGBT_Model::read_reg(uint16_t reg) {
+  n_transactions_++;
+  for (int ibus{0}; ibus < 3; ibus++) {
+    if (reg == REG_I2CM0STATUS + ibus * REG_I2C_RSTRIDE) n_status_polls_++;
+  }
+  return get(reg);
+}
+
+void lpGBT_Model::write_reg(uint16_t reg, uint8_t value) {
+  n_transactions_++;
+  set(reg, value);
+}
+
+std::vector<uint8_t> lpGBT_Model::read_regs(uint16_t reg, int n) {
+  n_transactions_++;
+  for (int ibus{0}; ibus < 3; ibus++) {
+    uint16_t status = REG_I2CM0STATUS + ibus * REG_I2C_RSTRIDE;
+    if (status >= reg and status < reg + n) n_status_polls_++;
+  }
+  std::vector<uint8_t> retval;
+  for (int i{0}; i < n; i++) retval.push_back(get(reg + i));
+  return retval;
+}
+
+void lpGBT_Model::write_regs(uint16_t reg, const std::vector<uint8_t>& value) {
+  n_transactions_++;
+  for (size_t i{0}; i < value.size(); i++) set(reg + i, value[i]);
+}
+
+uint8_t lpGBT_Model::get(uint16_t reg) {
+  if (reg >= ADDRESS_SPACE) {
+    PFEXCEPTION_RAISE("BadRegister",
+                      "Register " + std::to_string(reg) + " does not exist");
+  }
+  for (int ibus{0}; ibus < 3; ibus++) {
+    const Master& m{masters_[ibus]};
+    if (reg == REG_I2CM0STATUS + ibus * REG_I2C_RSTRIDE) {
+      if (std::chrono::steady_clock::now() < m.done) return 0;
+      return m.status;
+    }
+  }
+  return memory_[reg];
+}
+
+void lpGBT_Model::set(uint16_t reg, uint8_t value) {
+  if (reg >= ADDRESS_SPACE) {
+    PFEXCEPTION_RAISE("BadRegister",
+                      "Register " + std::to_string(reg) + " does not exist");
+  }
+  memory_[reg] = value;
+  for (int ibus{0}; ibus < 3; ibus++) {
+    if (reg == REG_I2CM0CMD + ibus * REG_I2C_WSTRIDE) execute(ibus, value);
+  }
+}
+
+void lpGBT_Model::execute(int ibus, uint8_t cmd) {
+  Master& m{masters_[ibus]};
+  const uint16_t wbase = ibus * REG_I2C_WSTRIDE;
+  const uint16_t rbase = ibus * REG_I2C_RSTRIDE;
+  const uint8_t addr = memory_[REG_I2CM0ADDRESS + wbase] & 0x7F;
+  const uint8_t* data = &memory_[REG_I2CM0DATA0 + wbase];
+
+  if (cmd == CMD_I2C_WRITE_CR) {
+    m.ctl_reg = data[0];
+    return;
+  }
+  if (cmd >= CMD_I2C_W_MULTI_4BYTE0 and cmd <= CMD_I2C_W_MULTI_4BYTE3) {
+    int offset = 4 * (cmd - CMD_I2C_W_MULTI_4BYTE0);
+    for (int i{0}; i < 4; i++) m.buffer[offset + i] = data[i];
+    return;
+  }
+
+  int len = (m.ctl_reg >> 2) & 0x1F;
+  int nbytes{0};
+  m.status = STATUS_SUCCESS;
+  try {
+    if (not m.device) {
+      PFEXCEPTION_RAISE("I2CErrorNoACK", "Nothing attached to I2C master");
+    }
+    if (cmd == CMD_I2C_1BYTE_WRITE) {
+      m.device->write_byte(addr, data[0]);
+      nbytes = 1;
+    } else if (cmd == CMD_I2C_1BYTE_READ) {
+      memory_[REG_I2CM0READBYTE + rbase] = m.device->read_byte(addr);
+      nbytes = 1;
+    } else if (cmd == CMD_I2C_WRITE_MULTI) {
+      std::vector<uint8_t> wdata(m.buffer.begin(), m.buffer.begin() + len);
+      m.device->general_write_read(addr, wdata, 0);
+      nbytes = len;
+    } else if (cmd == CMD_I2C_READ_MULTI) {
+      std::vector<uint8_t> rdata = m.device->general_write_read(addr, {}, len);
+      // stored backwards ending at READ15
+      for (int i{0}; i < int(rdata.size()); i++) {
+        memory_[REG_I2CM0READ15 + rbase - i] = rdata[i];
+      }
+      nbytes = len;
+    } else {
+      return;
+    }
+  } catch (const ::pflib::Exception&) {
+    m.status = STATUS_NOACK;
+  }
+
+  // address byte plus data bytes, nine clocks each, start and stop
+  static const int khz[] = {100, 200, 400, 1000};
+  int us = (9 * (1 + nbytes) + 2) * 1000 / khz[m.ctl_reg & 0x3] + stretch_us_;
+  m.done = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+}
+
+}  // namespace sim
+}  // namespace pflib
@@ -0,0 +1,42 @@
+#include "pflib/utility/thread_pool.h"
+
+#include <algorithm>
+
+namespace pflib::utility {
+
+ThreadPool::ThreadPool(int n_threads) : stopping_{false} {
+  if (n_threads < 1) {
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(n_threads);
+  for (int i{0}; i < n_threads; i++) {
+    workers_.emplace_back([this]() { work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  job_available_.notify_all();
+  for (std::thread& worker : workers_) worker.join();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_available_.wait(lock,
+                          [this]() { return stopping_ or !jobs_.empty(); });
+      // finish the queue before stopping
+      if (jobs_.empty()) return;
+      job = std::move(jobs_.front());
+      jobs_.pop();
+    }
+    job();
+  }
+}
+
+}  // namespace pflib::utility
@@ -6,6 +6,7 @@
 #include "pflib/ECOND_Formatter.h"
 #include "pflib/HcalBackplane.h"
 #include "pflib/I2C_Linux.h"
+#include "pflib/packing/SingleROCEventPacket.h"
 #include "pflib/zcu/UIO.h"
 
 namespace pflib {
@@ -250,6 +251,7 @@ void HcalFiberless::setup_run(int run, DaqFormat format, int contrib_id) {
     contribid_ = contrib_id & 0xFF;
   ievt_ = 0;
   l1a_ = 0;
+  formatter_.disable_zs(format == DaqFormat::ECOND_NO_ZS);
   daq().reset();
   fc().clear_run();
 }
@@ -260,33 +262,9 @@ std::vector<uint32_t> HcalFiberless::read_event() {
     ievt_++;
     switch (daqformat_) {
       case DaqFormat::SIMPLEROC: {
-        buffer.push_back(0x11888811);
-        buffer.push_back(0xbeef2025);
-
-        buffer.push_back(0);  // come back to this
-        for (int i = 0; i < (daq().nlinks() + 1) / 2; i++)
-          buffer.push_back(0);  // come back to this
-        size_t len_total = buffer.size() - 2;
-
-        for (int i = 0; i < daq().nlinks(); i++) {
-          std::vector<uint32_t> data = daq().getLinkData(i);
-          if (i >= 2) {  // trigger links
-            uint32_t theader = 0x30000000 | ((i - 2)) | (data.size() << 8);
-            data.insert(data.begin(), theader);
-          }
-          size_t len = data.size();
-          len_total += len;
-          buffer.insert(buffer.end(), data.begin(), data.end());
-          // insert the subpacket length
-          if (i % 2)
-            buffer[2 + 1 + i / 2] |= (len << 16);
-          else
-            buffer[2 + 1 + i / 2] |= (len);
-        }
-        // record the total length
-        buffer[2] |= len_total;
-        buffer.push_back(0xd07e2025);
-        buffer.push_back(0x12345678);
+        packing::write_simpleroc(
+            daq().nlinks(), [this](int i) { return daq().getLinkData(i); },
+            buffer);
         daq().advanceLinkReadPtr();
       } break;
       case DaqFormat::ECOND_NO_ZS: {
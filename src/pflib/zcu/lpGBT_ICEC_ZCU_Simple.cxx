@@ -1,5 +1,7 @@
 #include "pflib/zcu/lpGBT_ICEC_ZCU_Simple.h"
 
+#include <algorithm>
+
 #include "pflib/Exception.h"
 
 namespace pflib {
@@ -25,108 +27,135 @@ static const uint32_t MASK_RX_DATA = 0x000000FF;
 static const uint32_t MASK_RX_EMPTY = 0x00000100;
 static const uint32_t MASK_TX_EMPTY = 0x00000200;
 
+/// status polls made without sleeping before we start to sleep between polls
+static const int SPIN_POLLS = 64;
+/// sleeping polls before we give up
+static const int TIMEOUT_POLLS = 1000;
+
+namespace {
+/// the firmware block accessed through UIO
+class UIORegisters : public lpGBT_ICEC_Simple::Registers {
+ public:
+  UIORegisters(const std::string& target) : uio_(target) {}
+  virtual uint32_t read(size_t i) { return uio_.read(i); }
+  virtual void write(size_t where, uint32_t what) { uio_.write(where, what); }
+
+ private:
+  UIO uio_;
+};
+}  // namespace
+
 lpGBT_ICEC_Simple::lpGBT_ICEC_Simple(const std::string& target, bool isEC,
                                      uint8_t lpgbt_i2c_addr)
     : offset_{isEC ? (OFFSET_EC) : (OFFSET_IC)},
       offset_status_{isEC ? (OFFSET_EC - 1) : (OFFSET_IC)},
       lpgbt_i2c_addr_{lpgbt_i2c_addr},
-      transport_(target) {
+      transport_{std::make_shared<UIORegisters>(target)} {
+  reset();
+}
+
+lpGBT_ICEC_Simple::lpGBT_ICEC_Simple(std::shared_ptr<Registers> registers,
+                                     bool isEC, uint8_t lpgbt_i2c_addr)
+    : offset_{isEC ? (OFFSET_EC) : (OFFSET_IC)},
+      offset_status_{isEC ? (OFFSET_EC - 1) : (OFFSET_IC)},
+      lpgbt_i2c_addr_{lpgbt_i2c_addr},
+      transport_{registers} {
+  reset();
+}
+
+void lpGBT_ICEC_Simple::reset() {
   int reg = REG_CTL_RESET_N_READ + offset_;
 
-  transport_.write(reg, MASK_RESET_RX | MASK_RESET_TX);
-  transport_.write(reg, 0);
+  transport_->write(reg, MASK_RESET_RX | MASK_RESET_TX);
+  transport_->write(reg, 0);
+}
+
+uint32_t lpGBT_ICEC_Simple::wait_status(uint32_t mask, bool set,
+                                        const char* what, uint16_t reg) {
+  /**
+   * An IC frame only takes a few microseconds on the link, much
+   * shorter than the smallest sleep we can ask for, so we first poll
+   * without sleeping and only sleep between polls for slow responses.
+   */
+  for (int ipoll = 0; ipoll < SPIN_POLLS + TIMEOUT_POLLS; ipoll++) {
+    uint32_t val = transport_->read(offset_status_ + REG_STATUS_READ);
+    if (bool(val & mask) == set) return val;
+    if (ipoll >= SPIN_POLLS) usleep(1);
+  }
+  char message[256];
+  snprintf(message, 256, "%s register 0x%x timeout (%x)", what, reg,
+           lpgbt_i2c_addr_);
+  PFEXCEPTION_RAISE("ICEC_Timeout", message);
 }
 
 uint8_t lpGBT_ICEC_Simple::read_reg(uint16_t reg) {
-  std::vector<uint8_t> retval = read_regs(reg, 1);
+  std::vector<uint8_t> retval;
+  read_frame(reg, 1, retval);
   return retval[0];
 }
 
 std::vector<uint8_t> lpGBT_ICEC_Simple::read_regs(uint16_t reg, int n) {
   std::vector<uint8_t> retval;
-  int wc = 0;
-
-  if (n > 8) {
-    retval = read_regs(reg, 8);
-    std::vector<uint8_t> later = read_regs(reg + 8, n - 8);
-    retval.insert(retval.end(), later.begin(), later.end());
-    return retval;
+  retval.reserve(n);
+  for (int done = 0; done < n; done += MAX_FRAME_BYTES) {
+    read_frame(reg + done, std::min(n - done, MAX_FRAME_BYTES), retval);
   }
+  return retval;
+}
+
+void lpGBT_ICEC_Simple::read_frame(uint16_t reg, int n,
+                                   std::vector<uint8_t>& retval) {
+  size_t start = retval.size();
+  int wc = 0;
 
   uint32_t val;
   // set addresses
   val = (uint32_t(reg) << 16) | (uint32_t(lpgbt_i2c_addr_) << 8);
-  transport_.write(offset_ + REG_ADDR_TX_DATA, val);
+  transport_->write(offset_ + REG_ADDR_TX_DATA, val);
   // set length and start
   val = n | MASK_START_READ;
-  transport_.write(offset_ + REG_CTL_RESET_N_READ, val);
+  transport_->write(offset_ + REG_CTL_RESET_N_READ, val);
   // wait for done...
-  int timeout = 1000;
-  for (val = transport_.read(offset_status_ + REG_STATUS_READ);
-       (val & MASK_RX_EMPTY);
-       val = transport_.read(offset_status_ + REG_STATUS_READ)) {
-    usleep(1);
-    timeout--;
-    if (timeout == 0) {
-      char message[256];
-      snprintf(message, 256, "Read register 0x%x timeout", reg);
-      PFEXCEPTION_RAISE("ICEC_Timeout", message);
-    }
-  }
-  wc = 0;
+  val = wait_status(MASK_RX_EMPTY, false, "Read", reg);
   while (!(val & MASK_RX_EMPTY)) {
     uint8_t abyte = uint8_t(val & MASK_RX_DATA);
-    transport_.write(offset_ + REG_CTL_RESET_N_READ, MASK_RX_FIFO_ADV);
-    // printf("%d %02x\n",wc,abyte);
-    if (wc >= 6 && int(retval.size()) < n) retval.push_back(abyte);
+    transport_->write(offset_ + REG_CTL_RESET_N_READ, MASK_RX_FIFO_ADV);
+    // the reply starts with six bytes of header
+    if (wc >= 6 && int(retval.size() - start) < n) retval.push_back(abyte);
     wc++;
     // this seems to be sometimes too fast...
-    transport_.read(offset_status_ + REG_STATUS_READ);
-    val = transport_.read(offset_status_ + REG_STATUS_READ);
+    transport_->read(offset_status_ + REG_STATUS_READ);
+    val = transport_->read(offset_status_ + REG_STATUS_READ);
+  }
+  if (int(retval.size() - start) != n) {
+    char message[256];
+    snprintf(message, 256, "Read register 0x%x returned %d of %d bytes", reg,
+             int(retval.size() - start), n);
+    PFEXCEPTION_RAISE("ICEC_ShortRead", message);
   }
-
-  return retval;
 }
 
 void lpGBT_ICEC_Simple::write_reg(uint16_t reg, uint8_t value) {
   std::vector<uint8_t> vv(1, value);
-  //  printf("%x %x %x\n",reg, value, lpgbt_i2c_addr_);
   write_regs(reg, vv);
 }
 
 void lpGBT_ICEC_Simple::write_regs(uint16_t reg,
                                    const std::vector<uint8_t>& value) {
   size_t wc = 0;
-
-  uint32_t baseval;
-  // set addresses
-  baseval = (uint32_t(reg) << 16) | (uint32_t(lpgbt_i2c_addr_) << 8);
-
-  int ic = 0;
   while (wc < value.size()) {
-    transport_.write(offset_ + REG_ADDR_TX_DATA, baseval | uint32_t(value[wc]));
-    wc++;
-    ic++;
-    transport_.write(offset_ + REG_CTL_RESET_N_READ, MASK_TX_FIFO_LOAD);
-    if (ic == 8 || wc == value.size()) {
-      transport_.write(offset_ + REG_CTL_RESET_N_READ, MASK_START_WRITE);
-      // wait for tx to be done
-      int timeout = 1000;
-      for (uint32_t val = transport_.read(offset_status_ + REG_STATUS_READ);
-           !(val & MASK_TX_EMPTY);
-           val = transport_.read(offset_status_ + REG_STATUS_READ)) {
-        //	printf("%02x\n",val);
-        usleep(1);
-        timeout--;
-        if (timeout == 0) {
-          char message[256];
-          snprintf(message, 256, "Write register 0x%x (+%d) timeout (%x)", reg,
-                   ic, lpgbt_i2c_addr_);
-          PFEXCEPTION_RAISE("ICEC_Timeout", message);
-        }
-      }
-      ic = 0;
+    // each frame starts at its own register address
+    uint32_t baseval =
+        (uint32_t(reg + wc) << 16) | (uint32_t(lpgbt_i2c_addr_) << 8);
+    size_t end = std::min(value.size(), wc + MAX_FRAME_BYTES);
+    for (; wc < end; wc++) {
+      transport_->write(offset_ + REG_ADDR_TX_DATA,
+                        baseval | uint32_t(value[wc]));
+      transport_->write(offset_ + REG_CTL_RESET_N_READ, MASK_TX_FIFO_LOAD);
     }
+    transport_->write(offset_ + REG_CTL_RESET_N_READ, MASK_START_WRITE);
+    // wait for tx to be done
+    wait_status(MASK_TX_EMPTY, true, "Write", reg);
   }
 }
 
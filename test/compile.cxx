@@ -6,6 +6,7 @@
 #include <iomanip>
 
 #include "pflib/Exception.h"
+#include "register_maps/register_maps.h"
 
 BOOST_AUTO_TEST_SUITE(compile)
 
@@ -14,6 +15,27 @@ BOOST_AUTO_TEST_CASE(get_by_name) {
   BOOST_CHECK_NO_THROW(pflib::Compiler::get("sipm_rocv3"));
 }
 
+BOOST_AUTO_TEST_CASE(name_tables) {
+  for (const auto& [type, get_map] : pflib::register_maps::get()) {
+    const RegisterMap& rm{get_map()};
+    pflib::Compiler c = pflib::Compiler::get(type);
+    int i_page{0};
+    for (const auto& [page_name, page] : rm.parameter_lut) {
+      if (rm.page_names) {
+        BOOST_CHECK_EQUAL(rm.page_names->find(page_name), i_page);
+      }
+      BOOST_CHECK_EQUAL(c.page_index(page_name), i_page);
+      for (const auto& [param_name, param] : page.second) {
+        BOOST_CHECK(c.find_parameter(i_page, param_name) == &param);
+      }
+      BOOST_CHECK(c.find_parameter(i_page, "NOT_A_PARAMETER") == nullptr);
+      i_page++;
+    }
+    BOOST_CHECK_EQUAL(c.page_index("NOT_A_PAGE"), -1);
+    BOOST_CHECK_EQUAL(c.page_index(""), -1);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(single_register_rocv3) {
   pflib::Compiler c = pflib::Compiler::get("sipm_rocv3");
   std::map<int, std::map<int, uint8_t>> registers, expected;
@@ -58,6 +80,82 @@ BOOST_AUTO_TEST_CASE(one_param_multi_registers) {
       pflib::Exception);
 }
 
+BOOST_AUTO_TEST_CASE(parameter_handle) {
+  pflib::Compiler c = pflib::Compiler::get("sipm_rocv3");
+  pflib::ParameterHandle bx_trigger = c.resolve("digitalhalf_0", "bx_trigger");
+  BOOST_CHECK_EQUAL(bx_trigger.page(), 89);
+  BOOST_CHECK_EQUAL(bx_trigger.nbits(), 12);
+
+  std::map<int, std::map<int, uint8_t>> registers, expected;
+  c.compile("DIGITALHALF_0", "BX_OFFSET", 0b110111001100, expected);
+  registers = expected;
+  c.compile("DIGITALHALF_0", "BX_TRIGGER", 0b101100110011, expected);
+  bx_trigger.encode(0b101100110011, registers);
+  BOOST_CHECK(registers == expected);
+
+  pflib::RegisterImage image(registers);
+  BOOST_CHECK_EQUAL(bx_trigger.decode(image), 0b101100110011);
+  bx_trigger.encode(7, image);
+  BOOST_CHECK_EQUAL(bx_trigger.decode(image), 7);
+  BOOST_CHECK_EQUAL(c.resolve("DIGITALHALF_0", "BX_OFFSET").decode(image),
+                    0b110111001100);
+
+  BOOST_CHECK_THROW(bx_trigger.encode(1 << 12, image), pflib::Exception);
+  BOOST_CHECK_THROW(c.resolve("DIGITALHALF_0", "NOT_A_PARAM"),
+                    pflib::Exception);
+  BOOST_CHECK_THROW(c.resolve("NOT_A_PAGE", "BX_TRIGGER"), pflib::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(partial_decompile) {
+  pflib::Compiler c = pflib::Compiler::get("sipm_rocv3");
+  // full image gives the same parameters as the careful full loop
+  auto image = c.compile_image(c.defaults());
+  BOOST_CHECK(c.decompile_partial(image) == c.decompile(image, true));
+
+  // a single register only brings the parameters using it
+  auto trim_inv = c.resolve("CH_17", "TRIM_INV");
+  pflib::RegisterImage one;
+  trim_inv.encode(42, one);
+  auto params = c.decompile_partial(one);
+  BOOST_REQUIRE_EQUAL(params.size(), 1);
+  BOOST_CHECK_EQUAL(params["CH_17"]["TRIM_INV"], 42);
+  for (const auto& [name, val] : params["CH_17"]) {
+    auto handle = c.resolve("CH_17", name);
+    BOOST_CHECK_EQUAL(handle.decode(one), val);
+  }
+  BOOST_CHECK(c.decompile(one, false) == params);
+  BOOST_CHECK(c.decompile_partial(pflib::RegisterImage()).empty());
+}
+
+BOOST_AUTO_TEST_CASE(parameter_diff) {
+  pflib::Compiler c = pflib::Compiler::get("sipm_rocv3");
+  auto a = c.compile_image(c.defaults());
+  BOOST_CHECK(c.diff(a, a).empty());
+
+  auto b = a;
+  c.resolve("CH_17", "TRIM_INV").encode(42, b);
+  c.resolve("CH_3", "DACB").encode(5, b);
+  auto diffs = c.diff(a, b);
+  BOOST_REQUIRE_EQUAL(diffs.size(), 2);
+  BOOST_CHECK_EQUAL(diffs[0].page, "CH_17");
+  BOOST_CHECK_EQUAL(diffs[0].param, "TRIM_INV");
+  BOOST_CHECK_EQUAL(diffs[0].b, 42);
+  BOOST_CHECK_EQUAL(diffs[1].page, "CH_3");
+  BOOST_CHECK_EQUAL(diffs[1].param, "DACB");
+  BOOST_CHECK_EQUAL(diffs[1].a, c.defaults()["CH_3"]["DACB"]);
+  BOOST_CHECK_EQUAL(diffs[1].b, 5);
+
+  // parameters missing from one side are reported as such
+  pflib::RegisterImage only;
+  c.resolve("CH_3", "DACB").encode(5, only);
+  diffs = c.diff(pflib::RegisterImage(), only);
+  BOOST_REQUIRE(not diffs.empty());
+  for (const auto& d : diffs) {
+    BOOST_CHECK(not d.in_a);
+    BOOST_CHECK(d.in_b);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(big_32bit_params) {
   /**
    * There are a few parameters that are a full 32 bits
@@ -126,6 +224,20 @@ BOOST_AUTO_TEST_CASE(glob_pages) {
                       "broadcast single parameter to all channel pages");
 }
 
+BOOST_AUTO_TEST_CASE(match_pages) {
+  pflib::Compiler c = pflib::Compiler::get("sipm_rocv3");
+  BOOST_CHECK_EQUAL(c.match_pages("Ch_*").size(), 72);
+  BOOST_CHECK_EQUAL(c.match_pages("CH_1*").size(), 11);
+  auto exact = c.match_pages("ch_45");
+  BOOST_REQUIRE_EQUAL(exact.size(), 1);
+  BOOST_CHECK_EQUAL(c.page_entry(exact[0]).first, "CH_45");
+  BOOST_CHECK(c.match_pages("CH_").empty());
+  BOOST_CHECK(c.match_pages("NOT_A_PAGE*").empty());
+  // positions are returned in order
+  auto all = c.match_pages("*");
+  for (std::size_t i{0}; i < all.size(); i++) BOOST_CHECK_EQUAL(all[i], i);
+}
+
 BOOST_AUTO_TEST_CASE(single_register_econd) {
   pflib::Compiler c = pflib::Compiler::get("econd");
   // Note: this map is going to return a vector where the lowest address
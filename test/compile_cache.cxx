@@ -0,0 +1,211 @@
+#define BOOST_TEST_DYN_LINK
+#include "pflib/CompileCache.h"
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include "helpers.h"
+#include "pflib/Compile.h"
+#include "pflib/CompileBatch.h"
+#include "pflib/Exception.h"
+
+/**
+ * a cache in a fresh temporary directory that is used by the compiler
+ * while it exists
+ */
+struct TempCache {
+  std::filesystem::path dir_;
+  TempCache(std::string_view name, std::uintmax_t max_bytes =
+                                       pflib::CompileCache::DEFAULT_MAX_BYTES) {
+    dir_ = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir_);
+    pflib::CompileCache::enable(dir_.string(), max_bytes);
+  }
+  ~TempCache() {
+    pflib::CompileCache::disable();
+    std::filesystem::remove_all(dir_);
+  }
+  std::size_t n_entries() const {
+    return std::distance(std::filesystem::directory_iterator(dir_),
+                         std::filesystem::directory_iterator());
+  }
+};
+
+BOOST_AUTO_TEST_SUITE(compile_cache)
+
+BOOST_AUTO_TEST_CASE(hit_after_compile) {
+  TempCache cache("pflib-test-compile-cache-hit");
+  TempFile config("pflib-test-compile-cache-hit.yaml",
+                  "ch_45:\n  sel_trig_toa: 1\n");
+  auto c = pflib::Compiler::get("sipm_rocv3");
+  auto first = c.compile_image({config.file_path_}, true);
+  BOOST_CHECK_EQUAL(pflib::CompileCache::global()->misses(), 1);
+  BOOST_CHECK_EQUAL(cache.n_entries(), 1);
+
+  auto second = c.compile_image({config.file_path_}, true);
+  BOOST_CHECK_EQUAL(pflib::CompileCache::global()->hits(), 1);
+  BOOST_CHECK(first == second);
+
+  // cached image is the same as compiling without a cache
+  pflib::CompileCache::disable();
+  BOOST_CHECK(c.compile_image({config.file_path_}, true) == first);
+}
+
+BOOST_AUTO_TEST_CASE(key_changes) {
+  std::vector<std::string> contents{"a: 1\n"};
+  uint64_t key = pflib::CompileCache::key("sipm_rocv3", 1, true, contents);
+  BOOST_CHECK_EQUAL(key,
+                    pflib::CompileCache::key("sipm_rocv3", 1, true, contents));
+  BOOST_CHECK_NE(key, pflib::CompileCache::key("si_rocv3b", 1, true, contents));
+  BOOST_CHECK_NE(key,
+                 pflib::CompileCache::key("sipm_rocv3", 2, true, contents));
+  BOOST_CHECK_NE(key,
+                 pflib::CompileCache::key("sipm_rocv3", 1, false, contents));
+  BOOST_CHECK_NE(key, pflib::CompileCache::key("sipm_rocv3", 1, true,
+                                               {"a: 2\n"}));
+  BOOST_CHECK_NE(pflib::CompileCache::key("t", 1, true, {"ab", "c"}),
+                 pflib::CompileCache::key("t", 1, true, {"a", "bc"}));
+
+  auto rocv3 = pflib::Compiler::get("sipm_rocv3");
+  BOOST_CHECK_EQUAL(rocv3.register_map_version(),
+                    pflib::Compiler::get("sipm_rocv3").register_map_version());
+  BOOST_CHECK_NE(rocv3.register_map_version(),
+                 pflib::Compiler::get("sipm_rocv2").register_map_version());
+}
+
+BOOST_AUTO_TEST_CASE(changed_file_recompiles) {
+  TempCache cache("pflib-test-compile-cache-change");
+  auto c = pflib::Compiler::get("sipm_rocv3");
+  pflib::RegisterImage one, two;
+  {
+    TempFile config("pflib-test-compile-cache-change.yaml",
+                    "ch_45:\n  sel_trig_toa: 1\n");
+    one = c.compile_image({config.file_path_}, false);
+  }
+  {
+    TempFile config("pflib-test-compile-cache-change.yaml",
+                    "ch_45:\n  sel_trig_toa: 0\n");
+    two = c.compile_image({config.file_path_}, false);
+  }
+  BOOST_CHECK_EQUAL(pflib::CompileCache::global()->hits(), 0);
+  BOOST_CHECK(not(one == two));
+  BOOST_CHECK_EQUAL(cache.n_entries(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_entry) {
+  TempCache cache("pflib-test-compile-cache-corrupt");
+  pflib::CompileCache* cc = pflib::CompileCache::global();
+  const std::map<int, int> pages{{1, 32}};
+  pflib::RegisterImage image;
+  image.set(1, 2, 3);
+  cc->store(42, image);
+  pflib::RegisterImage loaded;
+  BOOST_CHECK(cc->load(42, pages, loaded));
+  BOOST_CHECK(loaded == image);
+
+  // truncate the entry
+  auto entry = std::filesystem::directory_iterator(cache.dir_)->path();
+  std::filesystem::resize_file(entry, 10);
+  BOOST_CHECK(not cc->load(42, pages, loaded));
+  BOOST_CHECK_EQUAL(cache.n_entries(), 0);
+
+  // change a register value, the checksum no longer matches
+  cc->store(42, image);
+  {
+    std::fstream f{entry, std::ios::in | std::ios::out | std::ios::binary};
+    f.seekp(-1, std::ios::end);
+    f.put(4);
+  }
+  BOOST_CHECK(not cc->load(42, pages, loaded));
+  BOOST_CHECK_EQUAL(cache.n_entries(), 0);
+
+  // registers outside of the register map
+  cc->store(42, image);
+  BOOST_CHECK(not cc->load(42, {{1, 2}}, loaded));
+  cc->store(42, image);
+  BOOST_CHECK(not cc->load(42, {{0, 32}}, loaded));
+  BOOST_CHECK_EQUAL(cache.n_entries(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(eviction) {
+  pflib::RegisterImage image;
+  for (int reg{0}; reg < 100; reg++) image.set(0, reg, reg);
+  // room for about two entries
+  TempCache cache("pflib-test-compile-cache-evict", 300);
+  pflib::CompileCache* cc = pflib::CompileCache::global();
+  for (uint64_t key{0}; key < 5; key++) {
+    cc->store(key, image);
+    BOOST_CHECK_LE(cc->disk_usage(), 300);
+  }
+  BOOST_CHECK_EQUAL(cache.n_entries(), 2);
+  pflib::RegisterImage loaded;
+  BOOST_CHECK(cc->load(4, {{0, 100}}, loaded));
+  BOOST_CHECK(not cc->load(0, {{0, 100}}, loaded));
+
+  cc->clear();
+  BOOST_CHECK_EQUAL(cache.n_entries(), 0);
+
+  // temporary files from writers that died are removed once they are old
+  auto tmp = [&](const std::string& name, std::chrono::minutes age) {
+    auto path = cache.dir_ / name;
+    std::ofstream{path} << "partial";
+    std::filesystem::last_write_time(
+        path, std::filesystem::file_time_type::clock::now() - age);
+    return path;
+  };
+  auto old_tmp = tmp("0000000000000001.pfcc.tmp.1.2", std::chrono::hours(1));
+  auto new_tmp = tmp("0000000000000002.pfcc.tmp.1.2", std::chrono::minutes(0));
+  cc->store(0, image);
+  BOOST_CHECK(not std::filesystem::exists(old_tmp));
+  BOOST_CHECK(std::filesystem::exists(new_tmp));
+}
+
+BOOST_AUTO_TEST_CASE(batch_through_cache) {
+  TempCache cache("pflib-test-compile-cache-batch");
+  TempFile config("pflib-test-compile-cache-batch.yaml",
+                  "ch_45:\n  sel_trig_toa: 1\n");
+  TempFile manifest("pflib-test-compile-cache-batch-manifest.yaml",
+                    "- inputs: pflib-test-compile-cache-batch.yaml\n"
+                    "  output: pflib-test-compile-cache-batch-0.csv\n"
+                    "- chip: sipm_rocv3\n"
+                    "  inputs: [pflib-test-compile-cache-batch.yaml]\n"
+                    "  output: pflib-test-compile-cache-batch-1.csv\n"
+                    "  defaults: false\n");
+  auto jobs = pflib::batch::read_manifest(manifest.file_path_, "sipm_rocv3",
+                                          "defaults", true);
+  BOOST_REQUIRE_EQUAL(jobs.size(), 2);
+  BOOST_CHECK_EQUAL(jobs[0].inputs.front(), config.file_path_);
+  BOOST_CHECK(jobs[0].flag);
+  BOOST_CHECK(not jobs[1].flag);
+  BOOST_CHECK_THROW(pflib::batch::read_manifest(manifest.file_path_,
+                                                "sipm_rocv3", "careful", true,
+                                                true),
+                    pflib::Exception);
+
+  // same job twice, the second one is loaded from the cache
+  jobs[1] = jobs[0];
+  std::vector<pflib::RegisterImage> images(2);
+  auto compile = [&](const pflib::batch::Job& job, pflib::Compiler& c,
+                     std::ostream&) {
+    images[&job - jobs.data()] = c.compile_image(job.inputs, job.flag);
+  };
+  BOOST_CHECK_EQUAL(pflib::batch::run_batch(jobs, 1, "compiled", compile),
+                    0);
+  BOOST_CHECK_EQUAL(pflib::CompileCache::global()->hits(), 1);
+  BOOST_CHECK(images[0] == images[1]);
+  std::filesystem::remove(jobs[0].output);
+
+  // failing jobs are counted
+  jobs[1].chip = "not_a_chip";
+  BOOST_CHECK_THROW(pflib::batch::run_batch(jobs, 1, "compiled", compile),
+                    pflib::Exception);
+  jobs[1] = jobs[0];
+  jobs[1].inputs = {"/no/such/file.yaml"};
+  BOOST_CHECK_EQUAL(pflib::batch::run_batch(jobs, 1, "compiled", compile),
+                    1);
+  std::filesystem::remove(jobs[0].output);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
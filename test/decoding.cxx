@@ -556,6 +556,116 @@ BOOST_AUTO_TEST_CASE(roundtrip_with_formatter) {
   }
 }
 
+/// DAQ link frame with CM0=CM1=cm and the input channel words (calib empty)
+static std::vector<uint32_t> daq_link_frame(
+    int cm, const std::map<int, uint32_t>& channels) {
+  std::vector<uint32_t> frame(40, 0);
+  frame[0] = 0xf00c26a5;
+  frame[1] = (cm << 10) | cm;
+  for (const auto& [i_ch, word] : channels) {
+    frame[2 + i_ch + (i_ch < 18 ? 0 : 1)] = word;
+  }
+  return frame;
+}
+
+/// channel word with Tc=Tp=0
+static uint32_t adc_word(uint32_t adc_tm1, uint32_t adc, uint32_t toa) {
+  return (adc_tm1 << 20) | (adc << 10) | toa;
+}
+
+BOOST_AUTO_TEST_CASE(formatter_zero_suppression) {
+  pflib::ECOND_Formatter formatter;
+  pflib::ECOND_Formatter::ChannelZS zs;
+  zs.lambda = 50;
+  zs.beta = 50;
+  formatter.set_zs(zs);
+  zs.mask = true;
+  formatter.set_zs(0, 5, zs);
+  zs.mask = false;
+  zs.kappa = 64;
+  formatter.set_zs(0, 7, zs);
+
+  formatter.startEvent(100, 3, 1);
+  formatter.add_elink_packet(
+      0, daq_link_frame(100, {{0, adc_word(100, 100, 0)},
+                              {1, adc_word(10, 100, 0)},
+                              {2, adc_word(10, 100, 5)},
+                              {3, adc_word(100, 100, 5)},
+                              {4, adc_word(100, 10, 5)},
+                              {5, adc_word(100, 10, 5)},
+                              {6, (0b11u << 30) | adc_word(7, 300, 9)},
+                              {7, adc_word(100, 120, 0)},
+                              {20, adc_word(100, 100, 0)}}));
+  // nothing passes on the second eRx
+  formatter.add_elink_packet(1, daq_link_frame(100, {}));
+  formatter.finishEvent();
+  auto packet{formatter.getPacket()};
+
+  pflib::packing::ECONDEventPacket ep{2};
+  ep.from(std::span(packet));
+  for (bool bad : ep.corruption) BOOST_CHECK(not bad);
+  const auto& link{ep.links[0]};
+  // code 0000, TOA suppressed
+  BOOST_CHECK_EQUAL(link.channels[0].adc_tm1(), 100);
+  BOOST_CHECK_EQUAL(link.channels[0].adc(), 100);
+  // code 0001, ADC(-1) and TOA suppressed
+  BOOST_CHECK_EQUAL(link.channels[1].adc(), 100);
+  BOOST_CHECK_EQUAL(link.channels[1].toa(), 0);
+  // code 0011, ADC(-1) suppressed
+  BOOST_CHECK_EQUAL(link.channels[2].adc(), 100);
+  BOOST_CHECK_EQUAL(link.channels[2].toa(), 5);
+  // code 01, everything
+  BOOST_CHECK_EQUAL(link.channels[3].adc_tm1(), 100);
+  BOOST_CHECK_EQUAL(link.channels[3].toa(), 5);
+  // below threshold unless masked
+  BOOST_CHECK_EQUAL(link.channels[4].word, 0);
+  BOOST_CHECK_EQUAL(link.channels[5].adc(), 10);
+  // TOT always passes
+  BOOST_CHECK_EQUAL(link.channels[6].tot(), 300);
+  // common mode raises the threshold
+  BOOST_CHECK_EQUAL(link.channels[7].word, 0);
+  BOOST_CHECK_EQUAL(link.channels[20].adc(), 100);
+  // the calib channel is TOT busy in none of these frames
+  BOOST_CHECK_EQUAL(link.calib.word, 0);
+  for (const auto& ch : ep.links[1].channels) BOOST_CHECK_EQUAL(ch.word, 0);
+  // header, eRx header, 3x24 + 16 + 3x32 bits, empty eRx, CRC
+  BOOST_CHECK_EQUAL(packet.size(), 2 + 2 + 6 + 1 + 1);
+}
+
+BOOST_AUTO_TEST_CASE(formatter_buffer_model) {
+  pflib::ECOND_Formatter formatter;
+  formatter.disable_zs();
+  // one eTx, room for two full single-eRx events
+  formatter.setup_buffer(1, 90);
+  auto frame = gen_test_daq_link_frame();
+  const uint32_t* storage{nullptr};
+  for (int i_event{0}; i_event < 3; i_event++) {
+    formatter.startEvent(i_event, i_event, 0);
+    formatter.add_elink_packet(0, frame);
+    formatter.finishEvent();
+    if (storage == nullptr) storage = formatter.getPacket().data();
+    // the packet is built in the same memory every event
+    BOOST_CHECK(formatter.getPacket().data() == storage);
+  }
+  const auto& stats{formatter.buffer_stats()};
+  BOOST_CHECK_EQUAL(stats.n_events, 3);
+  BOOST_CHECK_EQUAL(stats.n_truncated, 1);
+  BOOST_CHECK_EQUAL(stats.occupancy, 2 * 42 + 3);
+
+  // the truncated event is only its header and CRC
+  auto packet{formatter.getPacket()};
+  BOOST_REQUIRE_EQUAL(packet.size(), 3);
+  pflib::packing::ECONDEventPacket ep{1};
+  ep.from(std::span(packet));
+  for (bool bad : ep.corruption) BOOST_CHECK(not bad);
+
+  formatter.advance(100);
+  BOOST_CHECK_EQUAL(stats.occupancy, 0);
+  BOOST_CHECK_EQUAL(stats.words_out, 2 * 42 + 3);
+  BOOST_CHECK_CLOSE(formatter.link_utilization(), 0.87, 1e-6);
+  BOOST_CHECK_CLOSE(stats.truncation_rate(), 1. / 3, 1e-6);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
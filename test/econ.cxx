@@ -0,0 +1,131 @@
+#define BOOST_TEST_DYN_LINK
+#include "pflib/ECON.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(econ)
+
+static const uint8_t ECON_BASE = 0x64;
+
+/**
+ * ECON register space behind an I2C bus
+ *
+ * The first two bytes written set the 16-bit register pointer (MSB first)
+ * which auto-increments with each byte written or read afterwards.
+ */
+class ECON_I2C : public pflib::I2C {
+ public:
+  ECON_I2C(int max_transfer_bytes)
+      : memory_(1 << 16, 0), max_transfer_bytes_{max_transfer_bytes} {
+    for (size_t i{0}; i < memory_.size(); i++) memory_[i] = (i * 7) & 0xFF;
+  }
+  virtual void set_bus_speed(int) {}
+  virtual int get_bus_speed() { return 100; }
+  virtual void write_byte(uint8_t, uint8_t) {}
+  virtual uint8_t read_byte(uint8_t) { return 0; }
+  virtual std::vector<uint8_t> general_write_read(
+      uint8_t addr, const std::vector<uint8_t>& wdata, int nread) {
+    if (addr != ECON_BASE) {
+      PFEXCEPTION_RAISE("I2CErrorNoACK", "Wrong device address");
+    }
+    if (int(wdata.size()) > max_transfer_bytes_ or
+        nread > max_transfer_bytes_) {
+      PFEXCEPTION_RAISE("I2CTooLong", "Transfer too long");
+    }
+    transactions++;
+    if (wdata.size() >= 2) pointer_ = (wdata[0] << 8) | wdata[1];
+    for (size_t i{2}; i < wdata.size(); i++) {
+      writes++;
+      memory_[pointer_++ & 0xFFFF] = wdata[i] & write_mask;
+    }
+    std::vector<uint8_t> retval;
+    for (int i{0}; i < nread; i++) {
+      retval.push_back(memory_[pointer_++ & 0xFFFF]);
+    }
+    return retval;
+  }
+  virtual int max_transfer_bytes() const { return max_transfer_bytes_; }
+
+  uint8_t peek(int reg) const { return memory_.at(reg); }
+
+  int transactions{0};
+  int writes{0};
+  uint8_t write_mask{0xFF};
+
+ private:
+  std::vector<uint8_t> memory_;
+  int max_transfer_bytes_;
+  int pointer_{0};
+};
+
+BOOST_AUTO_TEST_CASE(coalesced_read) {
+  auto bus = std::make_shared<ECON_I2C>(1024);
+  pflib::ECON econ(bus, ECON_BASE, "econd");
+
+  auto regs = econ.getRegisters({});
+  int n_per_entry = bus->transactions;
+  BOOST_REQUIRE(not regs[0].empty());
+  for (const auto& [reg, val] : regs[0]) {
+    BOOST_CHECK_EQUAL(int(val), int(bus->peek(reg)));
+  }
+  // far fewer transfers than there are registers
+  BOOST_CHECK_LT(n_per_entry * 10, int(regs[0].size()));
+
+  // a smaller burst needs more transfers but reads the same values
+  bus->transactions = 0;
+  econ.setMaxBurst(8);
+  auto regs8 = econ.getRegisters({});
+  BOOST_CHECK(regs8 == regs);
+  BOOST_CHECK_GT(bus->transactions, n_per_entry);
+}
+
+BOOST_AUTO_TEST_CASE(selected_read) {
+  auto bus = std::make_shared<ECON_I2C>(16);
+  pflib::ECON econ(bus, ECON_BASE, "econd");
+
+  auto all = econ.getRegisters({});
+  auto it = all[0].begin();
+  std::map<int, std::map<int, uint8_t>> selected;
+  selected[0][it->first] = 0;
+  bus->transactions = 0;
+  auto one = econ.getRegisters(selected);
+  BOOST_CHECK_EQUAL(one[0].count(it->first), 1);
+  BOOST_CHECK_EQUAL(bus->transactions, 1);
+}
+
+BOOST_AUTO_TEST_CASE(verify_policy) {
+  auto bus = std::make_shared<ECON_I2C>(16);
+  pflib::ECON econ(bus, ECON_BASE, "econd");
+  std::vector<uint8_t> values(20, 0x5a);
+
+  // 14 data bytes fit next to the address in a 16-byte transfer
+  econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Never);
+  econ.setValues(0x100, values);
+  BOOST_CHECK_EQUAL(bus->transactions, 2);
+  BOOST_CHECK_EQUAL(bus->writes, 20);
+  for (int i{0}; i < 20; i++) BOOST_CHECK_EQUAL(bus->peek(0x100 + i), 0x5a);
+
+  bus->transactions = 0;
+  econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Always);
+  econ.setValues(0x100, values);
+  BOOST_CHECK_EQUAL(bus->transactions, 4);
+  BOOST_CHECK_EQUAL(econ.verifyMismatches(), 0);
+
+  bus->transactions = 0;
+  econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Sampled, 4);
+  for (int i{0}; i < 8; i++) econ.setValues(0x200, {0x1});
+  // eight writes and two readbacks
+  BOOST_CHECK_EQUAL(bus->transactions, 10);
+
+  bus->write_mask = 0x0f;
+  econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Always);
+  econ.setValues(0x300, {0xff, 0x0f});
+  BOOST_CHECK_EQUAL(econ.verifyMismatches(), 1);
+
+  BOOST_CHECK_THROW(
+      econ.setVerifyPolicy(pflib::ECON::VerifyPolicy::Sampled, 0),
+      pflib::Exception);
+  BOOST_CHECK_THROW(econ.setMaxBurst(0), pflib::Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
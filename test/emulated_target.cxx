@@ -0,0 +1,219 @@
+#define BOOST_TEST_DYN_LINK
+#include "pflib/sim/EmulatedTarget.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "pflib/Compile.h"
+#include "pflib/packing/MultiSampleECONDEventPacket.h"
+#include "pflib/packing/SingleROCEventPacket.h"
+
+BOOST_AUTO_TEST_SUITE(emulated_target)
+
+/// decode a SIMPLEROC event, skipping the two header words
+static pflib::packing::SingleROCEventPacket decode(
+    std::vector<uint32_t> event) {
+  BOOST_REQUIRE_GT(event.size(), 4);
+  BOOST_CHECK_EQUAL(event[0], 0x11888811);
+  BOOST_CHECK_EQUAL(event[event.size() - 1], 0x12345678);
+  pflib::packing::SingleROCEventPacket ep;
+  ep.from(std::span(event.begin() + 2, event.end() - 2));
+  return ep;
+}
+
+/// mean ADC of the channels in one event
+static double mean_adc(const pflib::packing::SingleROCEventPacket& ep) {
+  double sum{0.};
+  for (int ch{0}; ch < 72; ch++) sum += ep.channel(ch).adc();
+  return sum / 72;
+}
+
+BOOST_AUTO_TEST_CASE(pedestal_events) {
+  pflib::sim::EmulatedTarget tgt(1, "sipm_rocv3b", 42);
+  tgt.setup_run(1, pflib::Target::DaqFormat::SIMPLEROC);
+  BOOST_CHECK(not tgt.has_event());
+  tgt.fc().sendL1A();
+  BOOST_REQUIRE(tgt.has_event());
+  auto ep = decode(tgt.read_event());
+  BOOST_CHECK(not tgt.has_event());
+  for (const auto& link : ep.daq_links) {
+    for (bool bad : link.corruption) BOOST_CHECK(not bad);
+  }
+  double mean = mean_adc(ep);
+  BOOST_CHECK_GT(mean, 50);
+  BOOST_CHECK_LT(mean, 150);
+  BOOST_CHECK_EQUAL(ep.channel(5).toa(), 0);
+
+  // same seed, same channel offsets
+  pflib::sim::EmulatedTarget twin(1, "sipm_rocv3b", 42);
+  BOOST_CHECK_EQUAL(tgt.front_end(0).pedestal(7),
+                    twin.front_end(0).pedestal(7));
+}
+
+BOOST_AUTO_TEST_CASE(factory) {
+  std::unique_ptr<pflib::Target> tgt{
+      pflib::makeTargetEmulated(2, "si_rocv3b", 0)};
+  BOOST_CHECK_EQUAL(tgt->nrocs(), 2);
+  BOOST_CHECK_EQUAL(tgt->roc(1).type(), "si_rocv3b");
+  tgt->setup_run(1, pflib::Target::DaqFormat::SIMPLEROC);
+  tgt->fc().sendL1A();
+  decode(tgt->read_event());
+  BOOST_CHECK_THROW(pflib::makeTargetEmulated(1, "not_a_roc", 0),
+                    pflib::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(pedestal_follows_parameters) {
+  pflib::sim::EmulatedTarget tgt;
+  auto& fe{tgt.front_end(0)};
+  double before = fe.pedestal(3);
+  tgt.roc(0).applyParameter("CH_3", "TRIM_INV", 40);
+  BOOST_CHECK_CLOSE(fe.pedestal(3) - before, 40, 1e-6);
+  tgt.roc(0).applyParameters({{"CH_3", {{"SIGN_DAC", 1}, {"DACB", 10}}}});
+  BOOST_CHECK_LT(fe.pedestal(3), before + 40);
+
+  // a hard reset brings back the defaults
+  tgt.hardResetROCs();
+  BOOST_CHECK_CLOSE(fe.pedestal(3), before, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(charge_injection) {
+  pflib::sim::EmulatedTarget tgt;
+  tgt.setup_run(1, pflib::Target::DaqFormat::SIMPLEROC);
+  tgt.fc().chargepulse();
+  double ped = decode(tgt.read_event()).channel(10).adc();
+
+  tgt.roc(0).applyParameters({{"REFERENCEVOLTAGE_0",
+                               {{"INTCTEST", 1}, {"CALIB", 400}}},
+                              {"CH_10", {{"HIGHRANGE", 1}}}});
+  tgt.fc().chargepulse();
+  auto ep = decode(tgt.read_event());
+  BOOST_CHECK_GT(ep.channel(10).adc(), ped + 300);
+  BOOST_CHECK_GT(ep.channel(10).toa(), 0);
+  // neighbors don't see the charge
+  BOOST_CHECK_LT(ep.channel(11).adc(), ped + 100);
+
+  // away from the peak, the pulse is smaller
+  tgt.fc().fc_setup_calib(tgt.fc().fc_get_setup_calib() + 3);
+  tgt.fc().chargepulse();
+  BOOST_CHECK_LT(decode(tgt.read_event()).channel(10).adc(),
+                 ep.channel(10).adc());
+}
+
+BOOST_AUTO_TEST_CASE(command_history) {
+  pflib::sim::EmulatedTarget tgt;
+  auto& fc{tgt.recorder()};
+  tgt.setup_run(1, pflib::Target::DaqFormat::SIMPLEROC);
+  fc.clear_history();
+  fc.setL1AperROR(3);
+  fc.chargepulse();
+  fc.sendROR();
+  fc.linkreset_rocs();
+
+  const auto& history{fc.history()};
+  BOOST_REQUIRE_EQUAL(history.size(), 9);
+  BOOST_CHECK_EQUAL(history[0].name, "CALIB_INT");
+  BOOST_CHECK_EQUAL(history[1].name, "L1A");
+  BOOST_CHECK_EQUAL(history[1].bx - history[0].bx, fc.fc_get_setup_calib());
+  BOOST_CHECK_EQUAL(history[8].name, "LINKRESET_ROCD");
+  auto counters = fc.getCmdCounters();
+  BOOST_CHECK_EQUAL(counters["L1A"], 6);
+  BOOST_CHECK_EQUAL(counters["CALIB_INT"], 1);
+  BOOST_CHECK_EQUAL(counters["LINKRESET_ROCT"], 1);
+  BOOST_CHECK_EQUAL(tgt.daq().getEventOccupancy(), 6);
+}
+
+BOOST_AUTO_TEST_CASE(econd_events) {
+  pflib::sim::EmulatedTarget tgt(2);
+  tgt.daq().setup(5, 3, 1);
+  tgt.fc().setL1AperROR(3);
+  tgt.setup_run(1, pflib::Target::DaqFormat::ECOND_NO_ZS);
+  tgt.fc().sendROR();
+  std::vector<uint32_t> event = tgt.read_event();
+  BOOST_CHECK(not tgt.has_event());
+
+  pflib::packing::MultiSampleECONDEventPacket ep(4);
+  ep.from(event);
+  BOOST_CHECK_EQUAL(ep.econd_id, 5);
+  BOOST_REQUIRE_EQUAL(ep.samples.size(), 3);
+  BOOST_CHECK_EQUAL(ep.i_soi, 1);
+  for (const auto& sample : ep.samples) {
+    for (bool bad : sample.corruption) BOOST_CHECK(not bad);
+  }
+  // the second ROC has its own pedestals
+  BOOST_CHECK_NE(ep.soi().channel(0, 0).adc(), ep.soi().channel(2, 0).adc());
+}
+
+/// registers on each page of the HGCROC
+static constexpr int N_REGISTERS_PER_PAGE = 32;
+
+/// all of the registers of an emulated ROC
+static std::map<std::pair<int, int>, uint8_t> registers(
+    pflib::sim::EmulatedTarget& tgt, int iroc) {
+  std::map<std::pair<int, int>, uint8_t> regs;
+  auto c = pflib::Compiler::get(tgt.roc(iroc).type());
+  for (int page : c.get_known_pages()) {
+    for (int reg{0}; reg < N_REGISTERS_PER_PAGE; reg++) {
+      regs[{page, reg}] = tgt.chip(iroc).peek(page, reg);
+    }
+  }
+  return regs;
+}
+
+BOOST_AUTO_TEST_CASE(broadcast) {
+  pflib::sim::EmulatedTarget tgt(3);
+  const pflib::Target::ParameterMap parameters{
+      {"CH_3", {{"TRIM_INV", 40}}}, {"REFERENCEVOLTAGE_0", {{"CALIB", 400}}}};
+  auto c = pflib::Compiler::get("sipm_rocv3b");
+  pflib::RegisterImage mask;
+  auto image = c.compile_image(parameters, mask);
+  int n_registers{0};
+  for (const auto& run : image.runs()) n_registers += run.n;
+
+  // bytes written to the chip just to read the pages of the image
+  tgt.chip(0).reset_transactions();
+  for (int page : image.pages()) {
+    tgt.roc(0).readPage(page, N_REGISTERS_PER_PAGE);
+  }
+  const int read_bytes_written = tgt.chip(0).bytes_written();
+
+  // other bits in the registers of the parameters are kept
+  for (const auto& run : image.runs()) {
+    for (int i{0}; i < run.n; i++) {
+      tgt.chip(2).poke(run.page, run.reg + i, 0xFF);
+    }
+  }
+  std::vector<std::map<std::pair<int, int>, uint8_t>> before;
+  for (int iroc : tgt.roc_ids()) {
+    before.push_back(registers(tgt, iroc));
+    tgt.chip(iroc).reset_transactions();
+  }
+  tgt.broadcastParameters(parameters);
+  for (int iroc : tgt.roc_ids()) {
+    for (const auto& [location, value] : registers(tgt, iroc)) {
+      auto [page, reg] = location;
+      uint8_t m = mask.get(page, reg);
+      // only the bits of the parameters change
+      BOOST_CHECK_EQUAL(value & ~m, before[iroc][location] & ~m);
+      BOOST_CHECK_EQUAL(value & m, image.get(page, reg) & m);
+    }
+    // at most a pointer and a value for each register of the image
+    BOOST_CHECK_GT(tgt.chip(iroc).bytes_written(), read_bytes_written);
+    BOOST_CHECK_LE(tgt.chip(iroc).bytes_written(),
+                   read_bytes_written + 3 * n_registers);
+  }
+
+  // the same image again only has to read the registers
+  for (int iroc : tgt.roc_ids()) tgt.chip(iroc).reset_transactions();
+  BOOST_CHECK_EQUAL(tgt.broadcastParameters(parameters), 3 * n_registers);
+  for (int iroc : tgt.roc_ids()) {
+    BOOST_CHECK_EQUAL(tgt.chip(iroc).bytes_written(), read_bytes_written);
+  }
+
+  // only the selected ROCs are touched
+  for (int iroc : tgt.roc_ids()) tgt.chip(iroc).reset_transactions();
+  tgt.broadcastParameters({{"CH_3", {{"TRIM_INV", 7}}}}, {0, 2});
+  BOOST_CHECK_EQUAL(tgt.chip(1).transactions(), 0);
+  BOOST_CHECK_EQUAL(tgt.roc(0).getParameters("CH_3").at("TRIM_INV"), 7);
+  BOOST_CHECK_EQUAL(tgt.roc(1).getParameters("CH_3").at("TRIM_INV"), 40);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
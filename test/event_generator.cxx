@@ -0,0 +1,131 @@
+#define BOOST_TEST_DYN_LINK
+#include "pflib/sim/EventGenerator.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "pflib/Exception.h"
+#include "pflib/packing/BufferReader.h"
+#include "pflib/packing/MultiSampleECONDEventPacket.h"
+#include "pflib/packing/SingleROCEventPacket.h"
+
+BOOST_AUTO_TEST_SUITE(event_generator)
+
+using pflib::sim::EventGenerator;
+
+/// the words as they are written into a raw file
+static std::vector<uint8_t> as_bytes(const std::vector<uint32_t>& words) {
+  auto begin = reinterpret_cast<const uint8_t*>(words.data());
+  return std::vector<uint8_t>(begin, begin + 4 * words.size());
+}
+
+BOOST_AUTO_TEST_CASE(simpleroc_events) {
+  EventGenerator::Config cfg;
+  cfg.format = EventGenerator::Format::SIMPLEROC;
+  cfg.n_samples = 2;
+  cfg.occupancy = 0.5;
+  cfg.seed = 7;
+  EventGenerator gen{cfg};
+  std::vector<uint32_t> event;
+  gen.next(event);
+
+  auto bytes = as_bytes(event);
+  pflib::packing::BufferReader r{bytes};
+  pflib::packing::SingleROCEventPacket ep;
+  for (int i_sample{0}; i_sample < 2; i_sample++) {
+    r >> ep;
+    BOOST_CHECK_EQUAL(ep.daq_links[0].event, i_sample + 1);
+    int n_hit{0};
+    for (const auto& link : ep.daq_links) {
+      for (bool bad : link.corruption) BOOST_CHECK(not bad);
+    }
+    for (int ch{0}; ch < 72; ch++) {
+      if (ep.channel(ch).toa() > 0) n_hit++;
+    }
+    BOOST_CHECK_GT(n_hit, 18);
+    BOOST_CHECK_LT(n_hit, 54);
+  }
+
+  // same seed, same events
+  EventGenerator twin{cfg};
+  std::vector<uint32_t> twin_event;
+  twin.next(twin_event);
+  BOOST_CHECK(event == twin_event);
+}
+
+BOOST_AUTO_TEST_CASE(econd_events) {
+  EventGenerator::Config cfg;
+  cfg.n_samples = 3;
+  cfg.i_soi = 1;
+  cfg.n_links = 3;
+  cfg.n_econs = 2;
+  cfg.occupancy = 0.2;
+  EventGenerator gen{cfg};
+  std::vector<uint32_t> event;
+  gen.next(event);
+
+  auto bytes = as_bytes(event);
+  pflib::packing::BufferReader r{bytes};
+  pflib::packing::MultiSampleECONDEventPacket ep(3);
+  for (int i_econ{0}; i_econ < 2; i_econ++) {
+    r >> ep;
+    BOOST_CHECK_EQUAL(ep.econd_id, i_econ);
+    BOOST_REQUIRE_EQUAL(ep.samples.size(), 3);
+    BOOST_CHECK_EQUAL(ep.i_soi, 1);
+    for (const auto& sample : ep.samples) {
+      for (bool bad : sample.corruption) BOOST_CHECK(not bad);
+      // only the hits pass the zero suppression
+      for (const auto& link : sample.links) {
+        for (const auto& ch : link.channels) {
+          if (ch.adc() > 0) {
+            BOOST_CHECK_GE(ch.adc(), EventGenerator::ZS_THRESHOLD);
+          }
+        }
+      }
+    }
+  }
+
+  BOOST_CHECK_THROW(EventGenerator({.n_links = 13}), pflib::Exception);
+  BOOST_CHECK_THROW(EventGenerator({.n_samples = 2, .i_soi = 2}),
+                    pflib::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(injected_defects) {
+  EventGenerator::Config cfg;
+  cfg.bad_crc_rate = 1.;
+  EventGenerator bad_crc{cfg};
+  std::vector<uint32_t> event;
+  bad_crc.next(event);
+  pflib::packing::MultiSampleECONDEventPacket ep(2);
+  ep.from(event);
+  BOOST_CHECK(ep.soi().corruption[3]);
+  BOOST_CHECK_EQUAL(bad_crc.injected().bad_crc, 1);
+
+  cfg.bad_crc_rate = 0.;
+  cfg.bad_header_rate = 1.;
+  EventGenerator bad_header{cfg};
+  bad_header.next(event);
+  ep.from(event);
+  BOOST_CHECK(ep.soi().corruption[0]);
+  BOOST_CHECK(not ep.soi().corruption[2]);
+  BOOST_CHECK(not ep.soi().corruption[3]);
+
+  cfg.bad_header_rate = 0.;
+  cfg.truncation_rate = 1.;
+  EventGenerator truncated{cfg};
+  truncated.next(event);
+  // software header, two ECON-D header words, CRC, and trailer
+  BOOST_REQUIRE_EQUAL(event.size(), 5);
+  BOOST_CHECK(event[1] & (1 << 6));
+
+  cfg.format = EventGenerator::Format::SIMPLEROC;
+  cfg.truncation_rate = 0.;
+  cfg.bad_crc_rate = 1.;
+  EventGenerator bad_link{cfg};
+  bad_link.next(event);
+  pflib::packing::SingleROCEventPacket roc_ep;
+  roc_ep.from(std::span(event.begin() + 2, event.end() - 2));
+  BOOST_CHECK(roc_ep.daq_links[0].corruption[1] or
+              roc_ep.daq_links[1].corruption[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
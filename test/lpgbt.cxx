@@ -0,0 +1,376 @@
+#define BOOST_TEST_DYN_LINK
+#include "pflib/lpGBT.h"
+
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+
+#include <boost/test/unit_test.hpp>
+#include <filesystem>
+
+#include "pflib/ROC.h"
+#include "pflib/lpgbt/I2C.h"
+#include "pflib/lpgbt/lpGBT_ConfigTransport_I2C.h"
+#include "pflib/lpgbt/lpGBT_Utility.h"
+#include "pflib/sim/HGCROC_I2C.h"
+#include "pflib/sim/ICEC_ZCU.h"
+#include "pflib/sim/lpGBT_Model.h"
+
+BOOST_AUTO_TEST_SUITE(lpgbt)
+
+static const uint8_t ROC_BASE = 0x20;
+
+BOOST_AUTO_TEST_CASE(i2c_single_byte) {
+  pflib::sim::lpGBT_Model model;
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  model.attach(0, chip);
+  pflib::lpGBT lpgbt(model);
+  pflib::lpgbt::I2C i2c(lpgbt, 0);
+
+  model.reset_counters();
+  i2c.write_byte(ROC_BASE, 0x11);
+  // control register, data with command, one status poll
+  BOOST_CHECK_EQUAL(model.transactions(), 3);
+  BOOST_CHECK_EQUAL(model.status_polls(), 1);
+  BOOST_CHECK_EQUAL(i2c.read_byte(ROC_BASE), 0x11);
+  BOOST_CHECK_EQUAL(model.transactions(), 6);
+  BOOST_CHECK_EQUAL(model.status_polls(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(i2c_multi_byte) {
+  pflib::sim::lpGBT_Model model;
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  model.attach(1, chip);
+  pflib::lpGBT lpgbt(model);
+  pflib::lpgbt::I2C i2c(lpgbt, 1);
+  i2c.set_bus_speed(1000);
+
+  std::vector<uint8_t> data;
+  for (int i{0}; i < 16; i++) data.push_back(0x30 + i);
+
+  model.reset_counters();
+  i2c.general_write_read(ROC_BASE, {0x40});
+  i2c.general_write_read(ROC_BASE + 3, data);
+  for (int i{0}; i < 16; i++) {
+    BOOST_CHECK_EQUAL(chip->peek(2, i), data[i]);
+  }
+  // 3 for the pointer, then control, four blocks, launch and poll
+  BOOST_CHECK_EQUAL(model.transactions(), 3 + 7);
+
+  model.reset_counters();
+  i2c.general_write_read(ROC_BASE, {0x40});
+  std::vector<uint8_t> back = i2c.general_write_read(ROC_BASE + 3, {}, 16);
+  BOOST_CHECK_EQUAL_COLLECTIONS(back.begin(), back.end(), data.begin(),
+                                data.end());
+  // data comes back with the successful status poll
+  BOOST_CHECK_EQUAL(model.transactions(), 3 + 3);
+  BOOST_CHECK_EQUAL(model.status_polls(), 2);
+
+  BOOST_CHECK_THROW(i2c.general_write_read(ROC_BASE + 3, {}, 17),
+                    pflib::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(i2c_slow_target) {
+  pflib::sim::lpGBT_Model model;
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  model.attach(0, chip);
+  pflib::lpGBT lpgbt(model);
+  pflib::lpgbt::I2C i2c(lpgbt, 0);
+
+  model.set_stretch_us(3000);
+  model.reset_counters();
+  i2c.write_byte(ROC_BASE, 0x11);
+  BOOST_CHECK(model.status_polls() > 1);
+  // back-off keeps the number of polls small
+  BOOST_CHECK(model.status_polls() < 12);
+}
+
+BOOST_AUTO_TEST_CASE(i2c_no_ack) {
+  pflib::sim::lpGBT_Model model;
+  model.attach(0, std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE));
+  pflib::lpGBT lpgbt(model);
+  pflib::lpgbt::I2C i2c(lpgbt, 0);
+  BOOST_CHECK_THROW(i2c.write_byte(0x50, 1), pflib::Exception);
+  pflib::lpgbt::I2C other(lpgbt, 2);
+  BOOST_CHECK_THROW(other.read_byte(ROC_BASE), pflib::Exception);
+}
+
+/// device answering on every address, counting the writes to each
+class AnyDevice : public pflib::I2C {
+ public:
+  std::map<int, int> writes;
+  bool fail{false};
+  virtual void set_bus_speed(int) {}
+  virtual int get_bus_speed() { return 100; }
+  virtual void write_byte(uint8_t addr, uint8_t) {
+    if (fail) PFEXCEPTION_RAISE("I2CErrorNoACK", "failing on purpose");
+    writes[addr]++;
+  }
+  virtual uint8_t read_byte(uint8_t) { return 0; }
+  virtual std::vector<uint8_t> general_write_read(
+      uint8_t addr, const std::vector<uint8_t>& wdata, int nread) {
+    if (not wdata.empty()) write_byte(addr, wdata.back());
+    return std::vector<uint8_t>(nread, 0);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(bus_state_cache) {
+  pflib::sim::lpGBT_Model model;
+  auto device = std::make_shared<AnyDevice>();
+  model.attach(1, device);
+  pflib::lpGBT lpgbt(model);
+  pflib::lpgbt::I2CwithMux a(lpgbt, 1, 0x70, 0x1), b(lpgbt, 1, 0x70, 0x1);
+
+  a.set_bus_speed(400);
+  a.write_byte(0x10, 1);
+  BOOST_CHECK_EQUAL(device->writes[0x70], 1);
+  // same speed and mux selection through another bus object on the master
+  model.reset_counters();
+  b.set_bus_speed(400);
+  BOOST_CHECK_EQUAL(model.transactions(), 0);
+  b.write_byte(0x10, 2);
+  BOOST_CHECK_EQUAL(device->writes[0x70], 1);
+  BOOST_CHECK_EQUAL(device->writes[0x10], 2);
+
+  // after invalidating, both are programmed again
+  lpgbt.invalidate_i2c_bus_state();
+  model.reset_counters();
+  b.set_bus_speed(400);
+  BOOST_CHECK_GT(model.transactions(), 0);
+  b.write_byte(0x10, 3);
+  BOOST_CHECK_EQUAL(device->writes[0x70], 2);
+
+  // re-configuring the master or re-reading the chip does the same
+  lpgbt.setup_i2c(1, 100);
+  a.write_byte(0x10, 4);
+  BOOST_CHECK_EQUAL(device->writes[0x70], 3);
+  lpgbt.enable_shadow();
+  lpgbt.refresh_shadow();
+  a.write_byte(0x10, 5);
+  BOOST_CHECK_EQUAL(device->writes[0x70], 4);
+
+  // so does a failed transaction
+  device->fail = true;
+  BOOST_CHECK_THROW(a.write_byte(0x10, 6), pflib::Exception);
+  device->fail = false;
+  model.reset_counters();
+  a.set_bus_speed(400);
+  BOOST_CHECK_GT(model.transactions(), 0);
+  a.write_byte(0x10, 7);
+  BOOST_CHECK_EQUAL(device->writes[0x70], 5);
+}
+
+BOOST_AUTO_TEST_CASE(roc_over_lpgbt) {
+  pflib::sim::lpGBT_Model model;
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  model.attach(0, chip);
+  pflib::lpGBT lpgbt(model);
+  auto i2c = std::make_shared<pflib::lpgbt::I2C>(lpgbt, 0);
+  pflib::ROC roc(i2c, ROC_BASE, "sipm_rocv3b");
+
+  for (int reg{0}; reg < 32; reg++) chip->poke(7, reg, reg * 3);
+  std::vector<uint8_t> page = roc.readPage(7, 32);
+  BOOST_REQUIRE_EQUAL(page.size(), 32);
+  for (int reg{0}; reg < 32; reg++) BOOST_CHECK_EQUAL(page[reg], reg * 3);
+
+  roc.setValue(9, 4, 0x5A);
+  BOOST_CHECK_EQUAL(chip->peek(9, 4), 0x5A);
+}
+
+BOOST_AUTO_TEST_CASE(transport_queue) {
+  pflib::sim::lpGBT_Model model;
+  model.queue_write(0x10, {1, 2});
+  model.queue_write(0x12, 3);
+  model.queue_write(0x20, 4);
+  model.queue_read(0x10, 2);
+  model.queue_read(0x12);
+  BOOST_CHECK_EQUAL(model.queued(), 3);
+  std::vector<uint8_t> values = model.flush();
+  std::vector<uint8_t> expected = {1, 2, 3};
+  BOOST_CHECK_EQUAL_COLLECTIONS(values.begin(), values.end(),
+                                expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(model.transactions(), 3);
+  BOOST_CHECK_EQUAL(model.queued(), 0);
+  BOOST_CHECK_EQUAL(model.peek(0x20), 4);
+}
+
+BOOST_AUTO_TEST_CASE(icec_frames) {
+  static const uint8_t LPGBT_ADDR = 0x70;
+  pflib::sim::lpGBT_Model model;
+  auto icec = std::make_shared<pflib::sim::ICEC_ZCU>(model, false, LPGBT_ADDR);
+  pflib::zcu::lpGBT_ICEC_Simple tport(icec, false, LPGBT_ADDR);
+
+  std::vector<uint8_t> data;
+  for (int i{0}; i < 20; i++) data.push_back(0x80 + i);
+  icec->reset_counters();
+  tport.write_regs(0x20, data);
+  for (int i{0}; i < 20; i++) BOOST_CHECK_EQUAL(model.peek(0x20 + i), data[i]);
+  BOOST_CHECK_EQUAL(icec->frames(), 3);
+
+  icec->reset_counters();
+  icec->set_reply_delay(100);
+  std::vector<uint8_t> back = tport.read_regs(0x20, 20);
+  BOOST_CHECK_EQUAL_COLLECTIONS(back.begin(), back.end(), data.begin(),
+                                data.end());
+  BOOST_CHECK_EQUAL(icec->frames(), 3);
+
+  // the queue merges what would otherwise be one frame per register
+  pflib::lpGBT lpgbt(tport);
+  pflib::lpGBT::RegisterValueVector config;
+  for (uint16_t reg = 0x40; reg < 0x4A; reg++) config.push_back({reg, reg});
+  config.push_back({0x60, 0x60});
+  icec->reset_counters();
+  lpgbt.write(config);
+  BOOST_CHECK_EQUAL(icec->frames(), 3);
+  BOOST_CHECK_EQUAL(model.peek(0x49), 0x49);
+
+  pflib::zcu::lpGBT_ICEC_Simple other(icec, false, LPGBT_ADDR + 1);
+  BOOST_CHECK_THROW(other.read_reg(0x20), pflib::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(shadow) {
+  pflib::sim::lpGBT_Model model;
+  pflib::lpGBT lpgbt(model);
+  model.poke(0x0ae, 0x12);
+  model.poke(0x1d9, 0x13);
+
+  model.reset_counters();
+  lpgbt.enable_shadow();
+  BOOST_CHECK_EQUAL(model.transactions(), 1);
+  BOOST_CHECK_EQUAL(lpgbt.read(0x0ae), 0x12);
+  BOOST_CHECK_EQUAL(model.transactions(), 1);
+
+  // read-modify-write is only a write now
+  lpgbt.bit_set(0x0ae, 0);
+  BOOST_CHECK_EQUAL(model.transactions(), 2);
+  BOOST_CHECK_EQUAL(model.peek(0x0ae), 0x13);
+
+  // status registers still go to the chip
+  model.poke(0x1d9, 0x14);
+  BOOST_CHECK_EQUAL(lpgbt.status(), 0x14);
+  BOOST_CHECK_EQUAL(model.transactions(), 3);
+
+  // chip changing behind our back
+  model.poke(0x0ae, 0);
+  model.poke(0x0af, 1);
+  BOOST_CHECK_EQUAL(lpgbt.refresh_shadow(), 2);
+  BOOST_CHECK_EQUAL(lpgbt.read(0x0ae), 0);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_restore) {
+  pflib::sim::lpGBT_Model model;
+  pflib::lpGBT lpgbt(model);
+  for (uint16_t reg = 0; reg < 0x20; reg++) model.poke(reg, reg + 1);
+  model.poke(0x0fb, 0x6);
+  model.poke(0x1d9, 0x13);
+  pflib::lpGBT::RegisterValueVector saved = lpgbt.snapshot();
+  for (const auto& rv : saved) BOOST_CHECK(rv.first < 0x140);
+
+  auto dir = std::filesystem::temp_directory_path();
+  std::string yaml = (dir / "pflib_lpgbt_snapshot.yaml").string();
+  std::string bin = (dir / "pflib_lpgbt_snapshot.bin").string();
+  pflib::lpgbt::saveRegisterSnapshot(yaml, saved);
+  pflib::lpgbt::saveRegisterSnapshot(bin, saved);
+  pflib::lpGBT::RegisterValueVector from_yaml =
+      pflib::lpgbt::loadRegisterSnapshot(yaml);
+  pflib::lpGBT::RegisterValueVector from_bin =
+      pflib::lpgbt::loadRegisterSnapshot(bin);
+  BOOST_CHECK(from_yaml == saved);
+  BOOST_CHECK(from_bin == saved);
+  std::filesystem::remove(yaml);
+  std::filesystem::remove(bin);
+
+  // power cycle a few registers
+  model.poke(0x03, 0);
+  model.poke(0x10, 0);
+  model.poke(0x0fb, 0);
+  lpgbt.enable_shadow();
+  pflib::lpGBT::RegisterValueVector changes = lpgbt.diff(from_yaml);
+  BOOST_CHECK_EQUAL(changes.size(), 3);
+  model.reset_counters();
+  BOOST_CHECK_EQUAL(lpgbt.restore(from_bin), 3);
+  BOOST_CHECK_EQUAL(model.peek(0x03), 4);
+  BOOST_CHECK_EQUAL(model.peek(0x10), 0x11);
+  BOOST_CHECK_EQUAL(model.peek(0x0fb), 0x6);
+  // nothing left to do
+  BOOST_CHECK_EQUAL(lpgbt.restore(from_bin), 0);
+}
+
+/// mock of the I2C bus device file with an lpGBT on it
+class MockI2CDevice : public pflib::lpGBT_ConfigTransport_I2C::Device {
+ public:
+  MockI2CDevice(pflib::lpGBT_ConfigTransport& chip, uint8_t addr)
+      : chip_{chip}, addr_{addr} {}
+  virtual int ioctl(unsigned long request, void* arg) {
+    if (request == I2C_SLAVE) return busy ? -1 : 0;
+    if (request != I2C_RDWR) return -1;
+    n_ioctl++;
+    auto rdwr = static_cast<struct i2c_rdwr_ioctl_data*>(arg);
+    for (unsigned i = 0; i < rdwr->nmsgs; i++) {
+      const struct i2c_msg& msg{rdwr->msgs[i]};
+      if (msg.addr != addr_) return -1;
+      if (msg.flags & I2C_M_RD) {
+        std::vector<uint8_t> values = chip_.read_regs(pointer_, msg.len);
+        std::copy(values.begin(), values.end(), msg.buf);
+        pointer_ += msg.len;
+      } else {
+        pointer_ = msg.buf[0] | (uint16_t(msg.buf[1]) << 8);
+        if (msg.len > 2) {
+          chip_.write_regs(pointer_, std::vector<uint8_t>(msg.buf + 2,
+                                                          msg.buf + msg.len));
+          pointer_ += msg.len - 2;
+        }
+      }
+    }
+    return rdwr->nmsgs;
+  }
+  virtual ssize_t read(void* buf, size_t n) { return -1; }
+  virtual ssize_t write(const void* buf, size_t n) { return -1; }
+  int n_ioctl{0};
+  /// refuse to select an address like for one claimed by a kernel driver
+  bool busy{false};
+
+ private:
+  pflib::lpGBT_ConfigTransport& chip_;
+  uint8_t addr_;
+  uint16_t pointer_{0};
+};
+
+BOOST_AUTO_TEST_CASE(i2c_transport_chunks) {
+  pflib::sim::lpGBT_Model model;
+  auto dev = std::make_shared<MockI2CDevice>(model, 0x74);
+  pflib::lpGBT_ConfigTransport_I2C tport(0x74, dev);
+
+  std::vector<uint8_t> data;
+  for (int i{0}; i < 100; i++) data.push_back(i + 1);
+  tport.write_regs(0x010, data);
+  BOOST_CHECK_EQUAL(dev->n_ioctl, 2);
+  BOOST_CHECK_EQUAL(model.peek(0x010 + 99), 100);
+
+  tport.set_chunk_size(pflib::lpGBT_ConfigTransport_I2C::MAX_CHUNK);
+  dev->n_ioctl = 0;
+  std::vector<uint8_t> image = tport.read_regs(0, pflib::lpGBT::SHADOW_SIZE);
+  BOOST_CHECK_EQUAL(dev->n_ioctl, 1);
+  BOOST_CHECK_EQUAL(image[0x010 + 50], 51);
+
+  tport.set_chunk_size(8);
+  uint8_t buf[16];
+  dev->n_ioctl = 0;
+  tport.read_regs(0x010, 16, buf, sizeof(buf));
+  BOOST_CHECK_EQUAL(dev->n_ioctl, 2);
+  BOOST_CHECK_EQUAL(buf[15], 16);
+  BOOST_CHECK_THROW(tport.read_regs(0x010, 17, buf, sizeof(buf)),
+                    pflib::Exception);
+  BOOST_CHECK_THROW(tport.set_chunk_size(0), pflib::Exception);
+
+  tport.write_reg(0x0ff, 0xAB);
+  BOOST_CHECK_EQUAL(tport.read_reg(0x0ff), 0xAB);
+
+  pflib::lpGBT_ConfigTransport_I2C other(0x75, dev);
+  BOOST_CHECK_THROW(other.read_reg(0), pflib::Exception);
+
+  dev->busy = true;
+  BOOST_CHECK_THROW(pflib::lpGBT_ConfigTransport_I2C(0x74, dev),
+                    pflib::Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+#define BOOST_TEST_DYN_LINK
+#include "pflib/RegisterImage.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "pflib/Compile.h"
+
+BOOST_AUTO_TEST_SUITE(register_image)
+
+BOOST_AUTO_TEST_CASE(set_get_and_map) {
+  std::map<int, std::map<int, uint8_t>> registers = {
+      {1, {{0, 0x10}, {1, 0x11}, {5, 0x15}}}, {3, {{70, 0x46}}}};
+  pflib::RegisterImage image(registers);
+  BOOST_CHECK_EQUAL(image.size(), 4);
+  BOOST_CHECK(image.has(1, 5));
+  BOOST_CHECK(not image.has(1, 2));
+  BOOST_CHECK(not image.has(2, 0));
+  BOOST_CHECK_EQUAL(int(image.get(3, 70)), 0x46);
+  BOOST_CHECK(image.to_map() == registers);
+  BOOST_CHECK(image.pages() == std::vector<int>({1, 3}));
+
+  image.set_bits(1, 5, 0xf0, 0xa0);
+  BOOST_CHECK_EQUAL(int(image.get(1, 5)), 0xa5);
+  image.set_bits(2, 0, 0x0c, 0xff);
+  BOOST_CHECK_EQUAL(int(image.get(2, 0)), 0x0c);
+}
+
+BOOST_AUTO_TEST_CASE(dirty_runs) {
+  pflib::RegisterImage image;
+  for (int reg{0}; reg < 100; reg++) image.set(0, reg, reg);
+  auto runs = image.dirty_runs();
+  BOOST_REQUIRE_EQUAL(runs.size(), 1);
+  BOOST_CHECK_EQUAL(runs[0].reg, 0);
+  BOOST_CHECK_EQUAL(runs[0].n, 100);
+
+  image.clear_dirty();
+  BOOST_CHECK(image.dirty_runs().empty());
+  // same value does not dirty the register
+  image.set(0, 10, 10);
+  BOOST_CHECK(not image.is_dirty(0, 10));
+  image.set(0, 10, 0xff);
+  image.set(0, 11, 0xff);
+  image.set(0, 63, 0xff);
+  image.set(0, 64, 0xff);
+  runs = image.dirty_runs();
+  BOOST_REQUIRE_EQUAL(runs.size(), 2);
+  BOOST_CHECK_EQUAL(runs[0].reg, 10);
+  BOOST_CHECK_EQUAL(runs[0].n, 2);
+  BOOST_CHECK_EQUAL(runs[1].reg, 63);
+  BOOST_CHECK_EQUAL(runs[1].n, 2);
+  BOOST_CHECK_EQUAL(int(runs[1].values[1]), 0xff);
+}
+
+BOOST_AUTO_TEST_CASE(merge_and_diff) {
+  pflib::RegisterImage chip, target;
+  for (int reg{0}; reg < 32; reg++) chip.set(4, reg, 0);
+  target.set(4, 3, 0);
+  target.set(4, 4, 7);
+  target.set(5, 0, 1);
+
+  pflib::RegisterImage changes = chip.diff(target);
+  BOOST_CHECK_EQUAL(changes.size(), 2);
+  BOOST_CHECK(changes.has(4, 4));
+  BOOST_CHECK(changes.has(5, 0));
+
+  chip.clear_dirty();
+  chip.merge(target);
+  BOOST_CHECK_EQUAL(chip.size(), 33);
+  BOOST_CHECK_EQUAL(chip.dirty_runs().size(), 2);
+  BOOST_CHECK(chip.diff(target).empty());
+}
+
+BOOST_AUTO_TEST_CASE(compile_matches_map) {
+  pflib::Compiler c = pflib::Compiler::get("sipm_rocv3b");
+  auto settings = c.defaults();
+  pflib::RegisterImage image = c.compile_image(settings);
+  BOOST_CHECK(image.to_map() == c.compile(settings));
+  BOOST_CHECK(c.decompile(image, true) == c.decompile(image.to_map(), true));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
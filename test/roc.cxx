@@ -0,0 +1,294 @@
+#define BOOST_TEST_DYN_LINK
+#include "pflib/ROC.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "pflib/ConfigExecutor.h"
+#include "pflib/sim/HGCROC_I2C.h"
+
+BOOST_AUTO_TEST_SUITE(roc)
+
+static const uint8_t ROC_BASE = 0x20;
+
+/// fill the simulated chip with a recognizable pattern
+static void fill_pattern(pflib::sim::HGCROC_I2C& chip,
+                         const std::vector<int>& pages) {
+  for (int page : pages) {
+    for (int reg{0}; reg < 32; reg++) {
+      chip.poke(page, reg, (page * 7 + reg) & 0xFF);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bulk_read_page) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+  fill_pattern(*chip, {11});
+
+  chip->reset_transactions();
+  std::vector<uint8_t> page = roc.readPage(11, 32);
+  BOOST_REQUIRE_EQUAL(page.size(), 32);
+  for (int reg{0}; reg < 32; reg++) {
+    BOOST_CHECK_EQUAL(page[reg], chip->peek(11, reg));
+  }
+  // two pointer writes and two 16-byte reads
+  BOOST_CHECK_EQUAL(chip->transactions(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(bulk_read_large_transfers) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE, 1024);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+  fill_pattern(*chip, {89});
+  chip->reset_transactions();
+  std::vector<uint8_t> page = roc.readPage(89, 27);
+  BOOST_REQUIRE_EQUAL(page.size(), 27);
+  BOOST_CHECK_EQUAL(page[26], chip->peek(89, 26));
+  BOOST_CHECK_EQUAL(chip->transactions(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_set_registers) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+
+  std::map<int, std::map<int, uint8_t>> registers;
+  for (int reg{0}; reg < 20; reg++) registers[3][reg] = reg + 1;
+  registers[3][25] = 0xAB;
+  // end of one page runs into the start of the next
+  registers[4][31] = 0x11;
+  registers[5][0] = 0x22;
+
+  chip->reset_transactions();
+  roc.setRegisters(registers);
+  for (const auto& [page, regs] : registers) {
+    for (const auto& [reg, val] : regs) {
+      BOOST_CHECK_EQUAL(chip->peek(page, reg), val);
+    }
+  }
+  BOOST_CHECK_EQUAL(chip->peek(3, 20), 0);
+  // run of 20 : 2 pointer + 2 chunks
+  // single 25 : 3 single-byte transactions
+  // run of 2 across pages : 2 pointer + 1 chunk
+  BOOST_CHECK_EQUAL(chip->transactions(), 4 + 3 + 3);
+
+  auto readback = roc.getRegisters(registers);
+  BOOST_CHECK(readback == registers);
+}
+
+BOOST_AUTO_TEST_CASE(shadow) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+  fill_pattern(*chip, pflib::Compiler::get("sipm_rocv3b").get_known_pages());
+
+  roc.enableShadow();
+  BOOST_CHECK(roc.hasShadow());
+
+  // copies share the shadow
+  pflib::ROC copy = roc;
+  BOOST_CHECK(copy.hasShadow());
+
+  chip->reset_transactions();
+  BOOST_CHECK_EQUAL(roc.getValue(11, 5), chip->peek(11, 5));
+  auto page = copy.readPage(89, 32);
+  BOOST_CHECK_EQUAL(page[31], chip->peek(89, 31));
+  BOOST_CHECK_EQUAL(chip->transactions(), 0);
+
+  // registers the shadow doesn't hold come from the chip
+  page = roc.readPage(11, 34);
+  BOOST_REQUIRE_EQUAL(page.size(), 34);
+  BOOST_CHECK_EQUAL(page[32], chip->peek(12, 0));
+  BOOST_CHECK_EQUAL(page[33], chip->peek(12, 1));
+  BOOST_CHECK_GT(chip->transactions(), 0);
+  BOOST_CHECK_EQUAL(roc.readPage(11, 34)[32], chip->peek(12, 0));
+
+  // writes go through to the chip and are seen by the copy
+  roc.setValue(11, 5, 0x42);
+  BOOST_CHECK_EQUAL(chip->peek(11, 5), 0x42);
+  chip->reset_transactions();
+  BOOST_CHECK_EQUAL(copy.getValue(11, 5), 0x42);
+  BOOST_CHECK_EQUAL(chip->transactions(), 0);
+
+  // changes behind our back are found by refresh
+  chip->poke(11, 6, 0x99);
+  BOOST_CHECK_NE(roc.getValue(11, 6), 0x99);
+  BOOST_CHECK_EQUAL(roc.refresh(), 1);
+  BOOST_CHECK_EQUAL(roc.getValue(11, 6), 0x99);
+
+  // verify mode reads the chip and keeps its value
+  chip->poke(11, 7, 0x12);
+  roc.enableShadow(true);
+  BOOST_CHECK_EQUAL(roc.getValue(11, 7), 0x12);
+  roc.disableShadow();
+  BOOST_CHECK(not copy.hasShadow());
+}
+
+BOOST_AUTO_TEST_CASE(diff_apply) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+
+  std::map<int, std::map<int, uint8_t>> registers;
+  registers[3][0] = 1;
+  registers[3][1] = 2;
+  registers[3][2] = 3;
+  roc.setRegisters(registers);
+  auto current = registers;
+  registers[3][1] = 5;
+  chip->reset_transactions();
+  BOOST_CHECK_EQUAL(roc.setChangedRegisters(registers, current), 2);
+  BOOST_CHECK_EQUAL(chip->peek(3, 1), 5);
+  // one single-byte write
+  BOOST_CHECK_EQUAL(chip->transactions(), 3);
+
+  roc.applyParameter("CH_45", "TRIM_TOA", 10);
+  chip->reset_transactions();
+  roc.applyParameter("CH_45", "TRIM_TOA", 10);
+  // only the read of the current page, nothing written
+  BOOST_CHECK_EQUAL(chip->transactions(), 4);
+
+  auto before = roc.getParameters("CH_45");
+  {
+    auto test_param_handle =
+        roc.testParameters().add("CH_45", "TRIM_TOA", 20).apply();
+    BOOST_CHECK_EQUAL(roc.getParameters("CH_45").at("TRIM_TOA"), 20);
+  }
+  BOOST_CHECK(roc.getParameters("CH_45") == before);
+
+  auto trim_toa = roc.resolve("CH_45", "TRIM_TOA");
+  for (int val : {1, 2, 3}) {
+    auto test_param_handle = roc.testParameters().add(trim_toa, val).apply();
+    BOOST_CHECK_EQUAL(roc.getParameters("CH_45").at("TRIM_TOA"), val);
+  }
+  BOOST_CHECK(roc.getParameters("CH_45") == before);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_buses) {
+  auto bus_a = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  auto bus_b = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc_a(bus_a, ROC_BASE, "sipm_rocv3b"),
+      roc_b(bus_b, ROC_BASE, "sipm_rocv3b");
+
+  pflib::ConfigExecutor exec;
+  exec.add(roc_a.i2c(), "ROC A",
+           [&roc_a]() { roc_a.applyParameter("CH_45", "TRIM_TOA", 10); });
+  exec.add(roc_b.i2c(), "ROC B",
+           [&roc_b]() { roc_b.applyParameter("CH_45", "TRIM_TOA", 20); });
+  exec.add(roc_a.i2c(), "ROC A again",
+           [&roc_a]() { roc_a.applyParameter("CH_45", "TRIM_TOA", 30); });
+  BOOST_CHECK_EQUAL(exec.nbuses(), 2);
+  BOOST_CHECK_EQUAL(exec.ntasks(), 3);
+  exec.run();
+  BOOST_CHECK_EQUAL(exec.ntasks(), 0);
+  // tasks on the same bus are run in order
+  BOOST_CHECK_EQUAL(roc_a.getParameters("CH_45").at("TRIM_TOA"), 30);
+  BOOST_CHECK_EQUAL(roc_b.getParameters("CH_45").at("TRIM_TOA"), 20);
+
+  exec.add(roc_a.i2c(), "ROC A bad",
+           [&roc_a]() { roc_a.applyParameter("CH_45", "NOT_A_PARAM", 1); });
+  exec.add(roc_b.i2c(), "ROC B",
+           [&roc_b]() { roc_b.applyParameter("CH_45", "TRIM_TOA", 5); });
+  BOOST_CHECK_THROW(exec.run(), pflib::Exception);
+  // failure on one bus does not stop the others
+  BOOST_CHECK_EQUAL(roc_b.getParameters("CH_45").at("TRIM_TOA"), 5);
+}
+
+BOOST_AUTO_TEST_CASE(apply_image) {
+  auto compiler = pflib::Compiler::get("sipm_rocv3b");
+  pflib::RegisterImage mask;
+  auto values = compiler.compile_image({{"CH_45", {{"TRIM_TOA", 10}}}}, mask);
+  auto trim_toa = compiler.resolve("CH_45", "TRIM_TOA");
+
+  // same image onto chips with different contents
+  auto chip_a = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  auto chip_b = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  fill_pattern(*chip_b, {trim_toa.page()});
+  pflib::ROC roc_a(chip_a, ROC_BASE, "sipm_rocv3b"),
+      roc_b(chip_b, ROC_BASE, "sipm_rocv3b");
+  auto before_b = roc_b.getParameters("CH_45");
+  for (pflib::ROC* roc : {&roc_a, &roc_b}) {
+    BOOST_CHECK_EQUAL(roc->applyImage(values, mask), 0);
+    BOOST_CHECK_EQUAL(roc->getParameters("CH_45").at("TRIM_TOA"), 10);
+  }
+  // the other parameters sharing the registers are kept
+  auto after_b = roc_b.getParameters("CH_45");
+  after_b["TRIM_TOA"] = before_b["TRIM_TOA"];
+  BOOST_CHECK(after_b == before_b);
+
+  // nothing written when the chip already has the values
+  chip_a->reset_transactions();
+  BOOST_CHECK_EQUAL(roc_a.applyImage(values, mask), values.size());
+  BOOST_CHECK_EQUAL(chip_a->transactions(), 4);
+
+  // no reads when the image sets whole registers
+  pflib::RegisterImage full_values, full_mask;
+  full_values.set(3, 0, 0x12);
+  full_mask.set(3, 0, 0xFF);
+  chip_a->reset_transactions();
+  BOOST_CHECK_EQUAL(roc_a.applyImage(full_values, full_mask), 0);
+  BOOST_CHECK_EQUAL(chip_a->peek(3, 0), 0x12);
+  BOOST_CHECK_EQUAL(chip_a->transactions(), 3);
+
+  // and no I2C at all with the shadow
+  roc_a.enableShadow();
+  chip_a->reset_transactions();
+  BOOST_CHECK_EQUAL(roc_a.applyImage(values, mask), values.size());
+  BOOST_CHECK_EQUAL(roc_a.applyImage(full_values, full_mask), 1);
+  BOOST_CHECK_EQUAL(chip_a->transactions(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(retry_injected_errors) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+  fill_pattern(*chip, {7});
+
+  // the data write fails, so the whole sequence is tried again
+  chip->fail_after(2);
+  roc.setValue(7, 3, 0x5A);
+  BOOST_CHECK_EQUAL(chip->peek(7, 3), 0x5A);
+  BOOST_CHECK_EQUAL(chip->injected_errors(), 1);
+  BOOST_CHECK_EQUAL(chip->transactions(), 6);
+
+  chip->reset_transactions();
+  chip->fail_after(1, 2);
+  std::vector<uint8_t> page = roc.readPage(7, 32);
+  BOOST_CHECK_EQUAL(page[3], 0x5A);
+  BOOST_CHECK_EQUAL(chip->injected_errors(), 2);
+
+  // give up after too many failures
+  chip->fail_every(1);
+  BOOST_CHECK_THROW(roc.getValue(7, 3), pflib::Exception);
+  chip->fail_every(0);
+  BOOST_CHECK_EQUAL(roc.getValue(7, 3), 0x5A);
+}
+
+BOOST_AUTO_TEST_CASE(bus_accounting) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+  roc.readPage(11, 32);
+  BOOST_CHECK_EQUAL(chip->bytes_written(), 2);
+  BOOST_CHECK_EQUAL(chip->bytes_read(), 32);
+  // ROC runs the bus at 1400 kbps
+  double expected_us = 1000. * (2 * (2 + 9 * 2) + 2 * (2 + 9 * 17)) / 1400;
+  BOOST_CHECK_CLOSE(chip->bus_time_us(), expected_us, 1e-6);
+
+  chip->reset_transactions();
+  chip->set_latency(std::chrono::microseconds(200));
+  auto start = std::chrono::steady_clock::now();
+  roc.getValue(11, 0);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  BOOST_CHECK_EQUAL(chip->transactions(), 3);
+  BOOST_CHECK(elapsed >= std::chrono::microseconds(600));
+}
+
+BOOST_AUTO_TEST_CASE(test_parameters_transactions) {
+  auto chip = std::make_shared<pflib::sim::HGCROC_I2C>(ROC_BASE);
+  pflib::ROC roc(chip, ROC_BASE, "sipm_rocv3b");
+  {
+    auto test_param = roc.testParameters().add("CH_3", "TRIM_INV", 12).apply();
+    BOOST_CHECK_EQUAL(roc.getParameters("CH_3").at("TRIM_INV"), 12);
+    chip->reset_transactions();
+  }
+  // restoring only writes the one register that changed
+  BOOST_CHECK_EQUAL(chip->bytes_written(), 3);
+  BOOST_CHECK_EQUAL(roc.getParameters("CH_3").at("TRIM_INV"), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()